@@ -0,0 +1,472 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// FILE: bench_dtag.c
+
+#include "dtag.h"
+#include "dtag_heat.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/* allocations made by libdtag, counted via `-Wl,--wrap=malloc` */
+
+static uint64_t g_allocs = 0;
+
+extern void *__real_malloc(size_t size);
+void *__wrap_malloc(size_t size) {
+  g_allocs++;
+  return __real_malloc(size);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+enum bench_format {
+  FORMAT_TEXT,
+  FORMAT_CSV,
+  FORMAT_JSON,
+};
+
+typedef struct {
+  uint32_t flags;
+  uint32_t items;
+  uint32_t klen;
+  uint32_t vlen;
+  uint32_t capacity;
+} bench_conf_t;
+
+typedef struct {
+  dblock_t *block;
+  uint8_t *buf;
+  uint32_t size;
+  char (*keys)[DTAG_MAX_KLEN];
+  char (*misses)[DTAG_MAX_KLEN];
+  dtag_key_t *prepared;
+  uint32_t *order;
+  uint8_t *value;
+  const char *path;
+} bench_ctx_t;
+
+/* 一轮测量：返回本轮计时的纳秒数，`ops`/`bytes` 为本轮的操作数与数据量 */
+typedef uint64_t (*bench_f)(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes);
+
+static uint64_t g_min_ns = 20 * 1000 * 1000;
+static int g_format = FORMAT_TEXT;
+static uint32_t g_rows = 0;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void fill(const bench_conf_t *conf, bench_ctx_t *ctx) {
+  dtag_key_t key;
+  if (conf->flags & DTAG_FLAG_SCHEMA) {
+    dtag_init_schema(&ctx->block, ctx->buf, ctx->size, conf->flags & ~DTAG_FLAG_SCHEMA, conf->items);
+  } else {
+    dtag_init_ex(&ctx->block, ctx->buf, ctx->size, conf->flags);
+  }
+  for (uint32_t i = 0; i < conf->items; i++) {
+    dtag_key_prepare(&key, ctx->keys[i]);
+    int32_t result = (conf->flags & DTAG_FLAG_SCHEMA) ? dtag_set_slot(ctx->block, i, &key, ctx->value, conf->vlen)
+                                                      : dtag_set_k(ctx->block, &key, ctx->value, conf->vlen);
+    if (result != DTAG_OK) {
+      fprintf(stderr, "fail to fill %u (%d)\n", i, result);
+      exit(EXIT_FAILURE);
+    }
+  }
+  dtag_complete(ctx->block);
+}
+
+static uint64_t bench_set(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  dtag_init_ex(&ctx->block, ctx->buf, ctx->size, conf->flags & ~DTAG_FLAG_SCHEMA);
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    dtag_set(ctx->block, ctx->keys[ctx->order[i]], ctx->value, conf->vlen);
+  }
+  uint64_t elapsed = now_ns() - begin;
+  *ops = conf->items;
+  *bytes = (uint64_t)conf->items * conf->vlen;
+  fill(conf, ctx);
+  return elapsed;
+}
+
+static uint64_t bench_update(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    dtag_set(ctx->block, ctx->keys[ctx->order[i]], ctx->value, conf->vlen);
+  }
+  *ops = conf->items;
+  *bytes = (uint64_t)conf->items * conf->vlen;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_get(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint8_t val[conf->vlen + 1];
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    uint32_t len = sizeof(val);
+    dtag_get(ctx->block, ctx->keys[ctx->order[i]], val, &len);
+  }
+  *ops = conf->items;
+  *bytes = (uint64_t)conf->items * conf->vlen;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_get_k(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint8_t val[conf->vlen + 1];
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    uint32_t len = sizeof(val);
+    dtag_get_k(ctx->block, &ctx->prepared[ctx->order[i]], val, &len);
+  }
+  *ops = conf->items;
+  *bytes = (uint64_t)conf->items * conf->vlen;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_get_slot(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  ditem_t *item = NULL;
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    dtag_get_slot(ctx->block, ctx->order[i], &item);
+  }
+  *ops = conf->items;
+  *bytes = 0;
+  return now_ns() - begin;
+}
+
+/* 1/16 的 key 承担全部查找，且均为最后写入（线性查找时最慢）；`optimize` 时先采样并重排 */
+static uint64_t get_skewed(const bench_conf_t *conf, bench_ctx_t *ctx, int optimize, uint64_t *ops, uint64_t *bytes) {
+  uint8_t val[conf->vlen + 1];
+  uint32_t hot = conf->items > 16 ? conf->items / 16 : 1;
+  dheat_t *heat = NULL;
+  if (optimize && dtag_heat_new(&heat, 1) == DTAG_OK) {
+    dtag_heat_bind(heat);
+    for (uint32_t i = 0; i < hot; i++)
+      dtag_get(ctx->block, ctx->keys[conf->items - 1 - i], NULL, NULL);
+    dtag_heat_bind(NULL);
+    dtag_optimize(ctx->block, heat);
+    dtag_heat_free(heat);
+  }
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    uint32_t len = sizeof(val);
+    dtag_get(ctx->block, ctx->keys[conf->items - 1 - ctx->order[i] % hot], val, &len);
+  }
+  uint64_t elapsed = now_ns() - begin;
+  *ops = conf->items;
+  *bytes = (uint64_t)conf->items * conf->vlen;
+  if (optimize)
+    fill(conf, ctx);
+  return elapsed;
+}
+
+static uint64_t bench_get_skew(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  return get_skewed(conf, ctx, 0, ops, bytes);
+}
+
+static uint64_t bench_get_hot(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  return get_skewed(conf, ctx, 1, ops, bytes);
+}
+
+static uint64_t bench_miss(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    dtag_get(ctx->block, ctx->misses[i], NULL, NULL);
+  }
+  *ops = conf->items;
+  *bytes = 0;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_del(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint64_t begin = now_ns();
+  for (uint32_t i = 0; i < conf->items; i++) {
+    dtag_del(ctx->block, ctx->keys[ctx->order[i]]);
+  }
+  uint64_t elapsed = now_ns() - begin;
+  *ops = conf->items;
+  *bytes = 0;
+  fill(conf, ctx);
+  return elapsed;
+}
+
+static uint64_t bench_iterate(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint64_t begin = now_ns();
+  for (ditem_t *curr = NULL;;) {
+    if (dtag_next(ctx->block, &curr) != DTAG_OK || !curr)
+      break;
+  }
+  *ops = conf->items;
+  *bytes = ctx->block->length;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_complete(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint64_t begin = now_ns();
+  dtag_complete(ctx->block);
+  *ops = 1;
+  *bytes = ctx->block->length;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_import(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  dblock_t *block = NULL;
+  uint64_t begin = now_ns();
+  dtag_import(&block, ctx->buf, ctx->size);
+  *ops = 1;
+  *bytes = ctx->block->length;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_export_file(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  uint64_t begin = now_ns();
+  dtag_export_file(ctx->block, ctx->path);
+  *ops = 1;
+  *bytes = ctx->size;
+  return now_ns() - begin;
+}
+
+static uint64_t bench_import_file(const bench_conf_t *conf, bench_ctx_t *ctx, uint64_t *ops, uint64_t *bytes) {
+  dblock_t *block = NULL;
+  uint64_t begin = now_ns();
+  if (dtag_import_file(&block, ctx->path) == DTAG_OK)
+    free(block);
+  *ops = 1;
+  *bytes = ctx->size;
+  return now_ns() - begin;
+}
+
+static const struct {
+  const char *name;
+  bench_f f;
+  uint32_t need_flags;
+} g_benches[] = {
+    {"set", bench_set, 0},
+    {"update", bench_update, 0},
+    {"get", bench_get, 0},
+    {"get_k", bench_get_k, 0},
+    {"get_slot", bench_get_slot, DTAG_FLAG_SCHEMA},
+    {"get_skew", bench_get_skew, 0},
+    {"get_hot", bench_get_hot, 0},
+    {"get_miss", bench_miss, 0},
+    {"del", bench_del, 0},
+    {"iterate", bench_iterate, 0},
+    {"complete", bench_complete, 0},
+    {"import", bench_import, 0},
+    {"export_file", bench_export_file, 0},
+    {"import_file", bench_import_file, 0},
+};
+
+static void report(const char *name, const bench_conf_t *conf, uint64_t rounds, uint64_t ops, uint64_t ns,
+                   uint64_t bytes, uint64_t allocs) {
+  double ns_op = ops ? (double)ns / ops : 0;
+  double mb_s = ns ? (double)bytes * 1000 / ns : 0;
+  double allocs_op = ops ? (double)allocs / ops : 0;
+
+  switch (g_format) {
+  case FORMAT_CSV:
+    if (g_rows == 0)
+      printf("op,flags,items,klen,vlen,capacity,rounds,ops,ns_per_op,mb_per_s,allocs_per_op\n");
+    printf("%s,%u,%u,%u,%u,%u,%lu,%lu,%.2f,%.2f,%.3f\n", name, conf->flags, conf->items, conf->klen, conf->vlen,
+           conf->capacity, rounds, ops, ns_op, mb_s, allocs_op);
+    break;
+  case FORMAT_JSON:
+    printf("%s{\"op\":\"%s\",\"flags\":%u,\"items\":%u,\"klen\":%u,\"vlen\":%u,\"capacity\":%u,\"rounds\":%lu,"
+           "\"ops\":%lu,\"ns_per_op\":%.2f,\"mb_per_s\":%.2f,\"allocs_per_op\":%.3f}",
+           g_rows ? ",\n  " : "[\n  ", name, conf->flags, conf->items, conf->klen, conf->vlen, conf->capacity, rounds,
+           ops, ns_op, mb_s, allocs_op);
+    break;
+  default:
+    if (g_rows == 0)
+      printf("%-12s %5s %6s %4s %6s %9s %12s %10s %8s\n", "op", "flags", "items", "klen", "vlen", "capacity", "ns/op",
+             "MB/s", "allocs");
+    printf("%-12s %5x %6u %4u %6u %9u %12.2f %10.2f %8.3f\n", name, conf->flags, conf->items, conf->klen, conf->vlen,
+           conf->capacity, ns_op, mb_s, allocs_op);
+    break;
+  }
+  g_rows++;
+}
+
+/* `list` 为逗号分隔的操作名 */
+static int match(const char *list, const char *name) {
+  size_t len = strlen(name);
+  for (const char *p = list; (p = strstr(p, name)); p += len) {
+    if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+      return 1;
+  }
+  return 0;
+}
+
+static void run(const bench_conf_t *conf, const char *filter) {
+  bench_ctx_t ctx = {0};
+  char path[64];
+
+  snprintf(path, sizeof(path), "/tmp/bench_dtag.%d", getpid());
+  ctx.path = path;
+  ctx.size = conf->capacity + sizeof(dblock_t);
+  ctx.buf = (uint8_t *)malloc(ctx.size);
+  ctx.keys = malloc(sizeof(*ctx.keys) * conf->items);
+  ctx.misses = malloc(sizeof(*ctx.misses) * conf->items);
+  ctx.prepared = malloc(sizeof(*ctx.prepared) * conf->items);
+  ctx.order = malloc(sizeof(*ctx.order) * conf->items);
+  ctx.value = malloc(conf->vlen + 1);
+  if (!ctx.buf || !ctx.keys || !ctx.misses || !ctx.prepared || !ctx.order || !ctx.value) {
+    fprintf(stderr, "fail to allocate memory\n");
+    exit(EXIT_FAILURE);
+  }
+  for (uint32_t i = 0; i < conf->items; i++) {
+    snprintf(ctx.keys[i], DTAG_MAX_KLEN, "k%0*u", conf->klen - 1, i);
+    snprintf(ctx.misses[i], DTAG_MAX_KLEN, "m%0*u", conf->klen - 1, i);
+    dtag_key_prepare(&ctx.prepared[i], ctx.keys[i]);
+    ctx.order[i] = i;
+  }
+  /* 固定种子的乱序，避免按插入顺序访问 */
+  srand(conf->items);
+  for (uint32_t i = conf->items; i > 1; i--) {
+    uint32_t j = rand() % i, t = ctx.order[i - 1];
+    ctx.order[i - 1] = ctx.order[j];
+    ctx.order[j] = t;
+  }
+  memset(ctx.value, 0xA5, conf->vlen + 1);
+  fill(conf, &ctx);
+  dtag_export_file(ctx.block, ctx.path);
+
+  for (uint32_t b = 0; b < sizeof(g_benches) / sizeof(g_benches[0]); b++) {
+    if ((g_benches[b].need_flags & conf->flags) != g_benches[b].need_flags)
+      continue;
+    if (filter && !match(filter, g_benches[b].name))
+      continue;
+    uint64_t rounds = 0, ops = 0, ns = 0, bytes = 0, allocs = g_allocs;
+    do {
+      uint64_t _ops = 0, _bytes = 0;
+      ns += g_benches[b].f(conf, &ctx, &_ops, &_bytes);
+      ops += _ops;
+      bytes += _bytes;
+      rounds++;
+    } while (ns < g_min_ns);
+    report(g_benches[b].name, conf, rounds, ops, ns, bytes, g_allocs - allocs);
+  }
+
+  unlink(ctx.path);
+  free(ctx.value);
+  free(ctx.order);
+  free(ctx.prepared);
+  free(ctx.misses);
+  free(ctx.keys);
+  free(ctx.buf);
+}
+
+static uint32_t parse_list(const char *str, uint32_t *list, uint32_t capa) {
+  uint32_t n = 0;
+  for (char *end = NULL; *str && n < capa; str = end + (*end == ',')) {
+    list[n++] = strtoul(str, &end, 0);
+    if (end == str)
+      break;
+  }
+  return n;
+}
+
+static void print_usage(const char *prog_name) {
+  printf("Usage: %s [options]\n", prog_name);
+  printf("Options:\n");
+  printf("  -f {text|csv|json}  - Output format (default text)\n");
+  printf("  -t {ms}             - Minimum time per case (default 20)\n");
+  printf("  -n {n,...}          - Item counts (default 16,256,4096)\n");
+  printf("  -k {n,...}          - Key lengths (default 8,32)\n");
+  printf("  -v {n,...}          - Value lengths (default 8,256)\n");
+  printf("  -F {flags,...}      - Block flags (default 0,1,2,3,4)\n");
+  printf("  -o {op,...}         - Only run the given operations\n");
+  printf("Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.\n");
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t items[16] = {16, 256, 4096}, nitems = 3;
+  uint32_t klens[16] = {8, 32}, nklens = 2;
+  uint32_t vlens[16] = {8, 256}, nvlens = 2;
+  uint32_t flags[16] = {0, DTAG_FLAG_SORTED, DTAG_FLAG_BLOOM, DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM, DTAG_FLAG_SCHEMA};
+  uint32_t nflags = 5;
+  const char *filter = NULL;
+
+  for (int opt; (opt = getopt(argc, argv, "f:t:n:k:v:F:o:h")) != -1;) {
+    switch (opt) {
+    case 'f':
+      g_format = !strcmp(optarg, "csv") ? FORMAT_CSV : !strcmp(optarg, "json") ? FORMAT_JSON : FORMAT_TEXT;
+      break;
+    case 't':
+      g_min_ns = strtoull(optarg, NULL, 0) * 1000 * 1000;
+      break;
+    case 'n':
+      nitems = parse_list(optarg, items, 16);
+      break;
+    case 'k':
+      nklens = parse_list(optarg, klens, 16);
+      break;
+    case 'v':
+      nvlens = parse_list(optarg, vlens, 16);
+      break;
+    case 'F':
+      nflags = parse_list(optarg, flags, 16);
+      break;
+    case 'o':
+      filter = optarg;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  for (uint32_t f = 0; f < nflags; f++) {
+    for (uint32_t n = 0; n < nitems; n++) {
+      for (uint32_t k = 0; k < nklens; k++) {
+        for (uint32_t v = 0; v < nvlens; v++) {
+          bench_conf_t conf = {flags[f], items[n], klens[k], vlens[v], 0};
+          if (conf.items == 0 || conf.klen < 2 || conf.klen >= DTAG_MAX_KLEN || conf.vlen > DTAG_MAX_VLEN) {
+            fprintf(stderr, "invalid case: items %u klen %u vlen %u\n", conf.items, conf.klen, conf.vlen);
+            return EXIT_FAILURE;
+          }
+          /* 每个 `ditem` 额外预留偏移表与槽位表的空间 */
+          uint64_t capacity = (uint64_t)conf.items * (sizeof(ditem_t) + conf.klen + 1 + conf.vlen + 8) +
+                              DTAG_BLOOM_SIZE + 64;
+          if (capacity > UINT32_MAX - sizeof(dblock_t)) {
+            fprintf(stderr, "invalid case: capacity %lu\n", capacity);
+            return EXIT_FAILURE;
+          }
+          conf.capacity = capacity;
+          run(&conf, filter);
+        }
+      }
+    }
+  }
+  if (g_format == FORMAT_JSON)
+    printf("%s]\n", g_rows ? "\n" : "[");
+  return EXIT_SUCCESS;
+}
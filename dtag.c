@@ -23,13 +23,305 @@
  */
 
 #include "dtag.h"
+#include "dtag_heat.h"
+#include "dtag_stats.h"
+#include "dtag_trace.h"
 #include "logger/logger.h"
+#include "lz4/lz4.h"
+#include "uring/uring.h"
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-int32_t dtag_init(dblock_t **block, uint8_t *buf, uint32_t len) {
+#if defined(__DTAG_TRACE__) || defined(__DTAG_STATS__)
+#define API_ENTER(op) uint64_t _trace = dtag_trace_enter()
+#define API_LEAVE(op, key, klen, arg, aux, result) dtag_trace_leave(_trace, op, key, klen, arg, aux, result)
+#else
+#define API_ENTER(op)
+#define API_LEAVE(op, key, klen, arg, aux, result) (void)(arg)
+#endif
+
+#if defined(__DTAG_STATS__) || defined(__DTAG_USDT__)
+#define STAT_ADD(field, n) (dtag_stats_local()->field += (n))
+#else
+#define STAT_ADD(field, n)
+#endif
+#ifdef __DTAG_STATS__
+#define STAT_BEGIN(name) uint64_t name = dtag_trace_now()
+#define STAT_END(name, field) STAT_ADD(field, dtag_trace_now() - name)
+#else
+#define STAT_BEGIN(name)
+#define STAT_END(name, field)
+#endif
+
+/*
+ * USDT probe `dtag:<name>__entry` 的参数因 op 而异，`dtag:<name>__return` 的参数均为
+ * (result, items_scanned, bytes_moved)，后两者为本次调用的增量
+ */
+#ifdef __DTAG_USDT__
+#include <sys/sdt.h>
+#define PROBE_ENTER(name, ...)                                                                                         \
+  dtag_stats_t *_probe = dtag_stats_local();                                                                           \
+  uint64_t _scanned = _probe->items_scanned, _moved = _probe->bytes_moved;                                             \
+  STAP_PROBEV(dtag, name##__entry, __VA_ARGS__)
+#define PROBE_RETURN(name, result)                                                                                     \
+  STAP_PROBEV(dtag, name##__return, result, _probe->items_scanned - _scanned, _probe->bytes_moved - _moved)
+#else
+#define PROBE_ENTER(name, ...)
+#define PROBE_RETURN(name, result)
+#endif
+
+inline static uint32_t _ld32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+inline static void _st32(uint8_t *p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+
+inline static int32_t _sorted(const dblock_t *block) { return block->flags & DTAG_FLAG_SORTED; }
+inline static int32_t _bloom(const dblock_t *block) { return block->flags & DTAG_FLAG_BLOOM; }
+inline static int32_t _schema(const dblock_t *block) { return block->flags & DTAG_FLAG_SCHEMA; }
+inline static int32_t _varint(const dblock_t *block) { return block->flags & DTAG_FLAG_VARINT; }
+inline static int32_t _aligned(const dblock_t *block) { return block->flags & DTAG_FLAG_ALIGNED; }
+inline static int32_t _compress(const dblock_t *block) { return block->flags & DTAG_FLAG_COMPRESS; }
+inline static int32_t _dedup(const dblock_t *block) { return block->flags & DTAG_FLAG_DEDUP; }
+inline static int32_t _extent(const dblock_t *block) { return block->flags & DTAG_FLAG_EXTENT; }
+inline static int32_t _treehash(const dblock_t *block) { return block->flags & DTAG_FLAG_TREEHASH; }
+/* value 前附带 codec */
+inline static int32_t _codec(const dblock_t *block) {
+  return block->flags & (DTAG_FLAG_COMPRESS | DTAG_FLAG_DEDUP | DTAG_FLAG_EXTENT);
+}
+/* 互斥的特性组合 */
+inline static int32_t _conflict(uint32_t flags) {
+  return (flags & DTAG_FLAG_ALIGNED) &&
+         (flags & (DTAG_FLAG_VARINT | DTAG_FLAG_COMPRESS | DTAG_FLAG_DEDUP | DTAG_FLAG_EXTENT));
+}
+inline static uint32_t _align(uint32_t size) { return (size + DTAG_ALIGN - 1) & ~(uint32_t)(DTAG_ALIGN - 1); }
+/* `data` 头部依次为 bloom、槽位表（`nslots` 与偏移） */
+inline static uint8_t *_slots(const dblock_t *block) {
+  return (uint8_t *)block->data + (_bloom(block) ? DTAG_BLOOM_SIZE : 0);
+}
+inline static uint32_t _nslots(const dblock_t *block) { return _schema(block) ? _ld32(_slots(block)) : 0; }
+inline static uint8_t *_slot(const dblock_t *block, uint32_t slot) {
+  return _slots(block) + sizeof(uint32_t) * (slot + 1);
+}
+/* 不含 extent 区本身 */
+inline static uint32_t _head_size_n(const dblock_t *block, uint32_t nslots) {
+  uint32_t size = (_bloom(block) ? DTAG_BLOOM_SIZE : 0) + (_schema(block) ? sizeof(uint32_t) * (nslots + 1) : 0) +
+                  (_extent(block) ? sizeof(uint32_t) : 0);
+  /* 首个 `ditem` 相对 `dblock` 起始处对齐 */
+  if (_aligned(block))
+    size = _align(sizeof(dblock_t) + size) - sizeof(dblock_t);
+  return size;
+}
+/* 槽位表之后的 extent 区，`extent_size` 位于其前 */
+inline static uint8_t *_extents(const dblock_t *block) {
+  return (uint8_t *)block->data + _head_size_n(block, _nslots(block));
+}
+inline static uint32_t _extent_size(const dblock_t *block) {
+  return _extent(block) ? _ld32(_extents(block) - sizeof(uint32_t)) : 0;
+}
+inline static uint32_t _head_size(const dblock_t *block) {
+  return _head_size_n(block, _nslots(block)) + _extent_size(block);
+}
+/* 不依赖 `data` 内容即可确定的头部与尾部的最小长度 */
+inline static uint32_t _fixed_size(const dblock_t *block) {
+  return (_bloom(block) ? DTAG_BLOOM_SIZE : 0) + (_schema(block) ? sizeof(uint32_t) : 0) +
+         (_extent(block) ? sizeof(uint32_t) : 0) + (_sorted(block) ? sizeof(uint32_t) : 0) +
+         (_dedup(block) ? sizeof(uint32_t) : 0);
+}
+/* 有序 `dblock` 尾部的 `count` 与偏移表 */
+inline static uint32_t _count(const dblock_t *block) {
+  return _ld32(block->data + block->length - sizeof(uint32_t));
+}
+inline static uint32_t _tail_size(const dblock_t *block) {
+  return _sorted(block) ? sizeof(uint32_t) * (_count(block) + 1) : 0;
+}
+
+/* 去重 `dblock` 偏移表之前的 `pool_size` 与共享池 */
+inline static uint32_t _pool_size(const dblock_t *block) {
+  return _ld32(block->data + block->length - _tail_size(block) - sizeof(uint32_t));
+}
+inline static uint8_t *_pool(const dblock_t *block) {
+  return (uint8_t *)block->data + block->length - _tail_size(block) - sizeof(uint32_t) - _pool_size(block);
+}
+
+inline static uint8_t *_begin(dblock_t *block) { return block->data + _head_size(block); }
+inline static uint8_t *_table(dblock_t *block) { return block->data + block->length - _tail_size(block); }
+inline static uint8_t *_end(dblock_t *block) { return _dedup(block) ? _pool(block) : _table(block); }
+
+/* LEB128 */
+inline static uint32_t _varint_size(uint32_t value) {
+  uint32_t size = 1;
+  while (value >>= 7)
+    size++;
+  return size;
+}
+inline static uint8_t *_varint_put(uint8_t *p, uint32_t value) {
+  for (; value >= 0x80; value >>= 7)
+    *p++ = value | 0x80;
+  *p++ = value;
+  return p;
+}
+/**
+ * @brief 越过 `limit` 或超过 4 字节（足以表示 `DTAG_MAX_VLEN`）时返回 NULL
+ */
+inline static const uint8_t *_varint_get(const uint8_t *p, const uint8_t *limit, uint32_t *value) {
+  uint32_t result = 0;
+  for (uint32_t shift = 0; shift < 28 && p < limit; shift += 7) {
+    uint8_t byte = *p++;
+    result |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#define CODEC_RAW 0
+#define CODEC_LZ4 1
+#define CODEC_REF 2
+#define CODEC_EXT 3
+/* codec 与 rawlen */
+#define CODEC_HEAD_MAX (1 + sizeof(uint32_t))
+/* codec 与 entry offset */
+#define CODEC_REF_SIZE (1 + sizeof(uint32_t))
+/* codec 与 extent offset, len */
+#define CODEC_EXT_SIZE (1 + 2 * sizeof(uint32_t))
+/* 共享池条目的 refs, hash, len */
+#define POOL_ENTRY_HEAD (3 * sizeof(uint32_t))
+
+/**
+ * @brief 越过 value 前的 codec，引用共享池时转到对应的条目；原始数据时 `val` 仍指向 `dblock` 内
+ * @return codec 非法时返回 0
+ */
+inline static int32_t _view_codec(const dblock_t *block, dtag_view_t *view) {
+  if (view->vlen < 1)
+    return 0;
+  uint8_t codec = *view->val;
+  if (codec == CODEC_EXT) {
+    if (!_extent(block) || view->vlen != CODEC_EXT_SIZE)
+      return 0;
+    uint32_t off = _ld32(view->val + 1), len = _ld32(view->val + 1 + sizeof(uint32_t)), size = _extent_size(block);
+    if (off > size || len > size - off)
+      return 0;
+    view->val = _extents(block) + off;
+    view->vlen = view->rawlen = len;
+    return 1;
+  }
+  if (codec == CODEC_REF) {
+    if (!_dedup(block) || view->vlen != CODEC_REF_SIZE)
+      return 0;
+    uint32_t off = _ld32(view->val + 1), size = _pool_size(block);
+    if (off > size || size - off < POOL_ENTRY_HEAD)
+      return 0;
+    uint8_t *entry = _pool(block) + off;
+    view->val = entry + POOL_ENTRY_HEAD;
+    view->vlen = _ld32(entry + 2 * sizeof(uint32_t));
+    if (view->vlen < 1 || view->vlen > size - off - POOL_ENTRY_HEAD || *view->val == CODEC_REF)
+      return 0;
+    codec = *view->val;
+  }
+  view->val++;
+  view->rawlen = --view->vlen;
+  if (codec == CODEC_RAW)
+    return 1;
+  if (codec != CODEC_LZ4 || view->vlen < sizeof(uint32_t))
+    return 0;
+  view->rawlen = _ld32(view->val);
+  view->val += sizeof(uint32_t);
+  view->vlen -= sizeof(uint32_t);
+  return view->rawlen <= DTAG_MAX_VLEN;
+}
+
+/**
+ * @brief 将 `view` 的 value 取到 `val`（`rawlen` 字节），必要时解压
+ */
+static int32_t _view_value(const dtag_view_t *view, uint8_t *val) {
+  if (view->rawlen == view->vlen) {
+    memcpy(val, view->val, view->vlen);
+    return DTAG_OK;
+  }
+  STAT_BEGIN(begin);
+  int ret = lz4_decompress(view->val, view->vlen, val, view->rawlen);
+  STAT_END(begin, codec_nanos);
+  STAT_ADD(codec_bytes, view->rawlen);
+  if (ret) {
+    logfE("fail to decompress @%p", view->val);
+    return DTAG_ERR_DATA;
+  }
+  return DTAG_OK;
+}
+
+/**
+ * @brief 解码 `limit` 之前的 `item`，value 保持存储时的形式（含 codec）
+ * @return `item` 之后（含对齐填充）的位置；越界或长度非法时返回 NULL
+ */
+inline static uint8_t *_view_raw(const dblock_t *block, const ditem_t *item, const uint8_t *limit,
+                                 dtag_view_t *view) {
+  const uint8_t *p = (const uint8_t *)item;
+  uint32_t klen = 0, vlen = 0;
+  if (_varint(block)) {
+    if (!(p = _varint_get(p, limit, &klen)) || !(p = _varint_get(p, limit, &vlen)))
+      return NULL;
+    if (klen >= DTAG_MAX_KLEN || vlen > DTAG_MAX_VLEN)
+      return NULL;
+    view->key = (const char *)p;
+    view->klen = klen;
+  } else {
+    if (limit - p < (int64_t)sizeof(ditem_t) || item->klen == 0)
+      return NULL;
+    view->key = (const char *)item->kv;
+    view->klen = item->klen - 1;
+    /* `ditem` 本身已对齐，key 之后填充至对齐 */
+    klen = _aligned(block) ? _align(sizeof(ditem_t) + item->klen) - sizeof(ditem_t) : item->klen;
+    vlen = item->vlen;
+    p = item->kv;
+  }
+  if ((uint64_t)(limit - p) < (uint64_t)klen + vlen)
+    return NULL;
+  view->val = (uint8_t *)p + klen;
+  view->vlen = vlen;
+  view->rawlen = vlen;
+  uint8_t *end = view->val + vlen;
+  if (_aligned(block))
+    end += -(uintptr_t)(end - (const uint8_t *)block) & (DTAG_ALIGN - 1);
+  return end;
+}
+/**
+ * @brief 同 `_view_raw`，并解析 value 的 codec
+ */
+inline static uint8_t *_view(const dblock_t *block, const ditem_t *item, const uint8_t *limit, dtag_view_t *view) {
+  uint8_t *end = _view_raw(block, item, limit, view);
+  if (end && _codec(block) && !_view_codec(block, view))
+    return NULL;
+  return end;
+}
+#define ITEM_MAX (sizeof(ditem_t) + DTAG_MAX_KLEN + DTAG_MAX_VLEN + 2 * DTAG_ALIGN)
+/* `item` 的编码长度，`item` 需已校验 */
+inline static uint32_t _len(dblock_t *block, const ditem_t *item) {
+  if (!_varint(block) && !_aligned(block))
+    return sizeof(ditem_t) + item->klen + item->vlen;
+  dtag_view_t view;
+  return _view_raw(block, item, _end(block), &view) - (const uint8_t *)item;
+}
+inline static uint32_t _item_size(const dblock_t *block, uint32_t klen, uint32_t vlen) {
+  if (_varint(block))
+    return _varint_size(klen) + _varint_size(vlen) + klen + vlen;
+  if (_aligned(block))
+    return _align(_align(sizeof(ditem_t) + klen + 1) + vlen);
+  return sizeof(ditem_t) + klen + 1 + vlen;
+}
+
+static int32_t _dtag_init(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t flags, uint32_t nslots) {
+  if ((flags & ~DTAG_FLAG_MASK) || _conflict(flags)) {
+    return DTAG_ERR_FLAGS;
+  }
   if (len < sizeof(dblock_t)) {
     return DTAG_ERR_CAPACITY;
   }
@@ -39,11 +331,104 @@ int32_t dtag_init(dblock_t **block, uint8_t *buf, uint32_t len) {
   _block->version = DTAG_VERSION;
   _block->chksum_length = CHKSUM_LENGTH;
   _block->capacity = len - sizeof(dblock_t);
-  _block->length = 0;
+  _block->flags = flags;
+  if ((uint64_t)_fixed_size(_block) + sizeof(uint32_t) * (uint64_t)nslots > _block->capacity) {
+    return DTAG_ERR_CAPACITY;
+  }
+  _block->length =
+      _head_size_n(_block, nslots) + (_sorted(_block) ? sizeof(uint32_t) : 0) + (_dedup(_block) ? sizeof(uint32_t) : 0);
+  if (_block->length > _block->capacity) {
+    return DTAG_ERR_CAPACITY;
+  }
+  memset(_block->data, 0, _block->length);
+  if (_schema(_block)) {
+    _st32(_slots(_block), nslots);
+    memset(_slot(_block, 0), 0xFF, sizeof(uint32_t) * nslots);
+  }
   *block = _block;
   return DTAG_OK;
 }
 
+int32_t dtag_init_ex(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t flags) {
+  API_ENTER(DTAG_OP_INIT);
+  int32_t result = (flags & DTAG_FLAG_SCHEMA) ? DTAG_ERR_FLAGS : _dtag_init(block, buf, len, flags, 0);
+  API_LEAVE(DTAG_OP_INIT, NULL, 0, len, flags, result);
+  return result;
+}
+
+int32_t dtag_init_schema(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t flags, uint32_t nslots) {
+  API_ENTER(DTAG_OP_INIT);
+  int32_t result = _dtag_init(block, buf, len, flags | DTAG_FLAG_SCHEMA, nslots);
+  API_LEAVE(DTAG_OP_INIT, NULL, 0, len, flags | DTAG_FLAG_SCHEMA | nslots << 16, result);
+  return result;
+}
+
+int32_t dtag_init(dblock_t **block, uint8_t *buf, uint32_t len) {
+  API_ENTER(DTAG_OP_INIT);
+  int32_t result = _dtag_init(block, buf, len, 0, 0);
+  API_LEAVE(DTAG_OP_INIT, NULL, 0, len, 0, result);
+  return result;
+}
+
+/* v3 的头部，没有 `flags` */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t chksum_length;
+  uint32_t capacity;
+  uint32_t length;
+  uint8_t chksum[CHKSUM_LENGTH];
+} __attribute__((packed)) _dblock_v3_t;
+
+inline static int32_t _v3(const uint8_t *buf, uint32_t len) {
+  const _dblock_v3_t *v3 = (const _dblock_v3_t *)buf;
+  return len >= sizeof(_dblock_v3_t) && v3->magic == DTAG_MAGIC && v3->version == DTAG_VERSION_V3;
+}
+
+/**
+ * @brief 校验 `buf` 上的 v3 `dblock` 后原位升级为 `flags` 为 0 的 v4，`capacity` 按需缩小以容纳更长的头部
+ * @note 只用于导入文件时自行分配的 `buf`，校验失败时 `buf` 不变
+ */
+static int32_t _dtag_upgrade(uint8_t *buf, uint32_t len) {
+  _dblock_v3_t v3;
+  memcpy(&v3, buf, sizeof(v3));
+  if (v3.chksum_length != CHKSUM_LENGTH) {
+    return DTAG_ERR_CHKSUM_LEN;
+  }
+  if (v3.length > v3.capacity) {
+    return DTAG_ERR_LENGTH;
+  }
+  if (v3.capacity > len - sizeof(v3) || len < sizeof(dblock_t)) {
+    return DTAG_ERR_CAPACITY;
+  }
+  uint32_t capacity = len - sizeof(dblock_t) < v3.capacity ? len - sizeof(dblock_t) : v3.capacity;
+  if (v3.length > capacity) {
+    return DTAG_ERR_CAPACITY;
+  }
+#if CHKSUM_LENGTH != 0
+  /* v3 没有树形 chksum，直接校验原位置的 `data` */
+  uint8_t _chksum[CHKSUM_LENGTH];
+  STAT_BEGIN(begin);
+  chksum_compute(buf + sizeof(v3), v3.length, _chksum);
+  STAT_END(begin, chksum_nanos);
+  STAT_ADD(chksum_bytes, v3.length);
+  if (memcmp(_chksum, v3.chksum, CHKSUM_LENGTH) != 0) {
+    return DTAG_ERR_CHECKSUM;
+  }
+#endif
+  dblock_t *block = (dblock_t *)buf;
+  memmove(block->data, buf + sizeof(v3), v3.length);
+  STAT_ADD(bytes_moved, v3.length);
+  block->magic = v3.magic;
+  block->version = DTAG_VERSION;
+  block->chksum_length = v3.chksum_length;
+  block->capacity = capacity;
+  block->length = v3.length;
+  block->flags = 0;
+  memcpy(block->chksum, v3.chksum, CHKSUM_LENGTH);
+  return DTAG_OK;
+}
+
 static int32_t _dtag_import_check0(const dblock_t *block) {
   if (block->magic != DTAG_MAGIC) {
     return DTAG_ERR_MAGIC;
@@ -57,6 +442,12 @@ static int32_t _dtag_import_check0(const dblock_t *block) {
   if (block->length > block->capacity) {
     return DTAG_ERR_LENGTH;
   }
+  if ((block->flags & ~DTAG_FLAG_MASK) || _conflict(block->flags)) {
+    return DTAG_ERR_FLAGS;
+  }
+  if (block->length < _fixed_size(block)) {
+    return DTAG_ERR_LENGTH;
+  }
   return DTAG_OK;
 }
 
@@ -67,20 +458,116 @@ static int32_t _dtag_import_check1(const dblock_t *block, uint32_t len) {
   return DTAG_OK;
 }
 
-static int32_t _dtag_import_final(dblock_t **block, uint8_t *buf) {
-  dblock_t *_block = (dblock_t *)buf;
+/**
+ * @brief 检查依赖 `data` 内容的结构
+ */
+static int32_t _dtag_import_check2(const dblock_t *block) {
+  uint64_t size = _fixed_size(block) + sizeof(uint32_t) * (uint64_t)_nslots(block);
+  if (size > block->length) {
+    return DTAG_ERR_DATA;
+  }
+  if (_extent(block) && size + _extent_size(block) > block->length) {
+    return DTAG_ERR_DATA;
+  }
+  /* 此时 `_nslots` 已受 `length` 约束，`_head_size` 不会溢出 */
+  size = _head_size(block) + (_sorted(block) ? sizeof(uint32_t) : 0) + (_dedup(block) ? sizeof(uint32_t) : 0);
+  if (size > block->length) {
+    return DTAG_ERR_DATA;
+  }
+  if (_sorted(block) && (size += sizeof(uint32_t) * (uint64_t)_count(block)) > block->length) {
+    return DTAG_ERR_DATA;
+  }
+  if (_dedup(block) && size + _pool_size(block) > block->length) {
+    return DTAG_ERR_DATA;
+  }
+  return DTAG_OK;
+}
+
+#if CHKSUM_LENGTH != 0
+/* 不小于该长度时，树形 chksum 的各段由多个线程分担 */
+#define TREE_PARALLEL (4u << 20)
+#define TREE_THREADS 8
+
+/* 树形 chksum 的各段，由各线程经 `cursor` 领取 */
+typedef struct {
+  const uint8_t *data;
+  uint32_t length;
+  uint32_t chunks;
+  uint32_t cursor;
+  uint8_t (*digests)[CHKSUM_LENGTH];
+} _dtree_t;
+
+static void *_tree_worker(void *arg) {
+  _dtree_t *tree = (_dtree_t *)arg;
+  for (uint32_t i; (i = __atomic_fetch_add(&tree->cursor, 1, __ATOMIC_RELAXED)) < tree->chunks;) {
+    uint32_t off = i * DTAG_TREE_CHUNK, len = tree->length - off;
+    chksum_compute(tree->data + off, len < DTAG_TREE_CHUNK ? len : DTAG_TREE_CHUNK, tree->digests[i]);
+  }
+  return NULL;
+}
+
+/**
+ * @brief 按 `DTAG_FLAG_TREEHASH` 计算 `data` 的 chksum
+ */
+static void _dtag_chksum(const dblock_t *block, uint8_t chksum[CHKSUM_LENGTH]) {
+  if (!_treehash(block)) {
+    chksum_compute(block->data, block->length, chksum);
+    return;
+  }
+  uint32_t chunks = ((uint64_t)block->length + DTAG_TREE_CHUNK - 1) / DTAG_TREE_CHUNK;
+  /* `length` 不超过 4 GiB，各段的 chksum 至多 4096 个 */
+  uint8_t digests[chunks ? chunks : 1][CHKSUM_LENGTH];
+  _dtree_t tree = {block->data, block->length, chunks, 0, digests};
+  pthread_t threads[TREE_THREADS - 1];
+  uint32_t nthreads = 0;
+  if (block->length >= TREE_PARALLEL) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t want = cpus > TREE_THREADS ? TREE_THREADS : (cpus > 1 ? cpus : 1);
+    if (want > chunks)
+      want = chunks;
+    /* 当前线程同样参与；创建失败时由已有的线程完成 */
+    while (nthreads + 1 < want && !pthread_create(&threads[nthreads], NULL, _tree_worker, &tree))
+      nthreads++;
+  }
+  _tree_worker(&tree);
+  for (uint32_t i = 0; i < nthreads; i++)
+    pthread_join(threads[i], NULL);
+  chksum_compute(digests[0], chunks * CHKSUM_LENGTH, chksum);
+}
+#endif
+
+static int32_t _dtag_verify(const dblock_t *block) {
 #if CHKSUM_LENGTH != 0
   uint8_t _chksum[CHKSUM_LENGTH];
-  chksum_compute(_block->data, _block->length, _chksum);
-  if (memcmp(_chksum, _block->chksum, CHKSUM_LENGTH) != 0) {
+  STAT_BEGIN(begin);
+  _dtag_chksum(block, _chksum);
+  STAT_END(begin, chksum_nanos);
+  STAT_ADD(chksum_bytes, block->length);
+  if (memcmp(_chksum, block->chksum, CHKSUM_LENGTH) != 0) {
     return DTAG_ERR_CHECKSUM;
   }
 #endif
-  *block = _block;
   return DTAG_OK;
 }
 
-int32_t dtag_import(dblock_t **block, uint8_t *buf, uint32_t len) {
+static int32_t _dtag_verify_items(dblock_t *block, uint32_t *offsets, uint32_t *count);
+
+static int32_t _dtag_import_final(dblock_t **block, uint8_t *buf, uint32_t mode) {
+  dblock_t *_block = (dblock_t *)buf;
+  int32_t result = DTAG_OK;
+
+  if (result == DTAG_OK && (mode & DTAG_VERIFY_FULL))
+    result = _dtag_verify(_block);
+  if (result == DTAG_OK)
+    result = _dtag_import_check2(_block);
+  if (result == DTAG_OK && (mode & DTAG_VERIFY_STRUCTURE))
+    result = _dtag_verify_items(_block, NULL, NULL);
+  if (result == DTAG_OK)
+    *block = _block;
+  return result;
+}
+
+static int32_t _dtag_import(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t mode) {
   if (len < sizeof(dblock_t)) {
     return DTAG_ERR_CAPACITY;
   }
@@ -92,22 +579,87 @@ int32_t dtag_import(dblock_t **block, uint8_t *buf, uint32_t len) {
   if (result == DTAG_OK)
     result = _dtag_import_check1(_block, len);
   if (result == DTAG_OK)
-    result = _dtag_import_final(block, buf);
+    result = _dtag_import_final(block, buf, mode);
+
+  return result;
+}
+
+int32_t dtag_import(dblock_t **block, uint8_t *buf, uint32_t len) {
+  API_ENTER(DTAG_OP_IMPORT);
+  PROBE_ENTER(import, buf, len);
+  int32_t result = _dtag_import(block, buf, len, DTAG_VERIFY_FULL);
+  PROBE_RETURN(import, result);
+  API_LEAVE(DTAG_OP_IMPORT, NULL, 0, len, result == DTAG_OK ? (*block)->flags : 0, result);
+  return result;
+}
+
+int32_t dtag_import_ex(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t mode) {
+  API_ENTER(DTAG_OP_IMPORT);
+  PROBE_ENTER(import, buf, len);
+  int32_t result = (mode & ~(DTAG_VERIFY_FULL | DTAG_VERIFY_STRUCTURE)) ? DTAG_ERR_INVPARAM
+                                                                         : _dtag_import(block, buf, len, mode);
+  PROBE_RETURN(import, result);
+  API_LEAVE(DTAG_OP_IMPORT, NULL, 0, len, result == DTAG_OK ? (*block)->flags : 0, result);
+  return result;
+}
+
+int32_t dtag_verify(const dblock_t *block) { return _dtag_verify(block); }
+
+struct dtag_verify {
+  pthread_t thread;
+  const dblock_t *block;
+  int32_t result;
+};
+
+static void *_verify_thread(void *arg) {
+  dverify_t *verify = (dverify_t *)arg;
+  verify->result = _dtag_verify(verify->block);
+  return NULL;
+}
+
+int32_t dtag_verify_start(dverify_t **verify, const dblock_t *block) {
+  dverify_t *_verify = (dverify_t *)malloc(sizeof(dverify_t));
+  if (!_verify) {
+    return DTAG_ERR_NOMEM;
+  }
+  _verify->block = block;
+  _verify->result = DTAG_OK;
+  if (pthread_create(&_verify->thread, NULL, _verify_thread, _verify)) {
+    logfE("fail to create verify thread @%p", block);
+    free(_verify);
+    return DTAG_ERR_NOMEM;
+  }
+  *verify = _verify;
+  return DTAG_OK;
+}
 
+int32_t dtag_verify_wait(dverify_t *verify) {
+  pthread_join(verify->thread, NULL);
+  int32_t result = verify->result;
+  free(verify);
   return result;
 }
 
 void dtag_complete(dblock_t *block) {
+  API_ENTER(DTAG_OP_COMPLETE);
+  PROBE_ENTER(complete, block, block->length);
 #if CHKSUM_LENGTH != 0
-  chksum_compute(block->data, block->length, block->chksum);
+  STAT_BEGIN(begin);
+  _dtag_chksum(block, block->chksum);
+  STAT_END(begin, chksum_nanos);
+  STAT_ADD(chksum_bytes, block->length);
 #endif
+  PROBE_RETURN(complete, DTAG_OK);
+  API_LEAVE(DTAG_OP_COMPLETE, NULL, 0, block->length, 0, DTAG_OK);
 }
 
-int32_t dtag_import_file(dblock_t **block, const char *filename) {
+static int32_t _dtag_import_file(dblock_t **block, const char *filename) {
   int32_t result = DTAG_OK;
   FILE *file = NULL;
   dblock_t _block;
   uint8_t *buf = NULL;
+  /* v3 的头部短 4 字节，已读入的头部包含 `data` 的前 4 字节 */
+  uint32_t v3 = 0, rest = 0;
 
   if (result == DTAG_OK) {
     if (!(file = fopen(filename, "rb"))) {
@@ -115,6 +667,7 @@ int32_t dtag_import_file(dblock_t **block, const char *filename) {
       result = DTAG_ERR_FILEIO;
     }
   }
+  STAT_BEGIN(begin);
   if (result == DTAG_OK) {
     if (fread(&_block, 1, sizeof(dblock_t), file) != sizeof(dblock_t)) {
       logfE("fail to read file: %s,%lu", filename, sizeof(dblock_t));
@@ -122,7 +675,10 @@ int32_t dtag_import_file(dblock_t **block, const char *filename) {
     }
   }
   if (result == DTAG_OK) {
-    result = _dtag_import_check0(&_block);
+    v3 = _v3((const uint8_t *)&_block, sizeof(_block));
+    result = v3 ? (_block.capacity < sizeof(dblock_t) - sizeof(_dblock_v3_t) ? DTAG_ERR_CAPACITY : DTAG_OK)
+                : _dtag_import_check0(&_block);
+    rest = _block.capacity - (v3 ? sizeof(dblock_t) - sizeof(_dblock_v3_t) : 0);
     if (result != DTAG_OK) {
       logfE("fail to check0 file: %s (%d)", filename, result);
     }
@@ -135,13 +691,19 @@ int32_t dtag_import_file(dblock_t **block, const char *filename) {
   }
   if (result == DTAG_OK) {
     memcpy(buf, &_block, sizeof(dblock_t));
-    if (fread(buf + sizeof(dblock_t), 1, _block.capacity, file) != _block.capacity) {
-      logfE("fail to read file: %s,%d", filename, _block.capacity);
+    if (fread(buf + sizeof(dblock_t), 1, rest, file) != rest) {
+      logfE("fail to read file: %s,%d", filename, rest);
       result = DTAG_ERR_FILEIO;
     }
+    STAT_END(begin, fileio_nanos);
+    STAT_ADD(fileio_bytes, sizeof(dblock_t) + rest);
+  }
+  if (result == DTAG_OK && v3) {
+    result = _dtag_upgrade(buf, _block.capacity + sizeof(dblock_t));
   }
   if (result == DTAG_OK) {
-    result = _dtag_import_final(block, buf);
+    /* 升级前已校验 chksum */
+    result = _dtag_import_final(block, buf, v3 ? 0 : DTAG_VERIFY_FULL);
     if (result != DTAG_OK) {
       logfE("fail to final file: %s (%d)", filename, result);
     }
@@ -156,7 +718,17 @@ int32_t dtag_import_file(dblock_t **block, const char *filename) {
   return result;
 }
 
-int32_t dtag_export_file(dblock_t *block, const char *filename) {
+int32_t dtag_import_file(dblock_t **block, const char *filename) {
+  API_ENTER(DTAG_OP_IMPORT_FILE);
+  PROBE_ENTER(import_file, filename);
+  int32_t result = _dtag_import_file(block, filename);
+  PROBE_RETURN(import_file, result);
+  API_LEAVE(DTAG_OP_IMPORT_FILE, NULL, 0, result == DTAG_OK ? (*block)->capacity + sizeof(dblock_t) : 0,
+            result == DTAG_OK ? (*block)->flags : 0, result);
+  return result;
+}
+
+static int32_t _dtag_export_file(dblock_t *block, const char *filename) {
   FILE *file = NULL;
   uint32_t len = 0;
 
@@ -166,145 +738,2151 @@ int32_t dtag_export_file(dblock_t *block, const char *filename) {
     return DTAG_ERR_FILEIO;
   }
   len = block->capacity + sizeof(dblock_t);
+  STAT_BEGIN(begin);
   if (fwrite(block, 1, len, file) != len) {
     logfE("fail to write file: %s,%d", filename, len);
     fclose(file);
     return DTAG_ERR_FILEIO;
   }
   fclose(file);
+  STAT_END(begin, fileio_nanos);
+  STAT_ADD(fileio_bytes, len);
   return DTAG_OK;
 }
 
-inline static uint32_t _len(const ditem_t *item) { return sizeof(ditem_t) + item->klen + item->vlen; }
-inline static ditem_t *_next(ditem_t *curr) { return (ditem_t *)((uint8_t *)curr + _len(curr)); }
-inline static uint8_t *_begin(dblock_t *block) { return block->data; }
-inline static uint8_t *_end(dblock_t *block) { return block->data + block->length; }
+int32_t dtag_export_file(dblock_t *block, const char *filename) {
+  API_ENTER(DTAG_OP_EXPORT_FILE);
+  PROBE_ENTER(export_file, block, filename);
+  int32_t result = _dtag_export_file(block, filename);
+  PROBE_RETURN(export_file, result);
+  API_LEAVE(DTAG_OP_EXPORT_FILE, NULL, 0, block->capacity + sizeof(dblock_t), block->flags, result);
+  return result;
+}
+
+/* 批量文件读写时，同时在途的请求数上限 */
+#define DTAG_URING_DEPTH 64
+
+/* 批量文件读写中单个文件的状态，每段传输为 `buf` 上 `len` 字节 */
+typedef struct {
+  const char *filename;
+  int fd;
+  int write;
+  int reported;
+  int32_t result;
+  uint8_t *buf;
+  uint64_t off;
+  uint32_t len;
+  uint32_t done;
+  /* 导入时先读头部，校验后再分配 `mem` 读取其余部分 */
+  dblock_t head;
+  uint8_t *mem;
+  dblock_t *block;
+} _dfile_t;
+
+typedef struct {
+  _dfile_t *files;
+  uint32_t count;
+  /* 一段传输完成后推进状态；返回 DTAG_OK 且重置了 `len`/`done` 时继续传输 */
+  int32_t (*step)(_dfile_t *file);
+  dtag_file_cb_t cb;
+  void *arg;
+} _dfiles_t;
+
+static int32_t _import_step(_dfile_t *file) {
+  if (!file->mem) {
+    /* v3 的头部短 4 字节，已读入的头部包含 `data` 的前 4 字节 */
+    uint32_t v3 = _v3((const uint8_t *)&file->head, sizeof(dblock_t)), extra = sizeof(dblock_t) - sizeof(_dblock_v3_t);
+    int32_t result = v3 ? (file->head.capacity < extra ? DTAG_ERR_CAPACITY : DTAG_OK) : _dtag_import_check0(&file->head);
+    if (result != DTAG_OK) {
+      logfE("fail to check0 file: %s (%d)", file->filename, result);
+      return result;
+    }
+    if (!(file->mem = (uint8_t *)malloc(file->head.capacity + sizeof(dblock_t)))) {
+      logfE("fail to allocate memory: %lu", file->head.capacity + sizeof(dblock_t));
+      return DTAG_ERR_NOMEM;
+    }
+    memcpy(file->mem, &file->head, sizeof(dblock_t));
+    file->buf = file->mem + sizeof(dblock_t);
+    file->off = sizeof(dblock_t);
+    file->len = file->head.capacity - (v3 ? extra : 0);
+    file->done = 0;
+    /* 其余部分为空时不会再有传输完成，直接完成导入 */
+    return file->len ? DTAG_OK : _import_step(file);
+  }
+  uint32_t len = file->head.capacity + sizeof(dblock_t), v3 = _v3(file->mem, len);
+  int32_t result = v3 ? _dtag_upgrade(file->mem, len) : DTAG_OK;
+  if (result == DTAG_OK)
+    result = _dtag_import_final(&file->block, file->mem, v3 ? 0 : DTAG_VERIFY_FULL);
+  if (result != DTAG_OK)
+    logfE("fail to final file: %s (%d)", file->filename, result);
+  return result;
+}
+
+static int32_t _export_step(_dfile_t *file) { return DTAG_OK; }
+
+inline static int32_t _dfile_busy(const _dfile_t *file) { return file->result == DTAG_OK && file->done < file->len; }
+
+/* 文件结束（成功或失败）时关闭并回调，每个文件只回调一次 */
+static void _dfile_settle(_dfiles_t *ctx, _dfile_t *file) {
+  if (file->reported || _dfile_busy(file))
+    return;
+  file->reported = 1;
+  if (file->fd >= 0 && close(file->fd) && file->result == DTAG_OK) {
+    logfE("fail to close file: %s (%d:%s)", file->filename, errno, strerror(errno));
+    file->result = DTAG_ERR_FILEIO;
+  }
+  file->fd = -1;
+  if (file->result != DTAG_OK && file->mem) {
+    free(file->mem);
+    file->mem = NULL;
+    file->block = NULL;
+  }
+  if (ctx->cb)
+    ctx->cb(file - ctx->files, file->block, file->result, ctx->arg);
+}
+
+/* 记录一段读写的结果 `res`（字节数或 -errno），该段完成时推进状态 */
+static void _dfile_complete(_dfiles_t *ctx, _dfile_t *file, int32_t res) {
+  if (res <= 0) {
+    logfE("fail to %s file: %s,%u (%d)", file->write ? "write" : "read", file->filename, file->len - file->done, res);
+    file->result = DTAG_ERR_FILEIO;
+    return;
+  }
+  STAT_ADD(fileio_bytes, res);
+  file->done += res;
+  if (file->done == file->len)
+    file->result = ctx->step(file);
+}
+
+static void _dfile_sync(_dfiles_t *ctx, _dfile_t *file) {
+  while (_dfile_busy(file)) {
+    uint8_t *buf = file->buf + file->done;
+    uint32_t len = file->len - file->done;
+    ssize_t n = file->write ? pwrite(file->fd, buf, len, file->off + file->done)
+                            : pread(file->fd, buf, len, file->off + file->done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    _dfile_complete(ctx, file, n < 0 ? -errno : n);
+  }
+}
+
+inline static int _dfile_prep(uring_t *ring, _dfile_t *file, uint64_t index) {
+  return uring_prep(ring, file->write, file->fd, file->buf + file->done, file->len - file->done,
+                    file->off + file->done, index);
+}
+
+/**
+ * @brief 提交出错后，收割已提交的 `submitted` 个请求，此后内核不再访问各文件的 buffer；
+ *        尚未提交的请求被丢弃，对应的文件留给 pread/pwrite 完成
+ */
+static void _dfiles_drain(_dfiles_t *ctx, uring_t *ring, uint32_t submitted) {
+  uint64_t index;
+  int32_t res;
+  while (submitted) {
+    if (!uring_reap(ring, &index, &res)) {
+      int ret = uring_wait(ring);
+      if (ret) {
+        /* 无法确认哪些请求仍在途，其余未完成的文件均视为失败 */
+        logfE("fail to wait io_uring (%d)", ret);
+        for (uint32_t i = 0; i < ctx->count; i++) {
+          if (_dfile_busy(&ctx->files[i]))
+            ctx->files[i].result = DTAG_ERR_FILEIO;
+        }
+        return;
+      }
+      continue;
+    }
+    submitted--;
+    _dfile_t *file = &ctx->files[index];
+    /* 不支持的请求未传输数据，由 pread/pwrite 重做 */
+    if (res != -EINVAL)
+      _dfile_complete(ctx, file, res);
+  }
+}
+
+/* 以 io_uring 推进全部文件 */
+static void _dfiles_uring(_dfiles_t *ctx) {
+  uring_t ring;
+  uint32_t depth = ctx->count < DTAG_URING_DEPTH ? ctx->count : DTAG_URING_DEPTH;
+  if (!depth || uring_init(&ring, depth))
+    return;
+  uint32_t next = 0, inflight = 0;
+  while (next < ctx->count || inflight) {
+    for (; next < ctx->count && inflight < ring.entries; next++) {
+      _dfile_t *file = &ctx->files[next];
+      if (_dfile_busy(file) && !_dfile_prep(&ring, file, next))
+        inflight++;
+      _dfile_settle(ctx, file);
+    }
+    if (!inflight)
+      continue;
+    int ret = uring_submit(&ring, 1);
+    if (ret) {
+      logfE("fail to submit io_uring (%d)", ret);
+      _dfiles_drain(ctx, &ring, inflight - ring.queued);
+      break;
+    }
+    uint64_t index;
+    int32_t res;
+    while (uring_reap(&ring, &index, &res)) {
+      _dfile_t *file = &ctx->files[index];
+      inflight--;
+      /* 内核不支持 IORING_OP_READ/WRITE（早于 5.6）时，该文件改为同步完成 */
+      if (res == -EINVAL) {
+        _dfile_sync(ctx, file);
+      } else {
+        _dfile_complete(ctx, file, res);
+        if (_dfile_busy(file) && !_dfile_prep(&ring, file, index))
+          inflight++;
+      }
+      _dfile_settle(ctx, file);
+    }
+  }
+  uring_exit(&ring);
+}
+
+static void _dfiles_run(_dfiles_t *ctx) {
+  STAT_BEGIN(begin);
+  _dfiles_uring(ctx);
+  /* io_uring 不可用或提交出错时，余下的文件以 pread/pwrite 完成 */
+  for (uint32_t i = 0; i < ctx->count; i++) {
+    _dfile_sync(ctx, &ctx->files[i]);
+    _dfile_settle(ctx, &ctx->files[i]);
+  }
+  STAT_END(begin, fileio_nanos);
+}
+
+static int32_t _dtag_files_async(_dfiles_t *ctx, const char *const filenames[], int write, dblock_t *const blocks[]) {
+  if (!(ctx->files = (_dfile_t *)calloc(ctx->count, sizeof(_dfile_t)))) {
+    logfE("fail to allocate memory: %lu", ctx->count * sizeof(_dfile_t));
+    return DTAG_ERR_NOMEM;
+  }
+  for (uint32_t i = 0; i < ctx->count; i++) {
+    _dfile_t *file = &ctx->files[i];
+    file->filename = filenames[i];
+    file->write = write;
+    if (write) {
+      file->fd = open(filenames[i], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      file->buf = (uint8_t *)blocks[i];
+      file->len = blocks[i]->capacity + sizeof(dblock_t);
+      file->block = blocks[i];
+    } else {
+      file->fd = open(filenames[i], O_RDONLY);
+      file->buf = (uint8_t *)&file->head;
+      file->len = sizeof(dblock_t);
+    }
+    if (file->fd < 0) {
+      logfE("fail to open file: %s (%d:%s)", filenames[i], errno, strerror(errno));
+      file->result = DTAG_ERR_FILEIO;
+    }
+  }
+  _dfiles_run(ctx);
+  int32_t result = DTAG_OK;
+  for (uint32_t i = 0; i < ctx->count && result == DTAG_OK; i++)
+    result = ctx->files[i].result;
+  return result;
+}
+
+int32_t dtag_import_files_async(dblock_t *blocks[], const char *const filenames[], uint32_t count, dtag_file_cb_t cb,
+                                void *arg) {
+  API_ENTER(DTAG_OP_IMPORT_FILES);
+  PROBE_ENTER(import_files, count);
+  _dfiles_t ctx = {NULL, count, _import_step, cb, arg};
+  int32_t result = _dtag_files_async(&ctx, filenames, 0, NULL);
+  for (uint32_t i = 0; i < count; i++)
+    blocks[i] = ctx.files ? ctx.files[i].block : NULL;
+  free(ctx.files);
+  PROBE_RETURN(import_files, result);
+  API_LEAVE(DTAG_OP_IMPORT_FILES, NULL, 0, count, 0, result);
+  return result;
+}
+
+int32_t dtag_export_files_async(dblock_t *const blocks[], const char *const filenames[], uint32_t count,
+                                dtag_file_cb_t cb, void *arg) {
+  API_ENTER(DTAG_OP_EXPORT_FILES);
+  PROBE_ENTER(export_files, count);
+  _dfiles_t ctx = {NULL, count, _export_step, cb, arg};
+  int32_t result = _dtag_files_async(&ctx, filenames, 1, blocks);
+  free(ctx.files);
+  PROBE_RETURN(export_files, result);
+  API_LEAVE(DTAG_OP_EXPORT_FILES, NULL, 0, count, 0, result);
+  return result;
+}
 
 /**
  * @brief 检查地址合法性
  */
 static int32_t _dtag_ditem_check0(dblock_t *block, ditem_t *item) {
+  if (_aligned(block) && ((uint8_t *)item - (uint8_t *)block) % DTAG_ALIGN)
+    return 0;
   return _begin(block) <= (uint8_t *)item && (uint8_t *)item < _end(block);
 }
 /**
- * @brief 检查 `klen`, `vlen` 合法性
+ * @brief 检查 `klen`, `vlen` 合法性，并解码
  * @note `item != _end(block)`
  */
-static int32_t _dtag_ditem_check1(dblock_t *block, ditem_t *item) { return (uint8_t *)_next(item) <= _end(block); }
+static uint8_t *_dtag_ditem_check1(dblock_t *block, ditem_t *item, dtag_view_t *view) {
+  return _view(block, item, _end(block), view);
+}
 
-int32_t dtag_next(dblock_t *block, ditem_t **curr) {
+static int32_t _dtag_next(dblock_t *block, ditem_t **curr) {
   ditem_t *next = NULL;
+  dtag_view_t view;
 
   if (*curr) {
-    if (!_dtag_ditem_check0(block, *curr) || !_dtag_ditem_check1(block, *curr)) {
+    if (!_dtag_ditem_check0(block, *curr) || !(next = (ditem_t *)_dtag_ditem_check1(block, *curr, &view))) {
       return DTAG_ERR_INVPARAM;
     }
-    next = _next(*curr);
     if ((uint8_t *)next == _end(block)) {
       *curr = NULL;
       return 0;
     }
   } else {
-    if (block->length == 0) {
+    if (_begin(block) == _end(block)) {
       return 0;
     }
     next = (ditem_t *)_begin(block);
   }
 
-  if (!_dtag_ditem_check1(block, next)) {
-    logfE("detect error @%p klen %u vlen %u", next, next->klen, next->vlen);
+  if (!_dtag_ditem_check1(block, next, &view)) {
+    logfE("detect error @%p", next);
     return DTAG_ERR_DATA;
   }
   *curr = next;
   return 0;
 }
 
-int32_t dtag_get_inner(dblock_t *block, const char *key, ditem_t **item) {
-  uint32_t klen = strnlen(key, DTAG_MAX_KLEN);
-  if (klen == DTAG_MAX_KLEN) {
-    return DTAG_ERR_INVPARAM;
-  }
+int32_t dtag_next(dblock_t *block, ditem_t **curr) {
+  API_ENTER(DTAG_OP_NEXT);
+  uint32_t first = *curr == NULL;
+  int32_t result = _dtag_next(block, curr);
+  API_LEAVE(DTAG_OP_NEXT, NULL, 0, first, 0, result);
+  return result;
+}
 
-  for (ditem_t *curr = NULL;;) {
-    int32_t result = dtag_next(block, &curr);
-    if (result != DTAG_OK)
-      return result;
-    if (curr == NULL)
-      return DTAG_ERR_NOTFOUND;
-    if (klen != curr->klen - 1)
-      continue;
-    if (strcmp(key, (const char *)curr->kv))
-      continue;
-    if (item)
-      *item = curr;
-    break;
+void dtag_items_region(dblock_t *block, uint32_t *offset, uint32_t *length) {
+  *offset = _begin(block) - block->data;
+  *length = _end(block) - _begin(block);
+}
+
+/* FNV-1a，可分段累加 */
+static uint32_t _fnv1a(uint32_t hash, const uint8_t *p, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= DTAG_KEY_HASH_PRIME;
   }
-  return DTAG_OK;
+  return hash;
 }
 
-int32_t dtag_get(dblock_t *block, const char *key, uint8_t *val, uint32_t *len) {
+uint32_t dtag_key_hash(const char *str, uint32_t len) {
+  return _fnv1a(DTAG_KEY_HASH_BASIS, (const uint8_t *)str, len);
+}
+
+int32_t dtag_key_prepare_n(dtag_key_t *key, const char *str, uint32_t len) {
+  if (len >= DTAG_MAX_KLEN || memchr(str, '\0', len)) {
+    return DTAG_ERR_INVPARAM;
+  }
+  key->str = str;
+  key->len = len;
+  key->hash = dtag_key_hash(str, len);
+  return DTAG_OK;
+}
+
+int32_t dtag_key_prepare(dtag_key_t *key, const char *str) {
+  uint32_t len = strnlen(str, DTAG_MAX_KLEN);
+  if (len == DTAG_MAX_KLEN) {
+    return DTAG_ERR_INVPARAM;
+  }
+  return dtag_key_prepare_n(key, str, len);
+}
+
+/**
+ * @brief 为单次调用准备 `key`，仅在 `block` 需要时计算 `hash`
+ */
+static int32_t _dtag_key_n(const dblock_t *block, dtag_key_t *key, const char *str, uint32_t len) {
+  if (len >= DTAG_MAX_KLEN) {
+    return DTAG_ERR_INVPARAM;
+  }
+  key->str = str;
+  key->len = len;
+  key->hash = _bloom(block) ? dtag_key_hash(str, len) : 0;
+  return DTAG_OK;
+}
+
+static int32_t _dtag_key(const dblock_t *block, dtag_key_t *key, const char *str) {
+  return _dtag_key_n(block, key, str, strnlen(str, DTAG_MAX_KLEN));
+}
+
+/**
+ * @brief 当前线程绑定了计数表时采样 `key`
+ * @note 只在公开的 get/set/del 等接口处调用，内部的重复查找（dedup、extent、convert、patch 等）不计入
+ */
+inline static void _heat_sample(const dtag_key_t *key) {
+  if (g_dtag_heat)
+    dtag_heat_sample(key->str, key->len);
+}
+
+/**
+ * @brief 同 `_dtag_key`，成功时采样，供公开接口使用
+ */
+static int32_t _dtag_key_hot(const dblock_t *block, dtag_key_t *key, const char *str) {
+  int32_t result = _dtag_key(block, key, str);
+  if (result == DTAG_OK)
+    _heat_sample(key);
+  return result;
+}
+
+#define BLOOM_BITS (DTAG_BLOOM_SIZE * 8)
+
+/**
+ * @brief 由 `hash` 派生的第 `i` 个 bit（double hashing）
+ */
+inline static uint32_t _bloom_bit(uint32_t hash, uint32_t i) {
+  return (hash + i * ((hash >> 16 | hash << 16) | 1)) % BLOOM_BITS;
+}
+
+static void _dtag_bloom_add(dblock_t *block, uint32_t hash) {
+  for (uint32_t i = 0; i < DTAG_BLOOM_HASHES; i++) {
+    uint32_t bit = _bloom_bit(hash, i);
+    block->data[bit / 8] |= 1 << (bit % 8);
+  }
+}
+
+/**
+ * @brief 返回 0 时 key 一定不存在
+ */
+static int32_t _dtag_bloom_test(const dblock_t *block, uint32_t hash) {
+  for (uint32_t i = 0; i < DTAG_BLOOM_HASHES; i++) {
+    uint32_t bit = _bloom_bit(hash, i);
+    if (!(block->data[bit / 8] & (1 << (bit % 8))))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief 删除后 bloom 中残留的 bit 只会增加误判，此处按现存 `ditem` 重建
+ */
+static void _dtag_bloom_rebuild(dblock_t *block) {
+  memset(block->data, 0, DTAG_BLOOM_SIZE);
+  dtag_view_t view;
+  for (uint8_t *curr = _begin(block), *end = _end(block), *next; curr < end; curr = next) {
+    if (!(next = _view(block, (ditem_t *)curr, end, &view)))
+      break;
+    _dtag_bloom_add(block, dtag_key_hash(view.key, view.klen));
+  }
+}
+
+double dtag_bloom_fpr(const dblock_t *block) {
+  if (!_bloom(block)) {
+    return 1;
+  }
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < DTAG_BLOOM_SIZE; i++) {
+    bits += __builtin_popcount(block->data[i]);
+  }
+  double fill = (double)bits / BLOOM_BITS, fpr = 1;
+  for (uint32_t i = 0; i < DTAG_BLOOM_HASHES; i++) {
+    fpr *= fill;
+  }
+  return fpr;
+}
+
+/**
+ * @brief 按字节序比较 `view` 的 key 与 `key`
+ */
+static int32_t _dtag_keycmp(const dtag_view_t *view, const char *key, uint32_t klen) {
+  uint32_t ilen = view->klen;
+  int32_t result = memcmp(view->key, key, ilen < klen ? ilen : klen);
+  if (result)
+    return result;
+  return (ilen > klen) - (ilen < klen);
+}
+
+/**
+ * @brief 取有序 `dblock` 中第 `idx` 个 `ditem`，并解码到 `view`
+ * @note 会检查偏移与 `klen`, `vlen` 合法性，非法时返回 NULL
+ */
+static ditem_t *_dtag_item_at(dblock_t *block, uint32_t idx, dtag_view_t *view) {
+  uint32_t offset = _ld32(_table(block) + sizeof(uint32_t) * idx);
+  ditem_t *item = (ditem_t *)(block->data + offset);
+  if (!_dtag_ditem_check0(block, item) || !_dtag_ditem_check1(block, item, view)) {
+    logfE("detect error @%u offset %u", idx, offset);
+    return NULL;
+  }
+  return item;
+}
+
+static int _offset_cmp(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief 遍历 `ditem` 链，容量允许时将各 `ditem` 的偏移依次写入 `offsets`
+ * @return 非法时返回 DTAG_ERR_DATA
+ */
+static int32_t _dtag_walk_items(dblock_t *block, uint32_t *offsets, uint32_t capacity, uint32_t *count) {
+  uint8_t *begin = _begin(block), *end = _end(block);
+  dtag_view_t view;
+  uint32_t n = 0;
+  for (uint8_t *curr = begin, *next; curr < end; curr = next, n++) {
+    if (!_dtag_ditem_check0(block, (ditem_t *)curr) || !(next = _view(block, (ditem_t *)curr, end, &view))) {
+      logfE("detect error @%u", (uint32_t)(curr - block->data));
+      return DTAG_ERR_DATA;
+    }
+    if (n < capacity)
+      offsets[n] = curr - block->data;
+  }
+  STAT_ADD(items_scanned, n);
+  *count = n;
+  return DTAG_OK;
+}
+
+/**
+ * @brief 检查槽位表、偏移表均指向 `offsets` 中的 `ditem`，且偏移表按 key 严格递增
+ */
+static int32_t _dtag_verify_refs(dblock_t *block, const uint32_t *offsets, uint32_t count) {
+  for (uint32_t slot = 0; slot < _nslots(block); slot++) {
+    uint32_t offset = _ld32(_slot(block, slot));
+    if (offset != DTAG_SLOT_NONE && !bsearch(&offset, offsets, count, sizeof(uint32_t), _offset_cmp)) {
+      logfE("detect error @slot %u offset %u", slot, offset);
+      return DTAG_ERR_DATA;
+    }
+  }
+  if (!_sorted(block))
+    return DTAG_OK;
+  if (_count(block) != count) {
+    logfE("detect error @count %u items %u", _count(block), count);
+    return DTAG_ERR_DATA;
+  }
+  dtag_view_t prev, view;
+  for (uint32_t idx = 0; idx < count; idx++, prev = view) {
+    uint32_t offset = _ld32(_table(block) + sizeof(uint32_t) * idx);
+    if (!bsearch(&offset, offsets, count, sizeof(uint32_t), _offset_cmp) || !_dtag_item_at(block, idx, &view) ||
+        (idx && _dtag_keycmp(&prev, view.key, view.klen) >= 0)) {
+      logfE("detect error @%u offset %u", idx, offset);
+      return DTAG_ERR_DATA;
+    }
+  }
+  return DTAG_OK;
+}
+
+static int32_t _dtag_verify_items(dblock_t *block, uint32_t *offsets, uint32_t *count) {
+  uint32_t capacity = offsets ? *count : 0, n = 0;
+  int32_t result = _dtag_walk_items(block, offsets, capacity, &n);
+  uint32_t *table = offsets;
+
+  /* 槽位表、偏移表需要完整的偏移，`offsets` 不足时另行分配 */
+  if (result == DTAG_OK && n > capacity && (_schema(block) || _sorted(block))) {
+    if (!(table = (uint32_t *)malloc(sizeof(uint32_t) * n)))
+      result = DTAG_ERR_NOMEM;
+    else
+      result = _dtag_walk_items(block, table, n, &n);
+  }
+  if (result == DTAG_OK && (_schema(block) || _sorted(block)))
+    result = _dtag_verify_refs(block, table, n);
+  if (table != offsets)
+    free(table);
+  if (result == DTAG_OK && count)
+    *count = n;
+  if (result == DTAG_OK && offsets && n > capacity)
+    result = DTAG_ERR_NOSPACE;
+  return result;
+}
+
+int32_t dtag_verify_items(dblock_t *block, uint32_t *offsets, uint32_t *count) {
+  if (offsets && !count) {
+    return DTAG_ERR_INVPARAM;
+  }
+  return _dtag_verify_items(block, offsets, count);
+}
+
+/**
+ * @brief 在有序 `dblock` 中查找首个 key 不小于 `key` 的 `ditem`
+ *
+ * @param idx 返回其序号（不存在时为 `count`）
+ * @param item 返回其指针（不存在时为 NULL）
+ * @param view 存在时返回其解码结果
+ */
+static int32_t _dtag_lower_bound(dblock_t *block, const char *key, uint32_t klen, uint32_t *idx, ditem_t **item,
+                                 dtag_view_t *view) {
+  uint32_t lo = 0, hi = _count(block);
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    ditem_t *curr = _dtag_item_at(block, mid, view);
+    STAT_ADD(items_scanned, 1);
+    if (!curr)
+      return DTAG_ERR_DATA;
+    if (_dtag_keycmp(view, key, klen) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  *idx = lo;
+  *item = NULL;
+  if (lo < _count(block) && !(*item = _dtag_item_at(block, lo, view)))
+    return DTAG_ERR_DATA;
+  return DTAG_OK;
+}
+
+/**
+ * @brief 查找 `key`
+ *
+ * @param idx 有序 `dblock` 中返回其序号（未找到时为插入位置）；可以传入 NULL
+ */
+static int32_t _dtag_lookup(dblock_t *block, const dtag_key_t *key, ditem_t **item, uint32_t *idx) {
+  /* 有序 `dblock` 需要插入位置时不能跳过查找 */
+  if (_bloom(block) && !(idx && _sorted(block)) && !_dtag_bloom_test(block, key->hash)) {
+    STAT_ADD(bloom_rejects, 1);
+    return DTAG_ERR_NOTFOUND;
+  }
+  dtag_view_t view;
+  if (_sorted(block)) {
+    uint32_t _idx = 0;
+    ditem_t *curr = NULL;
+    int32_t result = _dtag_lower_bound(block, key->str, key->len, &_idx, &curr, &view);
+    if (result != DTAG_OK)
+      return result;
+    if (idx)
+      *idx = _idx;
+    if (!curr || _dtag_keycmp(&view, key->str, key->len))
+      return DTAG_ERR_NOTFOUND;
+    if (item)
+      *item = curr;
+    return DTAG_OK;
+  }
+
+  /* 直接沿链解码，每个 `ditem` 只解码一次 */
+  for (uint8_t *curr = _begin(block), *end = _end(block), *next; curr < end; curr = next) {
+    if (!(next = _view(block, (ditem_t *)curr, end, &view))) {
+      logfE("detect error @%p", curr);
+      return DTAG_ERR_DATA;
+    }
+    STAT_ADD(items_scanned, 1);
+    if (key->len != view.klen)
+      continue;
+    if (memcmp(key->str, view.key, key->len))
+      continue;
+    if (item)
+      *item = (ditem_t *)curr;
+    return DTAG_OK;
+  }
+  return DTAG_ERR_NOTFOUND;
+}
+
+int32_t dtag_get_inner_k(dblock_t *block, const dtag_key_t *key, ditem_t **item) {
+  API_ENTER(DTAG_OP_GET_INNER);
+  PROBE_ENTER(get_inner, block, key->str, key->len);
+  _heat_sample(key);
+  int32_t result = _dtag_lookup(block, key, item, NULL);
+  PROBE_RETURN(get_inner, result);
+  API_LEAVE(DTAG_OP_GET_INNER, key->str, key->len, 0, 0, result);
+  return result;
+}
+
+int32_t dtag_get_inner(dblock_t *block, const char *key, ditem_t **item) {
+  API_ENTER(DTAG_OP_GET_INNER);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  PROBE_ENTER(get_inner, block, _key.str, _key.len);
+  if (result == DTAG_OK)
+    result = _dtag_lookup(block, &_key, item, NULL);
+  PROBE_RETURN(get_inner, result);
+  API_LEAVE(DTAG_OP_GET_INNER, _key.str, _key.len, 0, 0, result);
+  return result;
+}
+
+static int32_t _dtag_get(dblock_t *block, const dtag_key_t *key, uint8_t *val, uint32_t *len) {
   if (val && !len) {
     return DTAG_ERR_INVPARAM;
   }
 
   ditem_t *item = NULL;
-  int32_t result = dtag_get_inner(block, key, &item);
+  int32_t result = _dtag_lookup(block, key, &item, NULL);
   if (result != DTAG_OK)
     return result;
 
+  dtag_view_t view;
+  _view(block, item, _end(block), &view);
   if (val) {
-    if (*len < item->vlen)
+    if (*len < view.rawlen)
       return DTAG_ERR_NOSPACE;
-    memcpy(val, &item->kv[item->klen], item->vlen);
+    if ((result = _view_value(&view, val)) != DTAG_OK)
+      return result;
   }
   if (len)
-    *len = item->vlen;
+    *len = view.rawlen;
   return DTAG_OK;
 }
 
-static void _dtag_del(dblock_t *block, ditem_t *item) {
-  uint32_t len = _len(item);
-  memmove((uint8_t *)item, (uint8_t *)_next(item), _end(block) - (uint8_t *)item - len);
-  block->length -= len;
+int32_t dtag_get_k(dblock_t *block, const dtag_key_t *key, uint8_t *val, uint32_t *len) {
+  API_ENTER(DTAG_OP_GET);
+  _heat_sample(key);
+  int32_t result = _dtag_get(block, key, val, len);
+  API_LEAVE(DTAG_OP_GET, key->str, key->len, len ? *len : 0, 0, result);
+  return result;
 }
 
-int32_t dtag_del(dblock_t *block, const char *key) {
-  ditem_t *item = NULL;
-  int32_t result = dtag_get_inner(block, key, &item);
-  if (result != DTAG_OK)
-    return result;
-  _dtag_del(block, item);
-  return DTAG_OK;
+int32_t dtag_get(dblock_t *block, const char *key, uint8_t *val, uint32_t *len) {
+  API_ENTER(DTAG_OP_GET);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  if (result == DTAG_OK)
+    result = _dtag_get(block, &_key, val, len);
+  API_LEAVE(DTAG_OP_GET, _key.str, _key.len, len ? *len : 0, 0, result);
+  return result;
 }
 
-int32_t dtag_set(dblock_t *block, const char *key, const uint8_t *val, uint32_t len) {
-  if (!val && len) {
+/**
+ * @brief 将 `view` 的 value 中自 `off` 起的至多 `*len` 字节取到 `val`，压缩的 value 需整体解压
+ */
+static int32_t _view_range(const dtag_view_t *view, uint32_t off, uint8_t *val, uint32_t *len) {
+  if (off > view->rawlen) {
     return DTAG_ERR_INVPARAM;
   }
+  uint32_t n = view->rawlen - off < *len ? view->rawlen - off : *len;
+  if (view->rawlen == view->vlen) {
+    memcpy(val, view->val + off, n);
+    *len = n;
+    return DTAG_OK;
+  }
+  uint8_t *raw = (uint8_t *)malloc(view->rawlen);
+  if (!raw) {
+    return DTAG_ERR_NOMEM;
+  }
+  int32_t result = _view_value(view, raw);
+  if (result == DTAG_OK) {
+    memcpy(val, raw + off, n);
+    *len = n;
+  }
+  free(raw);
+  return result;
+}
 
+static int32_t _dtag_get_range(dblock_t *block, const dtag_key_t *key, uint32_t off, uint8_t *val, uint32_t *len) {
   ditem_t *item = NULL;
-  int32_t result = dtag_get_inner(block, key, &item);
-  if (result != DTAG_OK && result != DTAG_ERR_NOTFOUND)
-    return result;
+  int32_t result = _dtag_lookup(block, key, &item, NULL);
+  if (result == DTAG_OK) {
+    dtag_view_t view;
+    _view(block, item, _end(block), &view);
+    result = _view_range(&view, off, val, len);
+  }
+  return result;
+}
 
-  uint32_t klen = strnlen(key, DTAG_MAX_KLEN);
-  if (item) {
-    if (block->length - item->klen - item->vlen + klen + len > block->capacity) {
-      return DTAG_ERR_CAPACITY;
+int32_t dtag_get_range(dblock_t *block, const char *key, uint32_t off, uint8_t *val, uint32_t *len) {
+  API_ENTER(DTAG_OP_GET_RANGE);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  PROBE_ENTER(get_range, block, _key.str, _key.len, off, *len);
+  if (result == DTAG_OK)
+    result = _dtag_get_range(block, &_key, off, val, len);
+  PROBE_RETURN(get_range, result);
+  API_LEAVE(DTAG_OP_GET_RANGE, _key.str, _key.len, off, result == DTAG_OK ? *len : 0, result);
+  return result;
+}
+
+static int32_t _pread_full(int fd, uint8_t *buf, uint32_t len, uint64_t off) {
+  while (len) {
+    ssize_t n = pread(fd, buf, len, off);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      logfE("fail to read file: %d,%u@%lu (%d:%s)", fd, len, off, errno, strerror(errno));
+      return DTAG_ERR_FILEIO;
+    }
+    STAT_ADD(fileio_bytes, n);
+    buf += n;
+    len -= n;
+    off += n;
+  }
+  return DTAG_OK;
+}
+
+/**
+ * @brief 读入 `data` 中 [`from`, `to`) 的部分，`to` 不超过 `length`
+ */
+inline static int32_t _pread_data(int fd, dblock_t *block, uint64_t from, uint64_t to) {
+  if (to > block->length)
+    to = block->length;
+  if (from >= to)
+    return DTAG_OK;
+  return _pread_full(fd, block->data + from, to - from, sizeof(dblock_t) + from);
+}
+
+/**
+ * @brief 读入除 extent 区以外的部分，extent 区在 `buf` 中保持未初始化
+ */
+static int32_t _dtag_pread(int fd, dblock_t *block) {
+  /* 读入 bloom 与 `nslots` 后才能确定头部（含 `extent_size`）的长度 */
+  int32_t result = _pread_data(fd, block, 0, _head_size_n(block, 0));
+  uint64_t size = _fixed_size(block) + sizeof(uint32_t) * (uint64_t)_nslots(block);
+  if (result == DTAG_OK && size > block->length)
+    result = DTAG_ERR_DATA;
+  if (result == DTAG_OK)
+    result = _pread_data(fd, block, _head_size_n(block, 0), _head_size_n(block, _nslots(block)));
+  if (result == DTAG_OK && size + _extent_size(block) > block->length)
+    result = DTAG_ERR_DATA;
+  if (result == DTAG_OK)
+    result = _pread_data(fd, block, _head_size(block), block->length);
+  if (result == DTAG_OK)
+    result = _dtag_import_check2(block);
+  return result;
+}
+
+static int32_t _dtag_get_range_file(int fd, const char *key, uint32_t off, uint8_t *val, uint32_t *len) {
+  dblock_t head;
+  uint8_t *buf = NULL;
+  int32_t result = _pread_full(fd, (uint8_t *)&head, sizeof(head), 0);
+  if (result == DTAG_OK)
+    result = _dtag_import_check0(&head);
+  /* 未读入的 extent 区不会被访问，较大的分配通常不占用物理内存 */
+  if (result == DTAG_OK && !(buf = (uint8_t *)malloc(sizeof(dblock_t) + (size_t)head.length)))
+    result = DTAG_ERR_NOMEM;
+  dblock_t *block = (dblock_t *)buf;
+  if (result == DTAG_OK) {
+    memcpy(buf, &head, sizeof(head));
+    result = _dtag_pread(fd, block);
+  }
+
+  dtag_key_t _key = {0};
+  ditem_t *item = NULL;
+  if (result == DTAG_OK)
+    result = _dtag_key(block, &_key, key);
+  if (result == DTAG_OK)
+    result = _dtag_lookup(block, &_key, &item, NULL);
+  dtag_view_t view;
+  if (result == DTAG_OK && !_view(block, item, _end(block), &view))
+    result = DTAG_ERR_DATA;
+  if (result == DTAG_OK && view.val >= _extents(block) && view.val < _begin(block)) {
+    if (off > view.rawlen) {
+      result = DTAG_ERR_INVPARAM;
+    } else {
+      uint32_t n = view.rawlen - off < *len ? view.rawlen - off : *len;
+      result = _pread_full(fd, val, n, sizeof(dblock_t) + (view.val - block->data) + (uint64_t)off);
+      if (result == DTAG_OK)
+        *len = n;
     }
-    _dtag_del(block, item);
+  } else if (result == DTAG_OK) {
+    result = _view_range(&view, off, val, len);
+  }
+  free(buf);
+  return result;
+}
+
+int32_t dtag_get_range_file(const char *filename, const char *key, uint32_t off, uint8_t *val, uint32_t *len) {
+  API_ENTER(DTAG_OP_GET_RANGE_FILE);
+  PROBE_ENTER(get_range_file, filename, key, off, *len);
+  int32_t result = DTAG_ERR_FILEIO;
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    logfE("fail to open file: %s (%d:%s)", filename, errno, strerror(errno));
   } else {
-    if (block->length + sizeof(ditem_t) + klen + len > block->capacity) {
-      return DTAG_ERR_CAPACITY;
+    STAT_BEGIN(begin);
+    result = _dtag_get_range_file(fd, key, off, val, len);
+    STAT_END(begin, fileio_nanos);
+    close(fd);
+  }
+  PROBE_RETURN(get_range_file, result);
+  API_LEAVE(DTAG_OP_GET_RANGE_FILE, key, strnlen(key, DTAG_MAX_KLEN), off, result == DTAG_OK ? *len : 0, result);
+  return result;
+}
+
+/**
+ * @brief 调整有序 `dblock` 偏移表中 `idx` 之后的偏移
+ */
+static void _dtag_table_shift(dblock_t *block, uint32_t idx, int32_t delta) {
+  uint8_t *table = _table(block);
+  for (uint32_t i = idx; i < _count(block); i++) {
+    uint8_t *p = table + sizeof(uint32_t) * i;
+    _st32(p, _ld32(p) + delta);
+  }
+}
+
+/**
+ * @brief 在有序 `dblock` 偏移表的 `idx` 处插入 `offset`
+ * @note 调用者需保证剩余容量
+ */
+static void _dtag_table_insert(dblock_t *block, uint32_t idx, uint32_t offset) {
+  uint32_t count = _count(block);
+  uint8_t *table = _table(block);
+  memmove(table + sizeof(uint32_t) * (idx + 1), table + sizeof(uint32_t) * idx, sizeof(uint32_t) * (count - idx + 1));
+  STAT_ADD(bytes_moved, sizeof(uint32_t) * (count - idx + 1));
+  _st32(table + sizeof(uint32_t) * idx, offset);
+  block->length += sizeof(uint32_t);
+  _st32(block->data + block->length - sizeof(uint32_t), count + 1);
+}
+
+/**
+ * @brief 移除有序 `dblock` 偏移表的 `idx` 处
+ */
+static void _dtag_table_remove(dblock_t *block, uint32_t idx) {
+  uint32_t count = _count(block);
+  uint8_t *table = _table(block);
+  memmove(table + sizeof(uint32_t) * idx, table + sizeof(uint32_t) * (idx + 1), sizeof(uint32_t) * (count - idx));
+  STAT_ADD(bytes_moved, sizeof(uint32_t) * (count - idx));
+  block->length -= sizeof(uint32_t);
+  _st32(block->data + block->length - sizeof(uint32_t), count - 1);
+}
+
+#define SLOT_NONE DTAG_SLOT_NONE
+/* 替换 `ditem` 期间的临时标记 */
+#define SLOT_MOVING (DTAG_SLOT_NONE - 1)
+
+/**
+ * @brief `offset` 处的 `ditem` 长度由 `old_len` 调整为 `new_len` 后，修正槽位表
+ * @note `new_len` 为 0 表示删除，指向它的槽位被清空
+ */
+static void _dtag_slots_shift(dblock_t *block, uint32_t offset, uint32_t old_len, uint32_t new_len) {
+  for (uint32_t i = 0; i < _nslots(block); i++) {
+    uint32_t curr = _ld32(_slot(block, i));
+    if (curr >= SLOT_MOVING)
+      continue;
+    if (curr == offset && new_len == 0)
+      _st32(_slot(block, i), SLOT_NONE);
+    else if (curr > offset || (curr == offset && old_len == 0))
+      _st32(_slot(block, i), curr - old_len + new_len);
+  }
+}
+
+/**
+ * @brief 将指向 `from` 的槽位改为指向 `to`
+ */
+static void _dtag_slots_rebind(dblock_t *block, uint32_t from, uint32_t to) {
+  for (uint32_t i = 0; i < _nslots(block); i++) {
+    if (_ld32(_slot(block, i)) == from)
+      _st32(_slot(block, i), to);
+  }
+}
+
+/**
+ * @brief 将 `item` 的长度由 `old_len` 调整为 `new_len`，其后的数据（含尾部）整体移动
+ */
+static void _dtag_resize(dblock_t *block, ditem_t *item, uint32_t old_len, uint32_t new_len) {
+  uint8_t *tail = (uint8_t *)item + old_len;
+  memmove((uint8_t *)item + new_len, tail, block->data + block->length - tail);
+  STAT_ADD(bytes_moved, block->data + block->length - tail);
+  block->length = block->length - old_len + new_len;
+  _dtag_slots_shift(block, (uint8_t *)item - block->data, old_len, new_len);
+}
+
+static void _dtag_del(dblock_t *block, ditem_t *item, uint32_t idx) {
+  uint32_t len = _len(block, item);
+  _dtag_resize(block, item, len, 0);
+  if (_sorted(block)) {
+    _dtag_table_remove(block, idx);
+    _dtag_table_shift(block, idx, -(int32_t)len);
+  }
+}
+
+#define REF_NONE UINT32_MAX
+
+/**
+ * @brief 去重 `dblock` 中 `item` 所引用的共享池条目
+ * @return 未引用时返回 `REF_NONE`
+ */
+static uint32_t _dtag_ref(dblock_t *block, const ditem_t *item) {
+  dtag_view_t view;
+  if (!_dedup(block) || !_view_raw(block, item, _end(block), &view))
+    return REF_NONE;
+  if (view.vlen != CODEC_REF_SIZE || view.val[0] != CODEC_REF)
+    return REF_NONE;
+  return _ld32(view.val + 1);
+}
+
+/**
+ * @brief 在共享池中查找内容为 `head` + `val` 的条目，不存在时追加；引用数加 1
+ * @note 相同的原始数据压缩后也相同，因此直接比较存储的形式
+ *
+ * @param off 返回条目相对池起始处的偏移
+ */
+static int32_t _pool_acquire(dblock_t *block, const uint8_t *head, uint32_t hlen, const uint8_t *val, uint32_t len,
+                             uint32_t *off) {
+  uint32_t hash = _fnv1a(_fnv1a(DTAG_KEY_HASH_BASIS, head, hlen), val, len);
+  uint8_t *pool = _pool(block);
+  uint32_t size = _pool_size(block);
+  for (uint32_t curr = 0, next = 0; curr < size; curr = next) {
+    uint8_t *entry = pool + curr;
+    uint32_t elen = _ld32(entry + 2 * sizeof(uint32_t));
+    if (size - curr < POOL_ENTRY_HEAD || elen > size - curr - POOL_ENTRY_HEAD) {
+      logfE("detect error @pool %u", curr);
+      return DTAG_ERR_DATA;
     }
+    next = curr + POOL_ENTRY_HEAD + elen;
+    STAT_ADD(items_scanned, 1);
+    if (_ld32(entry + sizeof(uint32_t)) != hash || elen != hlen + len)
+      continue;
+    if (memcmp(entry + POOL_ENTRY_HEAD, head, hlen) || memcmp(entry + POOL_ENTRY_HEAD + hlen, val, len))
+      continue;
+    _st32(entry, _ld32(entry) + 1);
+    *off = curr;
+    return DTAG_OK;
   }
-  ditem_t *new_item = (ditem_t *)_end(block);
-  new_item->klen = klen + 1;
-  new_item->vlen = len;
-  memcpy(new_item->kv, key, klen + 1);
-  if (val) {
-    memcpy(&new_item->kv[new_item->klen], val, len);
+
+  uint32_t n = POOL_ENTRY_HEAD + hlen + len;
+  if ((uint64_t)block->length + n > block->capacity) {
+    return DTAG_ERR_CAPACITY;
   }
-  block->length += _len(new_item);
+  uint8_t *entry = pool + size;
+  _dtag_resize(block, (ditem_t *)entry, 0, n);
+  _st32(entry, 1);
+  _st32(entry + sizeof(uint32_t), hash);
+  _st32(entry + 2 * sizeof(uint32_t), hlen + len);
+  memcpy(entry + POOL_ENTRY_HEAD, head, hlen);
+  memcpy(entry + POOL_ENTRY_HEAD + hlen, val, len);
+  _st32(entry + n, size + n);
+  *off = size;
   return DTAG_OK;
 }
+
+/**
+ * @brief 共享池中 `off` 处条目的引用数减 1，归零时移除，并修正引用其后条目的 `ditem`
+ */
+static void _pool_release(dblock_t *block, uint32_t off) {
+  uint8_t *pool = _pool(block);
+  uint8_t *entry = pool + off;
+  uint32_t refs = _ld32(entry);
+  if (refs > 1) {
+    _st32(entry, refs - 1);
+    return;
+  }
+  uint32_t size = _pool_size(block);
+  uint32_t n = POOL_ENTRY_HEAD + _ld32(entry + 2 * sizeof(uint32_t));
+  _dtag_resize(block, (ditem_t *)entry, n, 0);
+  _st32(pool + size - n, size - n);
+
+  dtag_view_t view;
+  for (uint8_t *curr = _begin(block), *end = _end(block), *next; curr < end; curr = next) {
+    if (!(next = _view_raw(block, (ditem_t *)curr, end, &view)))
+      break;
+    if (view.vlen == CODEC_REF_SIZE && view.val[0] == CODEC_REF && _ld32(view.val + 1) > off)
+      _st32(view.val + 1, _ld32(view.val + 1) - n);
+  }
+}
+
+/**
+ * @brief extent `dblock` 中 `item` 所引用的 extent
+ *
+ * @param len 返回 extent 的长度
+ * @return 未引用时返回 `REF_NONE`
+ */
+static uint32_t _dtag_extent_ref(dblock_t *block, const ditem_t *item, uint32_t *len) {
+  dtag_view_t view;
+  if (!_extent(block) || !_view_raw(block, item, _end(block), &view))
+    return REF_NONE;
+  if (view.vlen != CODEC_EXT_SIZE || view.val[0] != CODEC_EXT)
+    return REF_NONE;
+  *len = _ld32(view.val + 1 + sizeof(uint32_t));
+  return _ld32(view.val + 1);
+}
+
+/**
+ * @brief 在 extent 区末尾追加 `val`，其后的 `ditem` 整体后移
+ *
+ * @param off 返回 extent 相对 extent 区起始处的偏移
+ */
+static int32_t _extent_add(dblock_t *block, const uint8_t *val, uint32_t len, uint32_t *off) {
+  if ((uint64_t)block->length + len > block->capacity) {
+    return DTAG_ERR_CAPACITY;
+  }
+  uint32_t size = _extent_size(block);
+  uint8_t *extent = _extents(block) + size;
+  _dtag_resize(block, (ditem_t *)extent, 0, len);
+  if (_sorted(block))
+    _dtag_table_shift(block, 0, (int32_t)len);
+  memcpy(extent, val, len);
+  _st32(_extents(block) - sizeof(uint32_t), size + len);
+  *off = size;
+  return DTAG_OK;
+}
+
+/**
+ * @brief 移除 extent 区 `off` 处的 `len` 字节，其后的 `ditem` 整体前移，并修正引用其后 extent 的 `ditem`
+ */
+static void _extent_remove(dblock_t *block, uint32_t off, uint32_t len) {
+  uint32_t size = _extent_size(block);
+  _dtag_resize(block, (ditem_t *)(_extents(block) + off), len, 0);
+  if (_sorted(block))
+    _dtag_table_shift(block, 0, -(int32_t)len);
+  _st32(_extents(block) - sizeof(uint32_t), size - len);
+
+  dtag_view_t view;
+  for (uint8_t *curr = _begin(block), *end = _end(block), *next; curr < end; curr = next) {
+    if (!(next = _view_raw(block, (ditem_t *)curr, end, &view)))
+      break;
+    if (view.vlen == CODEC_EXT_SIZE && view.val[0] == CODEC_EXT && _ld32(view.val + 1) > off)
+      _st32(view.val + 1, _ld32(view.val + 1) - len);
+  }
+}
+
+static int32_t _dtag_del_k(dblock_t *block, const dtag_key_t *key) {
+  ditem_t *item = NULL;
+  uint32_t idx = 0;
+  int32_t result = _dtag_lookup(block, key, &item, &idx);
+  if (result != DTAG_OK)
+    return result;
+  uint32_t ref = _dtag_ref(block, item);
+  uint32_t elen = 0, eoff = _dtag_extent_ref(block, item, &elen);
+  _dtag_del(block, item, idx);
+  if (ref != REF_NONE)
+    _pool_release(block, ref);
+  if (eoff != REF_NONE)
+    _extent_remove(block, eoff, elen);
+  if (_bloom(block))
+    _dtag_bloom_rebuild(block);
+  return DTAG_OK;
+}
+
+int32_t dtag_del_k(dblock_t *block, const dtag_key_t *key) {
+  API_ENTER(DTAG_OP_DEL);
+  PROBE_ENTER(del, block, key->str, key->len);
+  _heat_sample(key);
+  int32_t result = _dtag_del_k(block, key);
+  PROBE_RETURN(del, result);
+  API_LEAVE(DTAG_OP_DEL, key->str, key->len, 0, 0, result);
+  return result;
+}
+
+int32_t dtag_del(dblock_t *block, const char *key) {
+  API_ENTER(DTAG_OP_DEL);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  PROBE_ENTER(del, block, _key.str, _key.len);
+  if (result == DTAG_OK)
+    result = _dtag_del_k(block, &_key);
+  PROBE_RETURN(del, result);
+  API_LEAVE(DTAG_OP_DEL, _key.str, _key.len, 0, 0, result);
+  return result;
+}
+
+/**
+ * @brief 写入 `key`，value 由 `head` 与 `val` 拼接而成
+ *
+ * @param out 返回写入后的 `ditem`
+ */
+static int32_t _dtag_put(dblock_t *block, const dtag_key_t *key, const uint8_t *head, uint32_t hlen,
+                         const uint8_t *val, uint32_t len, ditem_t **out) {
+  /* `ditem` 中的 klen 含结尾的 '\0'，须在 8 bit 内 */
+  if (key->len >= DTAG_MAX_KLEN || hlen + len > DTAG_MAX_VLEN) {
+    return DTAG_ERR_INVPARAM;
+  }
+
+  ditem_t *item = NULL;
+  uint32_t idx = 0;
+  int32_t result = _dtag_lookup(block, key, &item, &idx);
+  if (result != DTAG_OK && result != DTAG_ERR_NOTFOUND)
+    return result;
+
+  uint32_t klen = key->len;
+  uint32_t new_len = _item_size(block, klen, hlen + len);
+  ditem_t *new_item = NULL;
+  if (item) {
+    if (block->length - _len(block, item) + new_len > block->capacity) {
+      return DTAG_ERR_CAPACITY;
+    }
+  } else {
+    if (block->length + new_len + (_sorted(block) ? sizeof(uint32_t) : 0) > block->capacity) {
+      return DTAG_ERR_CAPACITY;
+    }
+  }
+  if (_sorted(block)) {
+    /* 原位替换或插入到 `idx` 处以保持有序 */
+    uint32_t old_len = item ? _len(block, item) : 0;
+    uint32_t offset = idx < _count(block) ? _ld32(_table(block) + sizeof(uint32_t) * idx) : _end(block) - block->data;
+    new_item = (ditem_t *)(block->data + offset);
+    _dtag_resize(block, new_item, old_len, new_len);
+    _dtag_table_shift(block, item ? idx + 1 : idx, (int32_t)new_len - (int32_t)old_len);
+    if (!item)
+      _dtag_table_insert(block, idx, offset);
+  } else {
+    if (item) {
+      /* 替换后 `ditem` 移到末尾，原先指向它的槽位随之迁移 */
+      _dtag_slots_rebind(block, (uint8_t *)item - block->data, SLOT_MOVING);
+      _dtag_del(block, item, idx);
+    }
+    /* 其后可能还有共享池 */
+    new_item = (ditem_t *)_end(block);
+    _dtag_resize(block, new_item, 0, new_len);
+    if (item)
+      _dtag_slots_rebind(block, SLOT_MOVING, (uint8_t *)new_item - block->data);
+  }
+  if (_bloom(block) && !item)
+    _dtag_bloom_add(block, key->hash);
+  uint8_t *p = (uint8_t *)new_item;
+  if (_varint(block)) {
+    p = _varint_put(_varint_put(p, klen), hlen + len);
+    memcpy(p, key->str, klen);
+    p += klen;
+  } else {
+    new_item->klen = klen + 1;
+    new_item->vlen = hlen + len;
+    memcpy(new_item->kv, key->str, klen);
+    new_item->kv[klen] = '\0';
+    p = &new_item->kv[new_item->klen];
+    if (_aligned(block)) {
+      /* 填充置 0，保证相同内容的 `dblock` 校验和一致 */
+      memset(p, 0, (uint8_t *)new_item + new_len - p);
+      p = (uint8_t *)new_item + _align(sizeof(ditem_t) + klen + 1);
+    }
+  }
+  if (hlen)
+    memcpy(p, head, hlen);
+  if (val) {
+    memcpy(p + hlen, val, len);
+  }
+  if (out)
+    *out = new_item;
+  return DTAG_OK;
+}
+
+/**
+ * @brief 去重 `dblock` 上写入 `key`，较大的 value 存入共享池，`ditem` 中仅保留引用；替换时释放原先的引用
+ *
+ * @param rawlen value 的原始长度
+ */
+static int32_t _dtag_put_dedup(dblock_t *block, const dtag_key_t *key, const uint8_t *head, uint32_t hlen,
+                               const uint8_t *val, uint32_t len, uint32_t rawlen, ditem_t **out) {
+  ditem_t *item = NULL;
+  int32_t result = _dtag_lookup(block, key, &item, NULL);
+  if (result != DTAG_OK && result != DTAG_ERR_NOTFOUND)
+    return result;
+  uint32_t old = item ? _dtag_ref(block, item) : REF_NONE;
+
+  if (rawlen < DTAG_DEDUP_MIN) {
+    result = _dtag_put(block, key, head, hlen, val, len, out);
+  } else {
+    /* 先取得新的引用，值未变化时原条目不会被移除 */
+    uint32_t off = 0;
+    if ((result = _pool_acquire(block, head, hlen, val, len, &off)) != DTAG_OK)
+      return result;
+    uint8_t ref[CODEC_REF_SIZE] = {CODEC_REF};
+    _st32(ref + 1, off);
+    if ((result = _dtag_put(block, key, ref, sizeof(ref), NULL, 0, out)) != DTAG_OK)
+      _pool_release(block, off);
+  }
+  if (result == DTAG_OK && old != REF_NONE)
+    _pool_release(block, old);
+  return result;
+}
+
+/**
+ * @brief 写入 `key`，value 前附带 codec，按需压缩与去重
+ *
+ * @param plain 原样存储，不压缩、不共享
+ */
+static int32_t _dtag_set_codec(dblock_t *block, const dtag_key_t *key, const uint8_t *val, uint32_t len,
+                               uint32_t plain, ditem_t **out) {
+  uint8_t head[CODEC_HEAD_MAX] = {CODEC_RAW};
+  uint32_t hlen = 1;
+  uint8_t *zbuf = NULL;
+  size_t zlen = 0;
+  /* 只保留比原始数据更短的压缩结果 */
+  if (!plain && _compress(block) && len >= DTAG_COMPRESS_MIN && (zbuf = malloc(len))) {
+    STAT_BEGIN(begin);
+    zlen = lz4_compress(val, len, zbuf, len - CODEC_HEAD_MAX);
+    STAT_END(begin, codec_nanos);
+    STAT_ADD(codec_bytes, len);
+  }
+  const uint8_t *payload = val;
+  uint32_t plen = len;
+  if (zlen) {
+    head[0] = CODEC_LZ4;
+    _st32(head + 1, len);
+    hlen = CODEC_HEAD_MAX;
+    payload = zbuf;
+    plen = zlen;
+  }
+  /* 原始长度记为 0 时不进入共享池，但仍释放原先的引用 */
+  int32_t result = _dedup(block) ? _dtag_put_dedup(block, key, head, hlen, payload, plen, plain ? 0 : len, out)
+                                 : _dtag_put(block, key, head, hlen, payload, plen, out);
+  free(zbuf);
+  return result;
+}
+
+/**
+ * @brief extent `dblock` 上写入 `key`，value 存入新的 extent，`ditem` 中仅保留引用；替换时释放原先共享池的引用
+ */
+static int32_t _dtag_put_extent(dblock_t *block, const dtag_key_t *key, const uint8_t *val, uint32_t len,
+                                ditem_t **out) {
+  ditem_t *item = NULL;
+  int32_t result = _dtag_lookup(block, key, &item, NULL);
+  if (result != DTAG_OK && result != DTAG_ERR_NOTFOUND)
+    return result;
+  uint32_t old = item ? _dtag_ref(block, item) : REF_NONE;
+
+  uint32_t off = 0;
+  if ((result = _extent_add(block, val, len, &off)) != DTAG_OK)
+    return result;
+  uint8_t ref[CODEC_EXT_SIZE] = {CODEC_EXT};
+  _st32(ref + 1, off);
+  _st32(ref + 1 + sizeof(uint32_t), len);
+  if ((result = _dtag_put(block, key, ref, sizeof(ref), NULL, 0, out)) != DTAG_OK)
+    _extent_remove(block, off, len);
+  if (result == DTAG_OK && old != REF_NONE)
+    _pool_release(block, old);
+  return result;
+}
+
+/**
+ * @brief 写入 `key`，压缩 `dblock` 上按需压缩 value，去重 `dblock` 上按内容共享 value，extent `dblock` 上较大的
+ *        value 存入 extent
+ *
+ * @param plain 不压缩、不共享，保证 value 可原位访问与修改
+ * @param out 返回写入后的 `ditem`
+ */
+static int32_t _dtag_store(dblock_t *block, const dtag_key_t *key, const uint8_t *val, uint32_t len, uint32_t plain,
+                           ditem_t **out) {
+  if (!val && len) {
+    return DTAG_ERR_INVPARAM;
+  }
+  int32_t extent = _extent(block) && len >= DTAG_EXTENT_MIN;
+  if (len > DTAG_MAX_VLEN && !extent) {
+    return DTAG_ERR_INVPARAM;
+  }
+  if (!_codec(block))
+    return _dtag_put(block, key, NULL, 0, val, len, out);
+
+  /* 写入成功后再移除原先的 extent，失败时原值不变 */
+  ditem_t *item = NULL;
+  uint32_t elen = 0, eoff = REF_NONE;
+  int32_t result = _extent(block) ? _dtag_lookup(block, key, &item, NULL) : DTAG_OK;
+  if (result != DTAG_OK && result != DTAG_ERR_NOTFOUND)
+    return result;
+  if (item)
+    eoff = _dtag_extent_ref(block, item, &elen);
+  result = extent ? _dtag_put_extent(block, key, val, len, out) : _dtag_set_codec(block, key, val, len, plain, out);
+  if (result == DTAG_OK && eoff != REF_NONE) {
+    _extent_remove(block, eoff, elen);
+    if (out)
+      *out = (ditem_t *)((uint8_t *)*out - elen);
+  }
+  return result;
+}
+
+static int32_t _dtag_set(dblock_t *block, const dtag_key_t *key, const uint8_t *val, uint32_t len, ditem_t **out) {
+  return _dtag_store(block, key, val, len, 0, out);
+}
+
+int32_t dtag_set_k(dblock_t *block, const dtag_key_t *key, const uint8_t *val, uint32_t len) {
+  API_ENTER(DTAG_OP_SET);
+  PROBE_ENTER(set, block, key->str, key->len, len);
+  _heat_sample(key);
+  int32_t result = _dtag_set(block, key, val, len, NULL);
+  PROBE_RETURN(set, result);
+  API_LEAVE(DTAG_OP_SET, key->str, key->len, len, 0, result);
+  return result;
+}
+
+int32_t dtag_set(dblock_t *block, const char *key, const uint8_t *val, uint32_t len) {
+  API_ENTER(DTAG_OP_SET);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  PROBE_ENTER(set, block, _key.str, _key.len, len);
+  if (result == DTAG_OK)
+    result = _dtag_set(block, &_key, val, len, NULL);
+  PROBE_RETURN(set, result);
+  API_LEAVE(DTAG_OP_SET, _key.str, _key.len, len, 0, result);
+  return result;
+}
+
+/**
+ * @brief 将 `item` 的 value 视为嵌套的 `dblock`，仅检查结构，其 chksum 由外层覆盖
+ */
+static int32_t _dtag_sub(dblock_t *block, ditem_t *item, dblock_t **sub) {
+  dtag_view_t view;
+  _view(block, item, _end(block), &view);
+  /* 压缩或共享的 value 无法原位访问 */
+  if (view.rawlen != view.vlen || _dtag_ref(block, item) != REF_NONE) {
+    return DTAG_ERR_NOTSUPP;
+  }
+  if (view.vlen < sizeof(dblock_t)) {
+    return DTAG_ERR_LEN;
+  }
+  dblock_t *_sub = (dblock_t *)view.val;
+  int32_t result = DTAG_OK;
+
+  if (result == DTAG_OK)
+    result = _dtag_import_check0(_sub);
+  if (result == DTAG_OK)
+    result = _dtag_import_check1(_sub, view.vlen);
+  if (result == DTAG_OK)
+    result = _dtag_import_check2(_sub);
+  if (result == DTAG_OK)
+    *sub = _sub;
+  return result;
+}
+
+static int32_t _dtag_set_sub(dblock_t *block, const dtag_key_t *key, uint32_t capacity, uint32_t flags,
+                             dblock_t **sub) {
+  if ((uint64_t)capacity + sizeof(dblock_t) > UINT32_MAX)
+    return DTAG_ERR_INVPARAM;
+
+  uint32_t len = capacity + sizeof(dblock_t);
+  uint8_t *buf = (uint8_t *)malloc(len);
+  if (!buf) {
+    return DTAG_ERR_NOMEM;
+  }
+  dblock_t *_sub = NULL;
+  ditem_t *item = NULL;
+  int32_t result = (flags & DTAG_FLAG_SCHEMA) ? DTAG_ERR_FLAGS : _dtag_init(&_sub, buf, len, flags, 0);
+  if (result == DTAG_OK) {
+    /* 未使用的部分同样置 0，保证相同内容的 `dblock` 校验和一致 */
+    memset(_sub->data + _sub->length, 0, capacity - _sub->length);
+#if CHKSUM_LENGTH != 0
+    _dtag_chksum(_sub, _sub->chksum);
+#endif
+    result = _dtag_store(block, key, buf, len, 1, &item);
+  }
+  if (result == DTAG_OK)
+    result = _dtag_sub(block, item, sub);
+  free(buf);
+  return result;
+}
+
+int32_t dtag_set_sub(dblock_t *block, const char *key, uint32_t capacity, uint32_t flags, dblock_t **sub) {
+  API_ENTER(DTAG_OP_SET_SUB);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key(block, &_key, key);
+  PROBE_ENTER(set_sub, block, _key.str, _key.len, capacity);
+  if (result == DTAG_OK)
+    result = _dtag_set_sub(block, &_key, capacity, flags, sub);
+  PROBE_RETURN(set_sub, result);
+  API_LEAVE(DTAG_OP_SET_SUB, _key.str, _key.len, capacity, flags, result);
+  return result;
+}
+
+int32_t dtag_get_sub(dblock_t *block, const char *key, dblock_t **sub) {
+  API_ENTER(DTAG_OP_GET_SUB);
+  dtag_key_t _key = {0};
+  ditem_t *item = NULL;
+  int32_t result = _dtag_key(block, &_key, key);
+  PROBE_ENTER(get_sub, block, _key.str, _key.len);
+  if (result == DTAG_OK)
+    result = _dtag_lookup(block, &_key, &item, NULL);
+  if (result == DTAG_OK)
+    result = _dtag_sub(block, item, sub);
+  PROBE_RETURN(get_sub, result);
+  API_LEAVE(DTAG_OP_GET_SUB, _key.str, _key.len, 0, 0, result);
+  return result;
+}
+
+/**
+ * @brief 沿 `path` 逐层进入嵌套的 `dblock`，每层只在该层的 `ditem` 中查找
+ *
+ * @param inner 返回最后一个分量所在的 `dblock`
+ * @param key 返回最后一个分量
+ */
+static int32_t _dtag_walk_path(dblock_t *block, const char *path, dblock_t **inner, dtag_key_t *key) {
+  const char *sep = NULL;
+  int32_t result = DTAG_OK;
+  for (; result == DTAG_OK && (sep = strchr(path, DTAG_PATH_SEP)); path = sep + 1) {
+    ditem_t *item = NULL;
+    result = _dtag_key_n(block, key, path, sep - path);
+    if (result == DTAG_OK)
+      result = _dtag_lookup(block, key, &item, NULL);
+    if (result == DTAG_OK)
+      result = _dtag_sub(block, item, &block);
+  }
+  if (result == DTAG_OK)
+    result = _dtag_key(block, key, path);
+  if (result == DTAG_OK)
+    *inner = block;
+  return result;
+}
+
+int32_t dtag_get_path(dblock_t *block, const char *path, uint8_t *val, uint32_t *len) {
+  API_ENTER(DTAG_OP_GET_PATH);
+  PROBE_ENTER(get_path, block, path);
+  dtag_key_t key = {0};
+  int32_t result = _dtag_walk_path(block, path, &block, &key);
+  if (result == DTAG_OK)
+    result = _dtag_get(block, &key, val, len);
+  PROBE_RETURN(get_path, result);
+  /* 记录整条路径，超过 `DTAG_MAX_KLEN` 的部分被截断 */
+  API_LEAVE(DTAG_OP_GET_PATH, path, strnlen(path, DTAG_MAX_KLEN), len ? *len : 0, 0, result);
+  return result;
+}
+
+/**
+ * @brief 查找 `key`，并要求 value 的长度为 `size`
+ *
+ * @param val 返回 value 在 `dblock` 中的位置
+ */
+static int32_t _dtag_value(dblock_t *block, const dtag_key_t *key, uint32_t size, uint8_t **val) {
+  ditem_t *item = NULL;
+  int32_t result = _dtag_lookup(block, key, &item, NULL);
+  if (result != DTAG_OK)
+    return result;
+  dtag_view_t view;
+  _view(block, item, _end(block), &view);
+  if (view.vlen != size || view.rawlen != size)
+    return DTAG_ERR_LEN;
+  *val = view.val;
+  return DTAG_OK;
+}
+
+static int32_t _dtag_get_typed(dblock_t *block, const dtag_key_t *key, void *out, uint32_t size) {
+  uint8_t *val = NULL;
+  int32_t result = _dtag_value(block, key, size, &val);
+  if (result != DTAG_OK)
+    return result;
+  /* 对齐时与 `dtag_add_u64` 的并发累加配对 */
+  if (size == sizeof(uint64_t) && !((uintptr_t)val % sizeof(uint64_t))) {
+    uint64_t value = __atomic_load_n((uint64_t *)val, __ATOMIC_RELAXED);
+    memcpy(out, &value, size);
+  } else {
+    memcpy(out, val, size);
+  }
+  return DTAG_OK;
+}
+
+static int32_t _dtag_get_typed_k(dblock_t *block, const dtag_key_t *key, void *out, uint32_t size) {
+  API_ENTER(DTAG_OP_GET_TYPED);
+  _heat_sample(key);
+  int32_t result = _dtag_get_typed(block, key, out, size);
+  API_LEAVE(DTAG_OP_GET_TYPED, key->str, key->len, size, 0, result);
+  return result;
+}
+
+static int32_t _dtag_get_typed_s(dblock_t *block, const char *key, void *out, uint32_t size) {
+  API_ENTER(DTAG_OP_GET_TYPED);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  if (result == DTAG_OK)
+    result = _dtag_get_typed(block, &_key, out, size);
+  API_LEAVE(DTAG_OP_GET_TYPED, _key.str, _key.len, size, 0, result);
+  return result;
+}
+
+int32_t dtag_get_u32(dblock_t *block, const char *key, uint32_t *out) {
+  return _dtag_get_typed_s(block, key, out, sizeof(*out));
+}
+int32_t dtag_get_u32_k(dblock_t *block, const dtag_key_t *key, uint32_t *out) {
+  return _dtag_get_typed_k(block, key, out, sizeof(*out));
+}
+int32_t dtag_get_u64(dblock_t *block, const char *key, uint64_t *out) {
+  return _dtag_get_typed_s(block, key, out, sizeof(*out));
+}
+int32_t dtag_get_u64_k(dblock_t *block, const dtag_key_t *key, uint64_t *out) {
+  return _dtag_get_typed_k(block, key, out, sizeof(*out));
+}
+int32_t dtag_get_f64(dblock_t *block, const char *key, double *out) {
+  return _dtag_get_typed_s(block, key, out, sizeof(*out));
+}
+int32_t dtag_get_f64_k(dblock_t *block, const dtag_key_t *key, double *out) {
+  return _dtag_get_typed_k(block, key, out, sizeof(*out));
+}
+
+static int32_t _dtag_add_u64(dblock_t *block, const dtag_key_t *key, uint64_t delta, uint64_t *out) {
+  uint8_t *val = NULL;
+  int32_t result = _dtag_value(block, key, sizeof(uint64_t), &val);
+  if (result != DTAG_OK)
+    return result;
+  if ((uintptr_t)val % sizeof(uint64_t))
+    return DTAG_ERR_NOTSUPP;
+  uint64_t sum = __atomic_add_fetch((uint64_t *)val, delta, __ATOMIC_RELAXED);
+  if (out)
+    *out = sum;
+  return DTAG_OK;
+}
+
+int32_t dtag_add_u64_k(dblock_t *block, const dtag_key_t *key, uint64_t delta, uint64_t *out) {
+  API_ENTER(DTAG_OP_ADD);
+  _heat_sample(key);
+  int32_t result = _dtag_add_u64(block, key, delta, out);
+  API_LEAVE(DTAG_OP_ADD, key->str, key->len, (uint32_t)delta, 0, result);
+  return result;
+}
+
+int32_t dtag_add_u64(dblock_t *block, const char *key, uint64_t delta, uint64_t *out) {
+  API_ENTER(DTAG_OP_ADD);
+  dtag_key_t _key = {0};
+  int32_t result = _dtag_key_hot(block, &_key, key);
+  if (result == DTAG_OK)
+    result = _dtag_add_u64(block, &_key, delta, out);
+  API_LEAVE(DTAG_OP_ADD, _key.str, _key.len, (uint32_t)delta, 0, result);
+  return result;
+}
+
+static int32_t _dtag_scan_prefix(dblock_t *block, const char *prefix, dtag_scan_f cb, void *arg) {
+  if (!prefix) {
+    prefix = "";
+  }
+  uint32_t plen = strnlen(prefix, DTAG_MAX_KLEN);
+  if (plen == DTAG_MAX_KLEN) {
+    return DTAG_ERR_INVPARAM;
+  }
+
+  dtag_view_t view;
+  if (_sorted(block)) {
+    uint32_t idx = 0;
+    ditem_t *curr = NULL;
+    int32_t result = _dtag_lower_bound(block, prefix, plen, &idx, &curr, &view);
+    if (result != DTAG_OK)
+      return result;
+    for (; idx < _count(block); idx++) {
+      if (!(curr = _dtag_item_at(block, idx, &view)))
+        return DTAG_ERR_DATA;
+      if (view.klen < plen || memcmp(view.key, prefix, plen))
+        break;
+      if ((result = cb(curr, arg)))
+        return result;
+    }
+    return DTAG_OK;
+  }
+
+  for (uint8_t *curr = _begin(block), *end = _end(block), *next; curr < end; curr = next) {
+    if (!(next = _view(block, (ditem_t *)curr, end, &view))) {
+      logfE("detect error @%p", curr);
+      return DTAG_ERR_DATA;
+    }
+    if (view.klen < plen || memcmp(view.key, prefix, plen))
+      continue;
+    int32_t result = cb((ditem_t *)curr, arg);
+    if (result)
+      return result;
+  }
+  return DTAG_OK;
+}
+
+int32_t dtag_scan_prefix(dblock_t *block, const char *prefix, dtag_scan_f cb, void *arg) {
+  API_ENTER(DTAG_OP_SCAN);
+  int32_t result = _dtag_scan_prefix(block, prefix, cb, arg);
+  API_LEAVE(DTAG_OP_SCAN, prefix, prefix ? strnlen(prefix, DTAG_MAX_KLEN - 1) : 0, 0, 0, result);
+  return result;
+}
+
+static int32_t _dtag_get_slot(dblock_t *block, uint32_t slot, ditem_t **item) {
+  if (slot >= _nslots(block)) {
+    return DTAG_ERR_INVPARAM;
+  }
+  uint32_t offset = _ld32(_slot(block, slot));
+  if (offset == SLOT_NONE) {
+    return DTAG_ERR_NOTFOUND;
+  }
+  ditem_t *curr = (ditem_t *)(block->data + offset);
+  dtag_view_t view;
+  if (!_dtag_ditem_check0(block, curr) || !_dtag_ditem_check1(block, curr, &view)) {
+    logfE("detect error @slot %u offset %u", slot, offset);
+    return DTAG_ERR_DATA;
+  }
+  if (item)
+    *item = curr;
+  return DTAG_OK;
+}
+
+int32_t dtag_get_slot(dblock_t *block, uint32_t slot, ditem_t **item) {
+  API_ENTER(DTAG_OP_GET_SLOT);
+  int32_t result = _dtag_get_slot(block, slot, item);
+  API_LEAVE(DTAG_OP_GET_SLOT, NULL, 0, slot, 0, result);
+  return result;
+}
+
+static int32_t _dtag_set_slot(dblock_t *block, uint32_t slot, const dtag_key_t *key, const uint8_t *val,
+                              uint32_t len) {
+  if (slot >= _nslots(block)) {
+    return DTAG_ERR_INVPARAM;
+  }
+  ditem_t *item = NULL;
+  int32_t result = _dtag_set(block, key, val, len, &item);
+  if (result != DTAG_OK)
+    return result;
+  _st32(_slot(block, slot), (uint8_t *)item - block->data);
+  return DTAG_OK;
+}
+
+int32_t dtag_set_slot(dblock_t *block, uint32_t slot, const dtag_key_t *key, const uint8_t *val, uint32_t len) {
+  API_ENTER(DTAG_OP_SET_SLOT);
+  _heat_sample(key);
+  int32_t result = _dtag_set_slot(block, slot, key, val, len);
+  API_LEAVE(DTAG_OP_SET_SLOT, key->str, key->len, slot, len, result);
+  return result;
+}
+
+void dtag_item_view(const dblock_t *block, const ditem_t *item, dtag_view_t *view) {
+  /* `item` 已校验，按最大编码长度放宽边界 */
+  _view(block, item, (const uint8_t *)item + ITEM_MAX, view);
+}
+
+int32_t dtag_item_value(const dblock_t *block, const ditem_t *item, uint8_t *val, uint32_t *len) {
+  if (val && !len) {
+    return DTAG_ERR_INVPARAM;
+  }
+  dtag_view_t view;
+  dtag_item_view(block, item, &view);
+  if (val) {
+    if (*len < view.rawlen)
+      return DTAG_ERR_NOSPACE;
+    int32_t result = _view_value(&view, val);
+    if (result != DTAG_OK)
+      return result;
+  }
+  if (len)
+    *len = view.rawlen;
+  return DTAG_OK;
+}
+
+/* `dtag_optimize` 中 `ditem` 的原位置、长度、计数与新位置 */
+typedef struct {
+  uint32_t offset;
+  uint32_t len;
+  uint32_t count;
+  uint32_t moved;
+} _dhot_t;
+
+/* 计数从高到低，相同时按原位置 */
+static int _hot_cmp(const void *a, const void *b) {
+  const _dhot_t *x = (const _dhot_t *)a, *y = (const _dhot_t *)b;
+  if (x->count != y->count)
+    return x->count < y->count ? 1 : -1;
+  return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static int _hot_offset_cmp(const void *a, const void *b) {
+  const _dhot_t *x = (const _dhot_t *)a, *y = (const _dhot_t *)b;
+  return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static int32_t _dtag_optimize(dblock_t *block, const dheat_t *heat) {
+  if (!heat) {
+    return DTAG_ERR_INVPARAM;
+  }
+  if (_sorted(block)) {
+    return DTAG_OK;
+  }
+  uint8_t *begin = _begin(block), *end = _end(block);
+  dtag_view_t view;
+  uint32_t count = 0;
+  for (uint8_t *curr = begin, *next; curr < end; curr = next, count++) {
+    if (!(next = _view(block, (ditem_t *)curr, end, &view))) {
+      logfE("detect error @%p", curr);
+      return DTAG_ERR_DATA;
+    }
+  }
+  _dhot_t *hots = (_dhot_t *)malloc(sizeof(_dhot_t) * (count + 1));
+  uint8_t *buf = (uint8_t *)malloc(end - begin + 1);
+  if (!hots || !buf) {
+    free(hots);
+    free(buf);
+    return DTAG_ERR_NOMEM;
+  }
+  count = 0;
+  for (uint8_t *curr = begin, *next; curr < end; curr = next, count++) {
+    next = _view(block, (ditem_t *)curr, end, &view);
+    hots[count] = (_dhot_t){curr - block->data, next - curr, dtag_heat_count(heat, view.key, view.klen), 0};
+  }
+
+  /* `ditem` 的长度含对齐填充，按任意顺序排列后仍保持对齐 */
+  qsort(hots, count, sizeof(_dhot_t), _hot_cmp);
+  uint32_t pos = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    memcpy(buf + pos, block->data + hots[i].offset, hots[i].len);
+    hots[i].moved = begin - block->data + pos;
+    pos += hots[i].len;
+  }
+  memcpy(begin, buf, end - begin);
+  STAT_ADD(bytes_moved, end - begin);
+
+  qsort(hots, count, sizeof(_dhot_t), _hot_offset_cmp);
+  for (uint32_t i = 0; i < _nslots(block); i++) {
+    _dhot_t slot = {_ld32(_slot(block, i))};
+    _dhot_t *hot = (_dhot_t *)bsearch(&slot, hots, count, sizeof(_dhot_t), _hot_offset_cmp);
+    if (hot)
+      _st32(_slot(block, i), hot->moved);
+  }
+  free(hots);
+  free(buf);
+  return DTAG_OK;
+}
+
+int32_t dtag_optimize(dblock_t *block, const dheat_t *heat) {
+  API_ENTER(DTAG_OP_OPTIMIZE);
+  PROBE_ENTER(optimize, block, block->length);
+  int32_t result = _dtag_optimize(block, heat);
+  PROBE_RETURN(optimize, result);
+  API_LEAVE(DTAG_OP_OPTIMIZE, NULL, 0, block->length, block->flags, result);
+  return result;
+}
+
+static int32_t _dtag_convert(dblock_t *dst, dblock_t *src) {
+  dtag_view_t view;
+  dtag_key_t key;
+  int32_t result = DTAG_OK;
+
+  for (ditem_t *curr = NULL;;) {
+    if ((result = _dtag_next(src, &curr)) != DTAG_OK)
+      return result;
+    if (curr == NULL)
+      break;
+    _view(src, curr, _end(src), &view);
+    key.str = view.key;
+    key.len = view.klen;
+    key.hash = _bloom(dst) ? dtag_key_hash(view.key, view.klen) : 0;
+    if (view.rawlen == view.vlen) {
+      result = _dtag_set(dst, &key, view.val, view.vlen, NULL);
+    } else {
+      /* 压缩的 value 先解压，再按 `dst` 的特性写入 */
+      uint8_t *raw = malloc(view.rawlen);
+      if (!raw)
+        return DTAG_ERR_NOMEM;
+      if ((result = _view_value(&view, raw)) == DTAG_OK)
+        result = _dtag_set(dst, &key, raw, view.rawlen, NULL);
+      free(raw);
+    }
+    if (result != DTAG_OK)
+      return result;
+  }
+  for (uint32_t i = 0; i < _nslots(src) && i < _nslots(dst); i++) {
+    ditem_t *item = NULL;
+    if (_dtag_get_slot(src, i, &item) != DTAG_OK)
+      continue;
+    _view(src, item, _end(src), &view);
+    key.str = view.key;
+    key.len = view.klen;
+    key.hash = _bloom(dst) ? dtag_key_hash(view.key, view.klen) : 0;
+    if (_dtag_lookup(dst, &key, &item, NULL) == DTAG_OK)
+      _st32(_slot(dst, i), (uint8_t *)item - dst->data);
+  }
+  return DTAG_OK;
+}
+
+int32_t dtag_convert(dblock_t *dst, dblock_t *src) {
+  API_ENTER(DTAG_OP_CONVERT);
+  PROBE_ENTER(convert, dst, src);
+  int32_t result = _dtag_convert(dst, src);
+  PROBE_RETURN(convert, result);
+  API_LEAVE(DTAG_OP_CONVERT, NULL, 0, src->length, dst->flags, result);
+  return result;
+}
+
+/* patch 中单个操作的头部 */
+#define PATCH_OP_SIZE (1 + 1 + sizeof(uint32_t))
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t len;
+  uint32_t capacity;
+  uint32_t count;
+} _dpatch_t;
+
+static int32_t _patch_put(_dpatch_t *patch, uint8_t type, const char *key, uint32_t klen, const uint8_t *val,
+                          uint32_t vlen) {
+  uint32_t need = PATCH_OP_SIZE + klen + vlen;
+  if (patch->len + need > patch->capacity) {
+    uint32_t capacity = patch->capacity * 2 > patch->len + need ? patch->capacity * 2 : patch->len + need;
+    uint8_t *buf = realloc(patch->buf, capacity);
+    if (!buf)
+      return DTAG_ERR_NOMEM;
+    patch->buf = buf;
+    patch->capacity = capacity;
+  }
+  uint8_t *p = patch->buf + patch->len;
+  p[0] = type;
+  p[1] = klen;
+  _st32(p + 2, vlen);
+  memcpy(p + PATCH_OP_SIZE, key, klen);
+  if (vlen)
+    memcpy(p + PATCH_OP_SIZE + klen, val, vlen);
+  patch->len += need;
+  patch->count++;
+  return DTAG_OK;
+}
+
+/* 取 `view` 的原始 value，压缩时解压到新分配的内存（需要调用者释放 `*raw`） */
+static int32_t _view_raw_value(const dtag_view_t *view, uint8_t **raw) {
+  *raw = NULL;
+  if (view->rawlen == view->vlen)
+    return DTAG_OK;
+  if (!(*raw = malloc(view->rawlen)))
+    return DTAG_ERR_NOMEM;
+  int32_t result = _view_value(view, *raw);
+  if (result != DTAG_OK) {
+    free(*raw);
+    *raw = NULL;
+  }
+  return result;
+}
+
+/* 比较两个 value 的原始内容，存储形式相同时不解压 */
+static int32_t _view_equal(const dtag_view_t *a, const dtag_view_t *b, int32_t *equal) {
+  *equal = a->rawlen == b->rawlen;
+  if (!*equal)
+    return DTAG_OK;
+  if (a->vlen == b->vlen && !memcmp(a->val, b->val, a->vlen) && (a->rawlen == a->vlen) == (b->rawlen == b->vlen))
+    return DTAG_OK;
+  uint8_t *ra = NULL, *rb = NULL;
+  int32_t result = _view_raw_value(a, &ra);
+  if (result == DTAG_OK)
+    result = _view_raw_value(b, &rb);
+  if (result == DTAG_OK)
+    *equal = !memcmp(ra ? ra : a->val, rb ? rb : b->val, a->rawlen);
+  free(ra);
+  free(rb);
+  return result;
+}
+
+/* 槽位对应的 key，未设置时 `klen` 为 0 */
+static void _slot_key(dblock_t *block, uint32_t slot, dtag_view_t *view) {
+  ditem_t *item = NULL;
+  view->key = "";
+  view->klen = 0;
+  if (slot < _nslots(block) && _dtag_get_slot(block, slot, &item) == DTAG_OK)
+    _view(block, item, _end(block), view);
+}
+
+typedef struct {
+  ditem_t *item;
+  uint32_t hash;
+  uint32_t matched;
+} _dfrom_t;
+
+/* `from` 的哈希表（开放寻址，存 `froms` 的下标 + 1），`to` 的 `ditem` 逐个探测 */
+typedef struct {
+  dblock_t *from;
+  dblock_t *to;
+  _dfrom_t *froms;
+  uint32_t count;
+  uint32_t *table;
+  uint32_t mask;
+} _ddiff_t;
+
+static int32_t _diff_index(_ddiff_t *diff) {
+  dtag_view_t view;
+  int32_t result = DTAG_OK;
+  uint32_t count = 0;
+
+  for (ditem_t *curr = NULL; (result = _dtag_next(diff->from, &curr)) == DTAG_OK && curr;)
+    count++;
+  if (result != DTAG_OK)
+    return result;
+  while (diff->mask + 1 < count * 2)
+    diff->mask = diff->mask * 2 + 1;
+  diff->froms = calloc(count ? count : 1, sizeof(_dfrom_t));
+  diff->table = calloc(diff->mask + 1, sizeof(uint32_t));
+  if (!diff->froms || !diff->table)
+    return DTAG_ERR_NOMEM;
+  for (ditem_t *curr = NULL; (result = _dtag_next(diff->from, &curr)) == DTAG_OK && curr;) {
+    _dfrom_t *f = &diff->froms[diff->count++];
+    _view(diff->from, curr, _end(diff->from), &view);
+    f->item = curr;
+    f->hash = dtag_key_hash(view.key, view.klen);
+    uint32_t i = f->hash & diff->mask;
+    while (diff->table[i])
+      i = (i + 1) & diff->mask;
+    diff->table[i] = diff->count;
+  }
+  return result;
+}
+
+/* `from` 中与 `view` 同 key 的 `ditem`，找到时其视图存入 `fview` */
+static _dfrom_t *_diff_probe(_ddiff_t *diff, const dtag_view_t *view, dtag_view_t *fview) {
+  uint32_t hash = dtag_key_hash(view->key, view->klen);
+  for (uint32_t i = hash & diff->mask; diff->table[i]; i = (i + 1) & diff->mask) {
+    _dfrom_t *f = &diff->froms[diff->table[i] - 1];
+    if (f->hash != hash)
+      continue;
+    _view(diff->from, f->item, _end(diff->from), fview);
+    if (fview->klen == view->klen && !memcmp(fview->key, view->key, view->klen))
+      return f;
+  }
+  return NULL;
+}
+
+/* 标记 `from` 中在 `to` 仍存在的 `ditem` */
+static int32_t _diff_match(_ddiff_t *diff) {
+  dtag_view_t view, fview;
+  int32_t result = DTAG_OK;
+
+  for (ditem_t *curr = NULL; (result = _dtag_next(diff->to, &curr)) == DTAG_OK && curr;) {
+    _view(diff->to, curr, _end(diff->to), &view);
+    _dfrom_t *f = _diff_probe(diff, &view, &fview);
+    if (f)
+      f->matched = 1;
+  }
+  return result;
+}
+
+/* `from` 中未匹配的 `ditem` 生成 DEL */
+static int32_t _diff_dels(_ddiff_t *diff, _dpatch_t *patch) {
+  dtag_view_t view;
+  int32_t result = DTAG_OK;
+
+  for (uint32_t i = 0; i < diff->count && result == DTAG_OK; i++) {
+    if (diff->froms[i].matched)
+      continue;
+    _view(diff->from, diff->froms[i].item, _end(diff->from), &view);
+    result = _patch_put(patch, DTAG_PATCH_DEL, view.key, view.klen, NULL, 0);
+  }
+  return result;
+}
+
+/* `to` 中新增或 value 不同的 `ditem` 生成 SET */
+static int32_t _diff_sets(_ddiff_t *diff, _dpatch_t *patch) {
+  dtag_view_t view, fview;
+  int32_t result = DTAG_OK;
+
+  for (ditem_t *curr = NULL; (result = _dtag_next(diff->to, &curr)) == DTAG_OK && curr;) {
+    _view(diff->to, curr, _end(diff->to), &view);
+    int32_t equal = 0;
+    if (_diff_probe(diff, &view, &fview) && (result = _view_equal(&fview, &view, &equal)) != DTAG_OK)
+      return result;
+    if (equal)
+      continue;
+    uint8_t *raw = NULL;
+    if ((result = _view_raw_value(&view, &raw)) != DTAG_OK)
+      return result;
+    result = _patch_put(patch, DTAG_PATCH_SET, view.key, view.klen, raw ? raw : view.val, view.rawlen);
+    free(raw);
+    if (result != DTAG_OK)
+      return result;
+  }
+  return result;
+}
+
+/* 槽位绑定不同时生成 SLOT */
+static int32_t _diff_slots(_ddiff_t *diff, _dpatch_t *patch) {
+  dtag_view_t view, fview;
+  int32_t result = DTAG_OK;
+
+  for (uint32_t i = 0; i < _nslots(diff->to) && result == DTAG_OK; i++) {
+    uint8_t slot[sizeof(uint32_t)];
+    _slot_key(diff->from, i, &fview);
+    _slot_key(diff->to, i, &view);
+    if (fview.klen == view.klen && !memcmp(fview.key, view.key, view.klen))
+      continue;
+    _st32(slot, i);
+    result = _patch_put(patch, DTAG_PATCH_SLOT, view.key, view.klen, slot, sizeof(slot));
+  }
+  return result;
+}
+
+static int32_t _dtag_diff(dblock_t *from, dblock_t *to, _dpatch_t *patch) {
+  _ddiff_t diff = {from, to};
+  int32_t result = _diff_index(&diff);
+  if (result == DTAG_OK)
+    result = _diff_match(&diff);
+  /* 先删除再写入，应用时无需同时容纳新旧 `ditem` */
+  if (result == DTAG_OK)
+    result = _diff_dels(&diff, patch);
+  if (result == DTAG_OK)
+    result = _diff_sets(&diff, patch);
+  if (result == DTAG_OK)
+    result = _diff_slots(&diff, patch);
+  free(diff.table);
+  free(diff.froms);
+  return result;
+}
+
+static int32_t _dtag_diff_patch(dblock_t *from, dblock_t *to, uint8_t **patch, uint32_t *len) {
+  _dpatch_t _patch = {NULL, sizeof(dpatch_head_t), 0, 0};
+  if (!(_patch.buf = malloc(_patch.capacity = 256)))
+    return DTAG_ERR_NOMEM;
+  int32_t result = _dtag_diff(from, to, &_patch);
+  if (result != DTAG_OK) {
+    free(_patch.buf);
+    return result;
+  }
+  dpatch_head_t *head = (dpatch_head_t *)_patch.buf;
+  head->magic = DTAG_PATCH_MAGIC;
+  head->version = DTAG_PATCH_VERSION;
+  head->reserved = 0;
+  head->count = _patch.count;
+  memcpy(head->base, from->chksum, CHKSUM_LENGTH);
+  *patch = _patch.buf;
+  *len = _patch.len;
+  return DTAG_OK;
+}
+
+int32_t dtag_diff(dblock_t *from, dblock_t *to, uint8_t **patch, uint32_t *len) {
+  API_ENTER(DTAG_OP_DIFF);
+  PROBE_ENTER(diff, from, to);
+  int32_t result = _dtag_diff_patch(from, to, patch, len);
+  PROBE_RETURN(diff, result);
+  API_LEAVE(DTAG_OP_DIFF, NULL, 0, result == DTAG_OK ? *len : 0,
+            result == DTAG_OK ? ((dpatch_head_t *)*patch)->count : 0, result);
+  return result;
+}
+
+/* 校验 patch 的头部与全部操作的边界，应用时不再检查 */
+static int32_t _patch_check(const uint8_t *patch, uint32_t len) {
+  const dpatch_head_t *head = (const dpatch_head_t *)patch;
+  if (len < sizeof(dpatch_head_t) || head->magic != DTAG_PATCH_MAGIC || head->version != DTAG_PATCH_VERSION)
+    return DTAG_ERR_DATA;
+  const uint8_t *p = patch + sizeof(dpatch_head_t), *end = patch + len;
+  for (uint32_t i = 0; i < head->count; i++) {
+    if (end - p < PATCH_OP_SIZE)
+      return DTAG_ERR_DATA;
+    uint8_t type = p[0];
+    uint32_t klen = p[1], vlen = _ld32(p + 2);
+    /* extent 中的 value 可超过 `DTAG_MAX_VLEN`，只受 patch 长度约束 */
+    if ((uint64_t)(end - p) - PATCH_OP_SIZE < (uint64_t)klen + vlen)
+      return DTAG_ERR_DATA;
+    /* 与 `dtag_key_prepare_n` 相同的 key 约束 */
+    if (klen >= DTAG_MAX_KLEN || memchr(p + PATCH_OP_SIZE, '\0', klen))
+      return DTAG_ERR_DATA;
+    if ((type == DTAG_PATCH_SET && klen == 0) || (type == DTAG_PATCH_DEL && (klen == 0 || vlen)) ||
+        (type == DTAG_PATCH_SLOT && vlen != sizeof(uint32_t)) || type < DTAG_PATCH_SET || type > DTAG_PATCH_SLOT)
+      return DTAG_ERR_DATA;
+    p += PATCH_OP_SIZE + klen + vlen;
+  }
+  return p == end ? DTAG_OK : DTAG_ERR_DATA;
+}
+
+static int32_t _dtag_patch_apply(dblock_t *block, const uint8_t *patch) {
+  const dpatch_head_t *head = (const dpatch_head_t *)patch;
+  const uint8_t *p = patch + sizeof(dpatch_head_t);
+  int32_t result = DTAG_OK;
+
+  for (uint32_t i = 0; i < head->count && result == DTAG_OK; i++) {
+    uint8_t type = p[0];
+    uint32_t klen = p[1], vlen = _ld32(p + 2);
+    const uint8_t *val = p + PATCH_OP_SIZE + klen;
+    dtag_key_t key = {(const char *)p + PATCH_OP_SIZE, klen, dtag_key_hash((const char *)p + PATCH_OP_SIZE, klen)};
+    ditem_t *item = NULL;
+    p = val + vlen;
+    if (type == DTAG_PATCH_SET) {
+      result = _dtag_set(block, &key, val, vlen, NULL);
+    } else if (type == DTAG_PATCH_DEL) {
+      result = _dtag_del_k(block, &key);
+    } else if (_ld32(val) >= _nslots(block)) {
+      result = DTAG_ERR_INVPARAM;
+    } else if (klen == 0) {
+      _st32(_slot(block, _ld32(val)), DTAG_SLOT_NONE);
+    } else if ((result = _dtag_lookup(block, &key, &item, NULL)) == DTAG_OK) {
+      _st32(_slot(block, _ld32(val)), (uint8_t *)item - block->data);
+    }
+  }
+  return result;
+}
+
+static int32_t _dtag_patch(dblock_t *block, const uint8_t *patch, uint32_t len) {
+  int32_t result = _patch_check(patch, len);
+  if (result != DTAG_OK)
+    return result;
+  if (memcmp(((const dpatch_head_t *)patch)->base, block->chksum, CHKSUM_LENGTH))
+    return DTAG_ERR_CHECKSUM;
+  /* 在副本上应用，全部成功后再写回 */
+  uint32_t size = block->capacity + sizeof(dblock_t);
+  dblock_t *copy = malloc(size);
+  if (!copy)
+    return DTAG_ERR_NOMEM;
+  memcpy(copy, block, size);
+  if ((result = _dtag_patch_apply(copy, patch)) == DTAG_OK) {
+    memcpy(block, copy, size);
+#if CHKSUM_LENGTH != 0
+    _dtag_chksum(block, block->chksum);
+#endif
+  }
+  free(copy);
+  return result;
+}
+
+int32_t dtag_patch_apply(dblock_t *block, const uint8_t *patch, uint32_t len) {
+  API_ENTER(DTAG_OP_PATCH);
+  PROBE_ENTER(patch_apply, block, len);
+  int32_t result = _dtag_patch(block, patch, len);
+  PROBE_RETURN(patch_apply, result);
+  API_LEAVE(DTAG_OP_PATCH, NULL, 0, len, result == DTAG_OK ? ((const dpatch_head_t *)patch)->count : 0, result);
+  return result;
+}
@@ -49,6 +49,8 @@ enum dtag_error {
   DTAG_ERR_FILEIO = -13,
   DTAG_ERR_INVPARAM = -14,
   DTAG_ERR_NOSPACE = -15,
+  DTAG_ERR_FLAGS = -16,
+  DTAG_ERR_NOTSUPP = -17,
 };
 typedef int32_t dtag_error_t;
 
@@ -66,7 +68,12 @@ typedef struct dtag_item ditem_t;
 struct dtag_block {
 #define DTAG_MAGIC 0x44544147
   uint32_t magic;
-#define DTAG_VERSION 0x03
+#define DTAG_VERSION 0x04
+/*
+ * v3 的头部没有 `flags`，其余与 v4 相同；`dtag_import_file`、`dtag_import_files_async` 校验后将其升级为 `flags`
+ * 为 0 的 v4（`data` 后移 4 字节，chksum 不变），不修改调用者缓冲区的 `dtag_import` 等接口仍返回 DTAG_ERR_VERSION
+ */
+#define DTAG_VERSION_V3 0x03
   uint16_t version;
   // Fixed as CHKSUM_LENGTH
   uint16_t chksum_length;
@@ -74,12 +81,145 @@ struct dtag_block {
   uint32_t capacity;
   // The length of the data in bytes.
   uint32_t length;
+  // The features of the block, see `DTAG_FLAG_xxx`.
+  uint32_t flags;
   // The checksum of the data.
   uint8_t chksum[CHKSUM_LENGTH];
   uint8_t data[];
 } __attribute__((packed));
 typedef struct dtag_block dblock_t;
 
+/*
+ * `ditem` 按 key 的字节序排列，`data` 尾部附带偏移表：
+ *   data: | ditem ... | offset[0] ... offset[count - 1] | count |
+ * `offset` 为 `ditem` 相对 `data` 的偏移，`length` 包含偏移表
+ */
+#define DTAG_FLAG_SORTED 0x00000001
+/*
+ * `data` 头部附带固定大小的 Bloom filter，用于快速判定 key 不存在：
+ *   data: | bloom | ditem ... |
+ * `length` 包含 bloom
+ */
+#define DTAG_FLAG_BLOOM 0x00000002
+#define DTAG_BLOOM_SIZE (256)
+#define DTAG_BLOOM_HASHES (3)
+/*
+ * `data` 头部（bloom 之后）附带槽位表，将编译期确定的 key 映射为固定序号：
+ *   data: | [bloom] | nslots | offset[0] ... offset[nslots - 1] | ditem ... |
+ * `offset` 为槽位对应 `ditem` 相对 `data` 的偏移，未设置时为 `DTAG_SLOT_NONE`；
+ * 槽位对应的 `ditem` 仍位于链中，按 key 访问、遍历均不受影响
+ */
+#define DTAG_FLAG_SCHEMA 0x00000004
+#define DTAG_SLOT_NONE 0xFFFFFFFF
+/*
+ * `ditem` 使用紧凑编码，key 不再以 null 结尾：
+ *   ditem: | klen (LEB128) | vlen (LEB128) | key | value |
+ * 此时 `ditem_t` 仅作为不透明的指针，需通过 `dtag_item_view` 访问
+ */
+#define DTAG_FLAG_VARINT 0x00000008
+/*
+ * value 相对 `dblock` 起始处按 `DTAG_ALIGN` 对齐，`ditem` 的首尾均填充 0：
+ *   data: | [bloom] | [slots] | pad | ditem ... |
+ *   ditem: | klen | vlen | key | pad | value | pad |
+ * `buf` 同样对齐时（如 malloc、`dtag_import_file`），value 可原位按类型访问；不可与 `DTAG_FLAG_VARINT` 同时使用
+ */
+#define DTAG_FLAG_ALIGNED 0x00000010
+#define DTAG_ALIGN (8)
+/*
+ * value 前附带 codec，不小于 `DTAG_COMPRESS_MIN` 且压缩后更短的 value 以 LZ4 存储：
+ *   value: | 0 | raw ... |  或  | 1 | rawlen (uint32) | lz4 ... |
+ * 不可与 `DTAG_FLAG_ALIGNED` 同时使用
+ */
+#define DTAG_FLAG_COMPRESS 0x00000020
+#define DTAG_COMPRESS_MIN (256)
+/*
+ * 不小于 `DTAG_DEDUP_MIN` 的 value 存入 `ditem` 之后的共享池，按内容去重并记录引用数：
+ *   data: | ... | ditem ... | entry ... | pool_size | [offset ... count] |
+ *   entry: | refs | hash | len | value |
+ * `ditem` 中仅保留引用 `| 2 | entry offset (uint32) |`，`entry offset` 相对池的起始处；
+ * value 前的 codec 同 `DTAG_FLAG_COMPRESS`，不可与 `DTAG_FLAG_ALIGNED` 同时使用
+ */
+#define DTAG_FLAG_DEDUP 0x00000040
+#define DTAG_DEDUP_MIN (64)
+/*
+ * 不小于 `DTAG_EXTENT_MIN` 的 value 存入槽位表之后、`ditem` 之前的 extent 区，查找与遍历只经过紧凑的 `ditem` 链：
+ *   data: | [bloom] | [slots] | extent_size | extent ... | ditem ... |
+ * `ditem` 中仅保留引用 `| 3 | extent offset (uint32) | len (uint32) |`，`extent offset` 相对 extent 区的起始处；
+ * extent 中的 value 不压缩、不去重，长度不受 `DTAG_MAX_VLEN` 限制，可经 `dtag_get_range` 部分读取；
+ * 新增 extent 时其后的 `ditem` 整体后移，新增 `ditem` 不移动 extent；不可与 `DTAG_FLAG_ALIGNED` 同时使用
+ */
+#define DTAG_FLAG_EXTENT 0x00000080
+#define DTAG_EXTENT_MIN (4096)
+/*
+ * `chksum` 按树形计算：`data` 每 `DTAG_TREE_CHUNK` 字节为一段，先分别计算各段的 chksum，
+ * 再对依次拼接的各段 chksum 计算 chksum；各段互不依赖，较大的 `dblock` 由多个线程分担
+ */
+#define DTAG_FLAG_TREEHASH 0x00000100
+#define DTAG_TREE_CHUNK (1u << 20)
+#define DTAG_FLAG_MASK                                                                                                 \
+  (DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM | DTAG_FLAG_SCHEMA | DTAG_FLAG_VARINT | DTAG_FLAG_ALIGNED | DTAG_FLAG_COMPRESS | \
+   DTAG_FLAG_DEDUP | DTAG_FLAG_EXTENT | DTAG_FLAG_TREEHASH)
+
+/*
+ * 导入时的校验方式，可组合；头部与布局总是检查：
+ * - DEFERRED: 不计算 chksum，之后按需调用 `dtag_verify` 或 `dtag_verify_start`
+ * - FULL: 计算并校验 chksum（同 `dtag_import`）
+ * - STRUCTURE: 逐个检查 `ditem` 链，以及槽位表、偏移表是否指向 `ditem`（见 `dtag_verify_items`）
+ */
+#define DTAG_VERIFY_DEFERRED 0x00000000
+#define DTAG_VERIFY_FULL 0x00000001
+#define DTAG_VERIFY_STRUCTURE 0x00000002
+
+/*
+ * 以 X-macro 定义 schema，生成槽位序号与 key 列表：
+ *   #define BOARD_SCHEMA(X) X(SLOT_SERIAL, "serial") X(SLOT_MAC, "mac")
+ *   enum { BOARD_SCHEMA(DTAG_SCHEMA_SLOT) SLOT_COUNT };
+ *   static const char *const board_keys[] = {BOARD_SCHEMA(DTAG_SCHEMA_KEY)};
+ */
+#define DTAG_SCHEMA_SLOT(slot, key) slot,
+#define DTAG_SCHEMA_KEY(slot, key) key,
+
+/* `dtag_get_path` 中各层 key 的分隔符，路径中的 key 不能包含它 */
+#define DTAG_PATH_SEP '/'
+
+/**
+ * @brief 预处理后的 key，可重复用于 `dtag_xxx_k`，避免每次调用都计算长度与哈希
+ * @note 由 `dtag_key_prepare` 或 `dtag.hpp` 中的 `dtag::key` 生成
+ */
+typedef struct dtag_key {
+  // 不要求以 null 结尾
+  const char *str;
+  // 不含 null-terminator
+  uint32_t len;
+  // FNV-1a，见 `dtag_key_hash`
+  uint32_t hash;
+} dtag_key_t;
+#define DTAG_KEY_HASH_BASIS 2166136261u
+#define DTAG_KEY_HASH_PRIME 16777619u
+
+/**
+ * @brief `ditem` 解码后的视图，与编码方式无关
+ */
+typedef struct dtag_view {
+  // 不保证以 null 结尾
+  const char *key;
+  // 不含 null-terminator
+  uint32_t klen;
+  uint8_t *val;
+  uint32_t vlen;
+  // value 的原始长度，与 `vlen` 不同时 `val` 为压缩数据，需经 `dtag_item_value` 取值
+  uint32_t rawlen;
+} dtag_view_t;
+
+/**
+ * @brief 遍历回调
+ *
+ * @param item
+ * @param arg 用户参数
+ * @return * int32_t 返回非 0 时停止遍历
+ */
+typedef int32_t (*dtag_scan_f)(ditem_t *item, void *arg);
+
 /**
  * @brief 在已知的 buffer 上划定 `len` 大小的连续区域作为 `dblock` 并初始化
  * 
@@ -89,6 +229,27 @@ typedef struct dtag_block dblock_t;
  * @return * int32_t 
  */
 extern int32_t dtag_init(dblock_t **block, uint8_t *buf, uint32_t len);
+/**
+ * @brief 同 `dtag_init`，并指定 `dblock` 的特性
+ *
+ * @param block
+ * @param buf
+ * @param len
+ * @param flags `DTAG_FLAG_xxx` 的组合
+ * @return * int32_t
+ */
+extern int32_t dtag_init_ex(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t flags);
+/**
+ * @brief 同 `dtag_init_ex`，并附带 `nslots` 个槽位（隐含 `DTAG_FLAG_SCHEMA`）
+ *
+ * @param block
+ * @param buf
+ * @param len
+ * @param flags
+ * @param nslots 槽位数量，通常为 schema 中 key 的数量
+ * @return * int32_t
+ */
+extern int32_t dtag_init_schema(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t flags, uint32_t nslots);
 /**
  * @brief 在已知的 buffer 上取 `len` 大小的连续区域视为 `dblock` 并尝试解析
  * 
@@ -98,6 +259,54 @@ extern int32_t dtag_init(dblock_t **block, uint8_t *buf, uint32_t len);
  * @return * int32_t 
  */
 extern int32_t dtag_import(dblock_t **block, uint8_t *buf, uint32_t len);
+/**
+ * @brief 同 `dtag_import`，并指定校验方式
+ *
+ * @param block
+ * @param buf
+ * @param len
+ * @param mode `DTAG_VERIFY_xxx` 的组合
+ * @return * int32_t
+ */
+extern int32_t dtag_import_ex(dblock_t **block, uint8_t *buf, uint32_t len, uint32_t mode);
+/**
+ * @brief 计算并校验 `chksum`，用于以 `DTAG_VERIFY_DEFERRED` 导入的 `dblock`
+ *
+ * @param block
+ * @return * int32_t 不一致时，返回 DTAG_ERR_CHECKSUM
+ */
+extern int32_t dtag_verify(const dblock_t *block);
+/**
+ * @brief 逐个检查 `ditem` 链，并确认槽位表、偏移表中的偏移均指向链上的 `ditem`，有序 `dblock` 的 key 严格递增
+ *
+ * @param block
+ * @param offsets 返回各 `ditem` 相对 `data` 的偏移（按链上的顺序），可作为随机访问的索引；可以传入 NULL
+ * @param count 传入 `offsets` 的容量，同时返回 `ditem` 的数量；当 `offsets` 传入 NULL 时，可以传入 NULL
+ * @return * int32_t 结构非法时，返回 DTAG_ERR_DATA；`offsets` 容量不足时，返回 DTAG_ERR_NOSPACE
+ */
+extern int32_t dtag_verify_items(dblock_t *block, uint32_t *offsets, uint32_t *count);
+
+/**
+ * @brief 后台校验 `chksum` 的句柄
+ */
+typedef struct dtag_verify dverify_t;
+/**
+ * @brief 在后台线程中执行 `dtag_verify`
+ *
+ * @note 在 `dtag_verify_wait` 返回前，不得修改或释放 `block`
+ *
+ * @param verify 返回句柄，须以 `dtag_verify_wait` 回收
+ * @param block
+ * @return * int32_t
+ */
+extern int32_t dtag_verify_start(dverify_t **verify, const dblock_t *block);
+/**
+ * @brief 等待后台校验结束并回收句柄
+ *
+ * @param verify
+ * @return * int32_t `dtag_verify` 的结果
+ */
+extern int32_t dtag_verify_wait(dverify_t *verify);
 /**
  * @brief 计算 `chksum`
  * 
@@ -123,6 +332,69 @@ extern int32_t dtag_import_file(dblock_t **block, const char *filename);
  */
 extern int32_t dtag_export_file(dblock_t *block, const char *filename);
 
+/**
+ * @brief 批量读写文件时，单个文件完成（成功或失败）的回调，按完成的先后调用
+ *
+ * @param index 文件在 `filenames` 中的下标
+ * @param block 导入失败时为 NULL
+ * @param result
+ * @param arg
+ */
+typedef void (*dtag_file_cb_t)(uint32_t index, dblock_t *block, int32_t result, void *arg);
+/**
+ * @brief 批量从文件中读取数据并尝试解析为 `dblock`
+ *
+ * @note 使用 io_uring 一次提交多个文件的读请求，头部到达后即校验并提交其余部分的读取；
+ * io_uring 不可用时退化为 pread
+ *
+ * @param blocks 返回 `count` 个 `dblock` 指针（需要用户释放），失败的为 NULL
+ * @param filenames
+ * @param count
+ * @param cb 可为 NULL
+ * @param arg
+ * @return * int32_t 全部成功时返回 DTAG_OK；否则返回下标最小的失败文件的错误
+ */
+extern int32_t dtag_import_files_async(dblock_t *blocks[], const char *const filenames[], uint32_t count,
+                                       dtag_file_cb_t cb, void *arg);
+/**
+ * @brief 批量将 `dblock` 完整写入到文件中，io_uring 不可用时退化为 pwrite
+ *
+ * @param blocks
+ * @param filenames
+ * @param count
+ * @param cb 可为 NULL
+ * @param arg
+ * @return * int32_t 全部成功时返回 DTAG_OK；否则返回下标最小的失败文件的错误
+ */
+extern int32_t dtag_export_files_async(dblock_t *const blocks[], const char *const filenames[], uint32_t count,
+                                       dtag_file_cb_t cb, void *arg);
+
+/**
+ * @brief 计算 key 的哈希（FNV-1a）
+ *
+ * @param str
+ * @param len
+ * @return * uint32_t
+ */
+extern uint32_t dtag_key_hash(const char *str, uint32_t len);
+/**
+ * @brief 预处理 key
+ *
+ * @param key 返回预处理结果，引用 `str`（需保证 `str` 的生命周期）
+ * @param str null-terminated 字符串，会检查合法性（满足 `DTAG_MAX_KLEN`）
+ * @return * int32_t
+ */
+extern int32_t dtag_key_prepare(dtag_key_t *key, const char *str);
+/**
+ * @brief 同 `dtag_key_prepare`，`str` 不要求以 null 结尾
+ *
+ * @param key
+ * @param str 不能包含 null
+ * @param len
+ * @return * int32_t
+ */
+extern int32_t dtag_key_prepare_n(dtag_key_t *key, const char *str, uint32_t len);
+
 /**
  * @brief 获取下一个 `ditem`
  * @note 会检查当前和下一个 `ditem` 的合法性
@@ -132,8 +404,109 @@ extern int32_t dtag_export_file(dblock_t *block, const char *filename);
  * @return * int32_t
  */
 extern int32_t dtag_next(dblock_t *block, ditem_t **curr);
+/**
+ * @brief 获取 `ditem` 链所在的区域（相对 `data`）
+ *
+ * @param block
+ * @param offset 返回首个 `ditem` 的偏移
+ * @param length 返回 `ditem` 链的长度
+ * @return * void
+ */
+extern void dtag_items_region(dblock_t *block, uint32_t *offset, uint32_t *length);
+/**
+ * @brief 解码 `ditem`
+ * @note `item` 需来自 `block` 上的 dtag API（如 `dtag_next`、`dtag_get_inner`），此时已校验过
+ *
+ * @param block
+ * @param item
+ * @param view 返回 key 与 value 的位置与长度
+ * @return * void
+ */
+extern void dtag_item_view(const dblock_t *block, const ditem_t *item, dtag_view_t *view);
+/**
+ * @brief 取 `ditem` 的 value，压缩的 value 会被解压
+ * @note `item` 的要求同 `dtag_item_view`
+ *
+ * @param block
+ * @param item
+ * @param val 同 `dtag_get`
+ * @param len 同 `dtag_get`
+ * @return * int32_t buffer 不足时，返回 DTAG_ERR_NOSPACE；压缩数据非法时，返回 DTAG_ERR_DATA
+ */
+extern int32_t dtag_item_value(const dblock_t *block, const ditem_t *item, uint8_t *val, uint32_t *len);
+/**
+ * @brief 将 `src` 的全部 `ditem`（及槽位）写入 `dst`，用于在不同特性（如编码方式）间转换
+ * @note `dst` 通常为刚初始化的空 `dblock`；槽位按序号对应，`dst` 中不存在的槽位被忽略
+ *
+ * @param dst
+ * @param src
+ * @return * int32_t 容量不足时，返回 DTAG_ERR_CAPACITY
+ */
+extern int32_t dtag_convert(dblock_t *dst, dblock_t *src);
+
+/*
+ * patch 为 `dpatch_head_t` 后接 `count` 条操作，按序应用：
+ *   op: | type | klen | vlen (uint32) | key | value |
+ * DEL 不带 value；SLOT 的 value 为槽位序号（uint32），klen 为 0 时解除绑定
+ */
+struct dtag_patch_head {
+#define DTAG_PATCH_MAGIC 0x48435044
+  uint32_t magic;
+#define DTAG_PATCH_VERSION 0x01
+  uint16_t version;
+  uint16_t reserved;
+  // The number of ops following the head.
+  uint32_t count;
+  // The checksum of the block the patch applies to.
+  uint8_t base[CHKSUM_LENGTH];
+} __attribute__((packed));
+typedef struct dtag_patch_head dpatch_head_t;
+#define DTAG_PATCH_SET 0x01
+#define DTAG_PATCH_DEL 0x02
+#define DTAG_PATCH_SLOT 0x03
+
+/**
+ * @brief 生成将 `from` 变为 `to` 的 patch，value 相同的 `ditem` 不出现在 patch 中
+ * @note `from` 须已 `dtag_complete`，其 chksum 作为应用的前提；操作按 DEL、SET、SLOT 排列，
+ * 应用时不需要同时容纳新旧 `ditem`
+ *
+ * @param from
+ * @param to
+ * @param patch 返回 patch（需要用户释放）
+ * @param len 返回 patch 的长度
+ * @return * int32_t
+ */
+extern int32_t dtag_diff(dblock_t *from, dblock_t *to, uint8_t **patch, uint32_t *len);
+/**
+ * @brief 将 `patch` 应用到 `block` 并重新计算 chksum；任一操作失败时 `block` 保持不变
+ *
+ * @param block
+ * @param patch
+ * @param len
+ * @return * int32_t `block` 的 chksum 与 patch 的前提不一致时，返回 DTAG_ERR_CHECKSUM；patch 非法时，返回 DTAG_ERR_DATA
+ */
+extern int32_t dtag_patch_apply(dblock_t *block, const uint8_t *patch, uint32_t len);
+/**
+ * @brief 估算 Bloom filter 当前的误判率
+ *
+ * @param block
+ * @return * double 未启用 Bloom filter 时返回 1
+ */
+extern double dtag_bloom_fpr(const dblock_t *block);
+/**
+ * @brief 遍历 key 以 `prefix` 开头的 `ditem`
+ * @note 有序 `dblock` 上只访问匹配的区间；否则需要完整遍历
+ *
+ * @param block
+ * @param prefix 可以传入 NULL 或空串，此时遍历全部
+ * @param cb
+ * @param arg 透传给 `cb`
+ * @return * int32_t `cb` 返回非 0 时，返回该值；以及其他错误
+ */
+extern int32_t dtag_scan_prefix(dblock_t *block, const char *prefix, dtag_scan_f cb, void *arg);
 /**
  * @brief 获取 `ditem`
+ * @note 有序 `dblock` 上为二分查找；启用 Bloom filter 时，多数不存在的 key 无需查找
  *
  * @param block
  * @param key 会检查合法性（满足 `DTAG_MAX_KLEN`）
@@ -141,6 +514,7 @@ extern int32_t dtag_next(dblock_t *block, ditem_t **curr);
  * @return * int32_t 成功找到时，返回 DTAG_OK；未找到，返回 DTAG_ERR_NOTFOUND；以及其他错误
  */
 extern int32_t dtag_get_inner(dblock_t *block, const char *key, ditem_t **item);
+extern int32_t dtag_get_inner_k(dblock_t *block, const dtag_key_t *key, ditem_t **item);
 /**
  * @brief
  *
@@ -151,7 +525,34 @@ extern int32_t dtag_get_inner(dblock_t *block, const char *key, ditem_t **item);
  * @return * int32_t 成功找到时，返回 DTAG_OK；未找到，返回 DTAG_ERR_NOTFOUND；以及其他错误
  */
 extern int32_t dtag_get(dblock_t *block, const char *key, uint8_t *val, uint32_t *len);
+extern int32_t dtag_get_k(dblock_t *block, const dtag_key_t *key, uint8_t *val, uint32_t *len);
+/**
+ * @brief 读取 value 中自 `off` 起的至多 `*len` 字节；extent 中的 value 直接复制所需部分，压缩的 value 需整体解压
+ *
+ * @param block
+ * @param key
+ * @param off value 内的偏移
+ * @param val 传入一个 buffer，用于存储读取的部分
+ * @param len 传入 buffer 的大小，同时返回读取的字节数（不超过 value 在 `off` 之后的长度）
+ * @return * int32_t `off` 超出 value 的长度时，返回 DTAG_ERR_INVPARAM；以及 `dtag_get` 的错误
+ */
+extern int32_t dtag_get_range(dblock_t *block, const char *key, uint32_t off, uint8_t *val, uint32_t *len);
+/**
+ * @brief 同 `dtag_get_range`，但以 pread 直接读取文件：跳过 extent 区读入其余部分，再只读取所需的 value
+ *
+ * @note 不校验 chksum，仅检查结构
+ *
+ * @param filename
+ * @param key
+ * @param off
+ * @param val
+ * @param len
+ * @return * int32_t
+ */
+extern int32_t dtag_get_range_file(const char *filename, const char *key, uint32_t off, uint8_t *val,
+                                   uint32_t *len);
 extern int32_t dtag_del(dblock_t *block, const char *key);
+extern int32_t dtag_del_k(dblock_t *block, const dtag_key_t *key);
 /**
  * @brief
  *
@@ -162,6 +563,91 @@ extern int32_t dtag_del(dblock_t *block, const char *key);
  * @return * int32_t
  */
 extern int32_t dtag_set(dblock_t *block, const char *key, const uint8_t *val, uint32_t len);
+extern int32_t dtag_set_k(dblock_t *block, const dtag_key_t *key, const uint8_t *val, uint32_t len);
+/**
+ * @brief 写入 `key`，value 为新初始化的空 `dblock`，并返回其位置，可原位读写
+ *
+ * @note value 不压缩、不共享；外层 `dblock` 的任何修改都可能移动 `sub`，此后需重新 `dtag_get_sub`。
+ * 修改 `sub` 后，对外层调用 `dtag_complete` 即可，`sub` 的 chksum 不在导航时校验
+ *
+ * @param block
+ * @param key
+ * @param capacity `sub` 的 `capacity`
+ * @param flags `sub` 的特性，同 `dtag_init_ex`
+ * @param sub 返回嵌套的 `dblock`（实际指向 `block` 内 value 的位置）
+ * @return * int32_t
+ */
+extern int32_t dtag_set_sub(dblock_t *block, const char *key, uint32_t capacity, uint32_t flags, dblock_t **sub);
+/**
+ * @brief 将 `key` 的 value 视为嵌套的 `dblock`，不复制
+ *
+ * @param block
+ * @param key
+ * @param sub 返回嵌套的 `dblock`（实际指向 `block` 内 value 的位置）
+ * @return * int32_t value 被压缩或共享时，返回 DTAG_ERR_NOTSUPP；不是 `dblock` 时，返回 `dtag_import` 的错误
+ */
+extern int32_t dtag_get_sub(dblock_t *block, const char *key, dblock_t **sub);
+/**
+ * @brief 按 `DTAG_PATH_SEP` 分隔的路径（如 "radio/cal/band3"）逐层进入嵌套的 `dblock` 后读取 value，
+ *        每层只在该层的 `ditem` 中查找
+ *
+ * @param block
+ * @param path 除最后一个分量外，均须为嵌套的 `dblock`
+ * @param val 同 `dtag_get`
+ * @param len 同 `dtag_get`
+ * @return * int32_t 同 `dtag_get` 与 `dtag_get_sub`
+ */
+extern int32_t dtag_get_path(dblock_t *block, const char *path, uint8_t *val, uint32_t *len);
+
+/**
+ * @brief 按类型原位读取 value，无需经由 buffer 拷贝
+ *
+ * @param block
+ * @param key
+ * @param out 返回 value（主机字节序）
+ * @return * int32_t value 长度与类型不符时，返回 DTAG_ERR_LEN；以及 `dtag_get` 的错误
+ */
+extern int32_t dtag_get_u32(dblock_t *block, const char *key, uint32_t *out);
+extern int32_t dtag_get_u32_k(dblock_t *block, const dtag_key_t *key, uint32_t *out);
+extern int32_t dtag_get_u64(dblock_t *block, const char *key, uint64_t *out);
+extern int32_t dtag_get_u64_k(dblock_t *block, const dtag_key_t *key, uint64_t *out);
+extern int32_t dtag_get_f64(dblock_t *block, const char *key, double *out);
+extern int32_t dtag_get_f64_k(dblock_t *block, const dtag_key_t *key, double *out);
+/**
+ * @brief 将 8 字节的 value 原子地加上 `delta`，可与其他线程的读取、累加并发
+ * @note 不更新校验和，导出前需 `dtag_complete`；不可与修改 `dblock` 结构的操作并发
+ *
+ * @param block
+ * @param key
+ * @param delta
+ * @param out 返回相加后的值；可以传入 NULL
+ * @return * int32_t value 地址未按 8 字节对齐（见 `DTAG_FLAG_ALIGNED`）时，返回 DTAG_ERR_NOTSUPP；
+ *                   长度不为 8 时，返回 DTAG_ERR_LEN；以及 `dtag_get` 的错误
+ */
+extern int32_t dtag_add_u64(dblock_t *block, const char *key, uint64_t delta, uint64_t *out);
+extern int32_t dtag_add_u64_k(dblock_t *block, const dtag_key_t *key, uint64_t delta, uint64_t *out);
+
+/**
+ * @brief 按槽位直接获取 `ditem`，无需查找
+ *
+ * @param block
+ * @param slot
+ * @param item 成功时指向 `ditem`；可以传入 NULL
+ * @return * int32_t 槽位未设置时，返回 DTAG_ERR_NOTFOUND；槽位越界，返回 DTAG_ERR_INVPARAM
+ */
+extern int32_t dtag_get_slot(dblock_t *block, uint32_t slot, ditem_t **item);
+/**
+ * @brief 同 `dtag_set_k`，并将 `key` 绑定到槽位
+ * @note 之后经 `dtag_set`/`dtag_del` 修改该 key 时，槽位会随之更新
+ *
+ * @param block
+ * @param slot
+ * @param key 该槽位在 schema 中的 key
+ * @param val
+ * @param len
+ * @return * int32_t
+ */
+extern int32_t dtag_set_slot(dblock_t *block, uint32_t slot, const dtag_key_t *key, const uint8_t *val, uint32_t len);
 
 #ifdef __cplusplus
 }
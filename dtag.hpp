@@ -0,0 +1,379 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_HPP__
+#define __DTAG_HPP__
+
+#include "dtag.h"
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dtag {
+
+/**
+ * @brief 编译期计算 key 的哈希，与 `dtag_key_hash` 一致
+ */
+constexpr uint32_t key_hash(const char *str, uint32_t len) {
+  uint32_t hash = DTAG_KEY_HASH_BASIS;
+  for (uint32_t i = 0; i < len; i++) {
+    hash ^= static_cast<uint8_t>(str[i]);
+    hash *= DTAG_KEY_HASH_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * @brief 由字面量编译期生成 `dtag_key_t`
+ *
+ *   constexpr dtag_key_t kSerial = dtag::key("serial");
+ *   dtag_get_k(block, &kSerial, buf, &len);
+ */
+template <std::size_t N> constexpr dtag_key_t key(const char (&str)[N]) {
+  static_assert(N - 1 < DTAG_MAX_KLEN, "key is too long");
+  return dtag_key_t{str, static_cast<uint32_t>(N - 1), key_hash(str, N - 1)};
+}
+
+/**
+ * @brief 编译期 schema：key 的序号即槽位
+ *
+ *   constexpr auto kBoard = dtag::schema("serial", "mac");
+ *   constexpr uint32_t SLOT_SERIAL = kBoard.slot("serial");
+ *   block.set_slot(SLOT_SERIAL, kBoard[SLOT_SERIAL], "SN0001");
+ */
+template <std::size_t N> struct Schema {
+  dtag_key_t keys[N];
+
+  static constexpr uint32_t size() { return N; }
+  constexpr const dtag_key_t &operator[](uint32_t slot) const { return keys[slot]; }
+  /**
+   * @brief 未定义的 key 返回 `DTAG_SLOT_NONE`
+   */
+  constexpr uint32_t slot(std::string_view key) const {
+    for (uint32_t i = 0; i < N; i++) {
+      if (std::string_view(keys[i].str, keys[i].len) == key)
+        return i;
+    }
+    return DTAG_SLOT_NONE;
+  }
+};
+
+template <std::size_t... N> constexpr Schema<sizeof...(N)> schema(const char (&...keys)[N]) {
+  return Schema<sizeof...(N)>{{key(keys)...}};
+}
+
+/**
+ * @brief `ditem` 的只读视图，直接引用 `dblock` 内的数据
+ */
+class Item {
+public:
+  Item(const dblock_t *block, ditem_t *item) : item_(item) { dtag_item_view(block, item, &view_); }
+
+  std::string_view key() const { return {view_.key, view_.klen}; }
+  /* 压缩的 value 需经 `Block::read` 取值，`value` 返回的是压缩后的数据 */
+  bool compressed() const { return view_.rawlen != view_.vlen; }
+  std::span<const std::byte> value() const { return {reinterpret_cast<const std::byte *>(view_.val), view_.vlen}; }
+  std::string_view value_str() const { return {reinterpret_cast<const char *>(view_.val), view_.vlen}; }
+  ditem_t *raw() const { return item_; }
+
+private:
+  ditem_t *item_;
+  dtag_view_t view_;
+};
+
+/**
+ * @brief `dblock` 的 RAII 封装（move-only）
+ * @note 持有时以 `free` 释放（与 `dtag_import_file` 一致）；借用时不释放
+ */
+class Block {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Item;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Item;
+
+    iterator() = default;
+    iterator(dblock_t *block, ditem_t *curr) : block_(block), curr_(curr) {}
+
+    Item operator*() const { return Item(block_, curr_); }
+    /* 遍历出错时视为结束 */
+    iterator &operator++() {
+      if (dtag_next(block_, &curr_) != DTAG_OK)
+        curr_ = nullptr;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    bool operator==(const iterator &other) const { return curr_ == other.curr_; }
+    bool operator!=(const iterator &other) const { return curr_ != other.curr_; }
+
+  private:
+    dblock_t *block_ = nullptr;
+    ditem_t *curr_ = nullptr;
+  };
+
+  Block() = default;
+  Block(const Block &) = delete;
+  Block &operator=(const Block &) = delete;
+  Block(Block &&other) noexcept
+      : block_(std::exchange(other.block_, nullptr)), owned_(std::exchange(other.owned_, false)) {}
+  Block &operator=(Block &&other) noexcept {
+    if (this != &other) {
+      reset();
+      block_ = std::exchange(other.block_, nullptr);
+      owned_ = std::exchange(other.owned_, false);
+    }
+    return *this;
+  }
+  ~Block() { reset(); }
+
+  /**
+   * @brief 借用已有的 `dblock`，析构时不释放
+   */
+  static Block borrow(dblock_t *block) { return Block(block, false); }
+  /**
+   * @brief 接管以 `malloc` 分配的 `dblock`，析构时 `free`
+   */
+  static Block adopt(dblock_t *block) { return Block(block, true); }
+
+  /**
+   * @brief 分配并初始化容量为 `capacity` 的 `dblock`
+   */
+  static int32_t create(Block &out, uint32_t capacity, uint32_t flags = 0, uint32_t nslots = 0) {
+    if (capacity > UINT32_MAX - sizeof(dblock_t))
+      return DTAG_ERR_CAPACITY;
+    uint8_t *buf = static_cast<uint8_t *>(std::malloc(capacity + sizeof(dblock_t)));
+    if (!buf)
+      return DTAG_ERR_NOMEM;
+    dblock_t *block = nullptr;
+    int32_t result = nslots ? dtag_init_schema(&block, buf, capacity + sizeof(dblock_t), flags, nslots)
+                            : dtag_init_ex(&block, buf, capacity + sizeof(dblock_t), flags);
+    if (result != DTAG_OK) {
+      std::free(buf);
+      return result;
+    }
+    out = adopt(block);
+    return DTAG_OK;
+  }
+  /**
+   * @brief 在 `buf` 上解析 `dblock`（借用），`mode` 见 `DTAG_VERIFY_xxx`
+   */
+  static int32_t import(Block &out, uint8_t *buf, uint32_t len, uint32_t mode = DTAG_VERIFY_FULL) {
+    dblock_t *block = nullptr;
+    int32_t result = dtag_import_ex(&block, buf, len, mode);
+    if (result == DTAG_OK)
+      out = borrow(block);
+    return result;
+  }
+  static int32_t import_file(Block &out, const char *filename) {
+    dblock_t *block = nullptr;
+    int32_t result = dtag_import_file(&block, filename);
+    if (result == DTAG_OK)
+      out = adopt(block);
+    return result;
+  }
+  int32_t export_file(const char *filename) const { return dtag_export_file(block_, filename); }
+  void complete() { dtag_complete(block_); }
+
+  /**
+   * @brief 查找 `key`，返回的视图在下一次修改 `dblock` 前有效
+   */
+  std::optional<Item> find(const dtag_key_t &key) const {
+    ditem_t *item = nullptr;
+    if (dtag_get_inner_k(block_, &key, &item) != DTAG_OK)
+      return std::nullopt;
+    return Item(block_, item);
+  }
+  std::optional<Item> find(std::string_view key) const {
+    dtag_key_t _key;
+    if (prepare(_key, key) != DTAG_OK)
+      return std::nullopt;
+    return find(_key);
+  }
+  /**
+   * @brief 零拷贝取值；压缩的 value 返回 `std::nullopt`，需用 `read`
+   */
+  template <typename K> std::optional<std::span<const std::byte>> get(const K &key) const {
+    auto item = find(key);
+    if (!item || item->compressed())
+      return std::nullopt;
+    return item->value();
+  }
+  template <typename K> std::optional<std::string_view> get_str(const K &key) const {
+    auto item = find(key);
+    if (!item || item->compressed())
+      return std::nullopt;
+    return item->value_str();
+  }
+  /**
+   * @brief 将 value 复制到 `out`，压缩的 value 会被解压
+   */
+  template <typename K> int32_t read(const K &key, std::vector<std::byte> &out) const {
+    auto item = find(key);
+    if (!item)
+      return DTAG_ERR_NOTFOUND;
+    uint32_t len = 0;
+    dtag_item_value(block_, item->raw(), nullptr, &len);
+    out.resize(len);
+    return dtag_item_value(block_, item->raw(), reinterpret_cast<uint8_t *>(out.data()), &len);
+  }
+  /**
+   * @brief 按类型原位读取 value，`T` 为 `uint32_t`、`uint64_t` 或 `double`
+   */
+  template <typename T> std::optional<T> get_as(const dtag_key_t &key) const {
+    T out;
+    int32_t result;
+    if constexpr (std::is_same_v<T, uint32_t>)
+      result = dtag_get_u32_k(block_, &key, &out);
+    else if constexpr (std::is_same_v<T, uint64_t>)
+      result = dtag_get_u64_k(block_, &key, &out);
+    else {
+      static_assert(std::is_same_v<T, double>, "unsupported value type");
+      result = dtag_get_f64_k(block_, &key, &out);
+    }
+    if (result != DTAG_OK)
+      return std::nullopt;
+    return out;
+  }
+  template <typename T> std::optional<T> get_as(std::string_view key) const {
+    dtag_key_t _key;
+    if (prepare(_key, key) != DTAG_OK)
+      return std::nullopt;
+    return get_as<T>(_key);
+  }
+  /**
+   * @brief 见 `dtag_add_u64`
+   */
+  int32_t add(const dtag_key_t &key, uint64_t delta, uint64_t *out = nullptr) {
+    return dtag_add_u64_k(block_, &key, delta, out);
+  }
+  int32_t add(std::string_view key, uint64_t delta, uint64_t *out = nullptr) {
+    dtag_key_t _key;
+    int32_t result = prepare(_key, key);
+    if (result != DTAG_OK)
+      return result;
+    return add(_key, delta, out);
+  }
+  std::optional<Item> slot(uint32_t slot) const {
+    ditem_t *item = nullptr;
+    if (dtag_get_slot(block_, slot, &item) != DTAG_OK)
+      return std::nullopt;
+    return Item(block_, item);
+  }
+  /**
+   * @brief 嵌套的 `dblock`（借用），见 `dtag_get_sub`；外层修改后失效
+   */
+  std::optional<Block> sub(const char *key) const {
+    dblock_t *sub = nullptr;
+    if (dtag_get_sub(block_, key, &sub) != DTAG_OK)
+      return std::nullopt;
+    return borrow(sub);
+  }
+  bool contains(const dtag_key_t &key) const { return dtag_get_inner_k(block_, &key, nullptr) == DTAG_OK; }
+  bool contains(std::string_view key) const { return find(key).has_value(); }
+
+  int32_t set(const dtag_key_t &key, std::span<const std::byte> val) {
+    return dtag_set_k(block_, &key, reinterpret_cast<const uint8_t *>(val.data()), val.size());
+  }
+  int32_t set(const dtag_key_t &key, std::string_view val) { return set(key, std::as_bytes(std::span(val))); }
+  template <typename V> int32_t set(std::string_view key, const V &val) {
+    dtag_key_t _key;
+    int32_t result = prepare(_key, key);
+    if (result != DTAG_OK)
+      return result;
+    return set(_key, val);
+  }
+  int32_t set_slot(uint32_t slot, const dtag_key_t &key, std::span<const std::byte> val) {
+    return dtag_set_slot(block_, slot, &key, reinterpret_cast<const uint8_t *>(val.data()), val.size());
+  }
+  int32_t set_slot(uint32_t slot, const dtag_key_t &key, std::string_view val) {
+    return set_slot(slot, key, std::as_bytes(std::span(val)));
+  }
+  int32_t del(const dtag_key_t &key) { return dtag_del_k(block_, &key); }
+  int32_t del(std::string_view key) {
+    dtag_key_t _key;
+    int32_t result = prepare(_key, key);
+    if (result != DTAG_OK)
+      return result;
+    return del(_key);
+  }
+
+  iterator begin() const {
+    ditem_t *curr = nullptr;
+    if (dtag_next(block_, &curr) != DTAG_OK)
+      curr = nullptr;
+    return iterator(block_, curr);
+  }
+  iterator end() const { return iterator(block_, nullptr); }
+
+  dblock_t *raw() const { return block_; }
+  explicit operator bool() const { return block_ != nullptr; }
+  /**
+   * @brief 放弃所有权并返回 `dblock`
+   */
+  dblock_t *release() {
+    owned_ = false;
+    return std::exchange(block_, nullptr);
+  }
+  void reset() {
+    if (owned_)
+      std::free(block_);
+    block_ = nullptr;
+    owned_ = false;
+  }
+
+private:
+  Block(dblock_t *block, bool owned) : block_(block), owned_(owned) {}
+
+  /**
+   * @brief 由 `string_view` 构造 `dtag_key_t`，不复制也不要求 null 结尾；仅在需要时计算哈希
+   */
+  int32_t prepare(dtag_key_t &out, std::string_view key) const {
+    if (key.size() >= DTAG_MAX_KLEN || key.find('\0') != std::string_view::npos)
+      return DTAG_ERR_INVPARAM;
+    uint32_t len = static_cast<uint32_t>(key.size());
+    out = dtag_key_t{key.data(), len, (block_->flags & DTAG_FLAG_BLOOM) ? key_hash(key.data(), len) : 0};
+    return DTAG_OK;
+  }
+
+  dblock_t *block_ = nullptr;
+  bool owned_ = false;
+};
+
+} // namespace dtag
+
+#endif // __DTAG_HPP__
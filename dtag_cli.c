@@ -23,12 +23,22 @@
  */
 
 #include "dtag.h"
+#include "dtag_container.h"
+#include "dtag_grow.h"
+#include "dtag_stats.h"
 #include "logger/logger.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <getopt.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <token/token.h>
+#include <unistd.h>
 
 #define COLOR_RESET "\033[0m"
 #define COLOR_RED "\033[31m"
@@ -39,22 +49,145 @@
 
 void print_usage(const char *prog_name) {
   printf("Usage: %s <filename> <operation> [...]\n", prog_name);
+  printf("       %s -j {jobs} [-u] <operation> [...] -- {file|dir} ...\n", prog_name);
   printf("Version %d:\n", DTAG_VERSION);
   printf("Operations:\n");
-  printf("  init {capa}           - Initialize an empty file\n");
+  printf("  init {capa} [feat] ...- Initialize an empty file (feat: sorted,bloom,varint,aligned,compress,dedup,extent,treehash)\n");
   printf("  dump                  - Dump the content of file\n");
+  printf("  ls [prefix]           - List the tags starting with prefix\n");
   printf("  set {key} {value} ... - Set keys with the given value\n");
   printf("  get {key} ...         - Get the value of the given keys\n");
   printf("  setf {key} {file} ... - Set keys with the given files\n");
   printf("  getf {key} {file} ... - Get the given keys to files\n");
   printf("  del {key} ...         - Delete the given keys\n");
   printf("  hexdump               - Dump the content like hexdump -C\n");
+  printf("  stats                 - Show the usage and the projected lookup cost\n");
+  printf("  convert {dst} [feat]...- Convert to a new file with the given features\n");
+  printf("  diff {new} {patch}    - Write the changes from this file to new as a patch\n");
+  printf("  patch {patch}         - Apply a patch made against this file\n");
+  printf("  entities              - List the blocks in a container file\n");
+  printf("  upgrade               - Rewrite a version %d file in version %d\n", DTAG_VERSION_V3, DTAG_VERSION);
+  printf("<filename> may be {container}:{entity} to address a block in a container file.\n");
+  printf("set and setf grow the capacity of a full block, at least doubling it.\n");
+  printf("Multiple files (verify, dump, get) run on {jobs} threads, -u prints results as they finish:\n");
+  printf("  verify                - Check the magic, layout, checksum and items of each file\n");
 }
 
 inline static void print_error(const char *message) { logfE(COLOR_RED "%s" COLOR_RESET, message); }
 
 inline static void print_info(const char *message) { logfI(COLOR_GREEN "%s" COLOR_RESET, message); }
 
+static const struct {
+  const char *name;
+  uint32_t flag;
+} g_features[] = {
+    {"sorted", DTAG_FLAG_SORTED},
+    {"bloom", DTAG_FLAG_BLOOM},
+    {"varint", DTAG_FLAG_VARINT},
+    {"aligned", DTAG_FLAG_ALIGNED},
+    {"compress", DTAG_FLAG_COMPRESS},
+    {"dedup", DTAG_FLAG_DEDUP},
+    {"extent", DTAG_FLAG_EXTENT},
+    {"treehash", DTAG_FLAG_TREEHASH},
+};
+
+/* 解析剩余的 token 为特性，失败时返回 -1 */
+static int parse_features(token_iter_t *it, uint32_t *flags) {
+  while (token_iter_top(it)) {
+    const char *feat_str = token_iter_pop(it);
+    uint32_t i = 0;
+    for (; i < sizeof(g_features) / sizeof(g_features[0]); i++) {
+      if (!strcmp(feat_str, g_features[i].name)) {
+        *flags |= g_features[i].flag;
+        break;
+      }
+    }
+    if (i == sizeof(g_features) / sizeof(g_features[0])) {
+      print_error("Unknown feature");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* 将 `item` 以 "Tag:xxx, Length: n" 的格式输出到 `out`，`value` 非 0 时附带 value */
+static void print_item(FILE *out, const dblock_t *block, const ditem_t *item, int value) {
+  dtag_view_t view;
+  dtag_item_view(block, item, &view);
+  fprintf(out, "Tag:%*.*s, Length: %u", view.klen + 1, view.klen, view.key, view.rawlen);
+  if (view.rawlen != view.vlen)
+    fprintf(out, " (lz4 %u)", view.vlen);
+  /* 压缩的 value 解压到临时 buffer */
+  uint8_t *val = view.val;
+  if (value && view.rawlen != view.vlen && (val = malloc(view.rawlen)) &&
+      dtag_item_value(block, item, val, &view.rawlen) != DTAG_OK) {
+    free(val);
+    val = NULL;
+  }
+  if (value && val) {
+    fprintf(out, ", Value: ");
+    for (uint32_t i = 0; i < view.rawlen; i++) {
+      fprintf(out, "%02x ", val[i]);
+    }
+  }
+  if (val != view.val)
+    free(val);
+  fprintf(out, "\n");
+}
+
+/*
+ * "container:entity" 形式的文件名（且该名字的文件不存在）指向容器中的 block，
+ * 返回 entity 并将容器的文件名写入 `path`；普通文件返回 NULL
+ */
+static const char *cli_entity(const char *filename, char *path, size_t size) {
+  const char *sep = strrchr(filename, ':');
+  if (!sep || sep == filename || !access(filename, F_OK) || (size_t)(sep - filename) >= size)
+    return NULL;
+  memcpy(path, filename, sep - filename);
+  path[sep - filename] = '\0';
+  return sep + 1;
+}
+
+/* 同 `dtag_import_file`，容器中的 block 复制到新分配的内存 */
+static int32_t cli_import(dblock_t **block, const char *filename) {
+  char path[PATH_MAX];
+  const char *entity = cli_entity(filename, path, sizeof(path));
+  if (!entity)
+    return dtag_import_file(block, filename);
+  dcontainer_t *container = NULL;
+  dblock_t *mapped = NULL;
+  int32_t ret = dtag_container_open(&container, path, 0, 0);
+  if (ret != DTAG_OK)
+    return ret;
+  if ((ret = dtag_container_get(container, entity, &mapped)) == DTAG_OK) {
+    uint32_t len = mapped->capacity + sizeof(dblock_t);
+    uint8_t *buf = (uint8_t *)malloc(len);
+    if (!buf) {
+      ret = DTAG_ERR_NOMEM;
+    } else {
+      memcpy(buf, mapped, len);
+      *block = (dblock_t *)buf;
+    }
+  }
+  dtag_container_close(container);
+  return ret;
+}
+
+/* 同 `dtag_export_file`，容器中的 block 被替换 */
+static int32_t cli_export(dblock_t *block, const char *filename) {
+  char path[PATH_MAX];
+  const char *entity = cli_entity(filename, path, sizeof(path));
+  if (!entity)
+    return dtag_export_file(block, filename);
+  dcontainer_t *container = NULL;
+  int32_t ret = dtag_container_open(&container, path, DTAG_CONTAINER_CREATE, 0);
+  if (ret != DTAG_OK)
+    return ret;
+  ret = dtag_container_put(container, entity, block);
+  dtag_container_close(container);
+  return ret;
+}
+
 int subcmd_init(const char *filename, const char *tokens[]) {
   token_iter_t it;
   token_iter_init(&it, tokens);
@@ -68,19 +201,22 @@ int subcmd_init(const char *filename, const char *tokens[]) {
     print_error("Invalid capacity");
     return EXIT_FAILURE;
   }
+  uint32_t flags = 0;
+  if (parse_features(&it, &flags))
+    return EXIT_FAILURE;
   uint8_t *buffer = (uint8_t *)malloc(capc + sizeof(dblock_t));
   if (!buffer) {
     print_error("Failed to allocate memory");
     return EXIT_FAILURE;
   }
   dblock_t *block = NULL;
-  if (dtag_init(&block, buffer, capc + sizeof(dblock_t)) != DTAG_OK) {
+  if (dtag_init_ex(&block, buffer, capc + sizeof(dblock_t), flags) != DTAG_OK) {
     print_error("Failed to initialize dtag block");
     free(buffer);
     return EXIT_FAILURE;
   }
   dtag_complete(block);
-  if (dtag_export_file(block, filename) != DTAG_OK) {
+  if (cli_export(block, filename) != DTAG_OK) {
     print_error("Failed to export dtag block");
     free(buffer);
     return EXIT_FAILURE;
@@ -89,41 +225,97 @@ int subcmd_init(const char *filename, const char *tokens[]) {
   return EXIT_SUCCESS;
 }
 
+/* 将 `block` 的头部与全部 item 输出到 `out`，失败时返回 -1 */
+static int dump_block(FILE *out, dblock_t *block) {
+  fprintf(out, "Magic: %08x, Version: %u\n", block->magic, block->version);
+  fprintf(out, "Capacity: %u, Length: %u, Flags: %08x\n", block->capacity, block->length, block->flags);
+  fprintf(out, "Chksum:");
+  for (uint32_t i = 0; i < sizeof(block->chksum); i++) {
+    fprintf(out, " %02x", block->chksum[i]);
+  }
+  fprintf(out, "\n");
+  if (block->flags & DTAG_FLAG_BLOOM) {
+    fprintf(out, "Bloom: %u bits, %u hashes, FPR: %.4f%%\n", DTAG_BLOOM_SIZE * 8, DTAG_BLOOM_HASHES,
+            dtag_bloom_fpr(block) * 100);
+  }
+  for (uint32_t slot = 0; block->flags & DTAG_FLAG_SCHEMA; slot++) {
+    ditem_t *item = NULL;
+    int32_t result = dtag_get_slot(block, slot, &item);
+    if (result == DTAG_ERR_INVPARAM)
+      break;
+    dtag_view_t view = {"-", 1};
+    if (result == DTAG_OK)
+      dtag_item_view(block, item, &view);
+    fprintf(out, "Slot %u: %.*s\n", slot, view.klen, view.key);
+  }
+  for (ditem_t *curr = NULL;;) {
+    int32_t result = dtag_next(block, &curr);
+    if (result != DTAG_OK)
+      return -1;
+    if (curr == NULL)
+      break;
+    print_item(out, block, curr, 1);
+  }
+  return 0;
+}
+
+static void cli_grown(dblock_t *block, uint32_t old_capacity, void *arg) {
+  logfI(COLOR_GREEN "Capacity: %u -> %u" COLOR_RESET, old_capacity, block->capacity);
+}
+
+/* 写入时容量不足则自动扩容 */
+static int32_t cli_import_grow(dgrow_t **grow, const char *filename) {
+  dblock_t *block = NULL;
+  int32_t result = cli_import(&block, filename);
+  if (result == DTAG_OK && (result = dtag_grow_adopt(grow, block)) != DTAG_OK)
+    free(block);
+  if (result == DTAG_OK)
+    dtag_grow_notify(*grow, cli_grown, NULL);
+  return result;
+}
+
 int subcmd_dump(const char *filename) {
   dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  int32_t ret = cli_import(&block, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
   }
-  printf("Magic: %08x, Version: %u\n", block->magic, block->version);
-  printf("Capacity: %u, Length: %u\n", block->capacity, block->length);
-  printf("Chksum:");
-  for (uint32_t i = 0; i < sizeof(block->chksum); i++) {
-    printf(" %02x", block->chksum[i]);
+  if (dump_block(stdout, block)) {
+    print_error("Failed to next");
+    free(block);
+    return EXIT_FAILURE;
   }
-  printf("\n");
-  for (ditem_t *curr = NULL;;) {
-    int32_t result = dtag_next(block, &curr);
-    if (result != DTAG_OK) {
-      print_error("Failed to next");
-      return EXIT_FAILURE;
-    }
-    if (curr == NULL)
-      break;
-    printf("Tag:%*s, Length: %u, Value: ", curr->klen, curr->kv, curr->vlen);
-    for (uint32_t i = 0; i < curr->vlen; i++) {
-      printf("%02x ", curr->kv[curr->klen + i]);
-    }
-    printf("\n");
+  free(block);
+  return EXIT_SUCCESS;
+}
+
+static int32_t ls_item(ditem_t *item, void *arg) {
+  print_item(stdout, (const dblock_t *)arg, item, 0);
+  return 0;
+}
+
+int subcmd_ls(const char *filename, const char *tokens[]) {
+  dblock_t *block = NULL;
+  int32_t ret = cli_import(&block, filename);
+  if (ret != DTAG_OK) {
+    print_error("Failed to import dtag block");
+    return EXIT_FAILURE;
+  }
+  token_iter_t it;
+  token_iter_init(&it, tokens);
+  if (dtag_scan_prefix(block, token_iter_pop(&it), ls_item, block) != DTAG_OK) {
+    print_error("Failed to scan");
+    free(block);
+    return EXIT_FAILURE;
   }
   free(block);
   return EXIT_SUCCESS;
 }
 
 int subcmd_set(const char *filename, const char *tokens[]) {
-  dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  dgrow_t *grow = NULL;
+  int32_t ret = cli_import_grow(&grow, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
@@ -135,41 +327,41 @@ int subcmd_set(const char *filename, const char *tokens[]) {
     const char *value_str = token_iter_pop(&it);
     if (!value_str) {
       print_error("Missing value");
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     uint32_t value_len = strlen(value_str) / 2;
     uint8_t *value = (uint8_t *)malloc(value_len);
     if (!value) {
       print_error("Failed to allocate memory");
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     for (uint32_t i = 0; i < value_len; i++) {
       char byte_str[3] = {value_str[i * 2], value_str[i * 2 + 1], '\0'};
       value[i] = strtoul(byte_str, NULL, 16);
     }
-    if (dtag_set(block, key_str, value, value_len) != DTAG_OK) {
+    if (dtag_grow_set(grow, key_str, value, value_len) != DTAG_OK) {
       print_error("Failed to set key");
       free(value);
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     free(value);
   }
-  dtag_complete(block);
-  if (dtag_export_file(block, filename) != DTAG_OK) {
+  dtag_complete(dtag_grow_block(grow));
+  if (cli_export(dtag_grow_block(grow), filename) != DTAG_OK) {
     print_error("Failed to export dtag block");
-    free(block);
+    dtag_grow_close(grow);
     return EXIT_FAILURE;
   }
-  free(block);
+  dtag_grow_close(grow);
   return EXIT_SUCCESS;
 }
 
 int subcmd_get(const char *filename, const char *tokens[]) {
   dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  int32_t ret = cli_import(&block, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
@@ -188,19 +380,15 @@ int subcmd_get(const char *filename, const char *tokens[]) {
       }
       return EXIT_FAILURE;
     }
-    printf("Tag:%*s, Length: %u, Value: ", item->klen, item->kv, item->vlen);
-    for (uint32_t i = 0; i < item->vlen; i++) {
-      printf("%02x ", item->kv[item->klen + i]);
-    }
-    printf("\n");
+    print_item(stdout, block, item, 1);
   }
   free(block);
   return EXIT_SUCCESS;
 }
 
 int subcmd_setf(const char *filename, const char *tokens[]) {
-  dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  dgrow_t *grow = NULL;
+  int32_t ret = cli_import_grow(&grow, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
@@ -212,13 +400,13 @@ int subcmd_setf(const char *filename, const char *tokens[]) {
     const char *file = token_iter_pop(&it);
     if (!file) {
       print_error("Missing file");
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     FILE *f = fopen(file, "rb");
     if (!f) {
       print_error("Failed to open file");
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     fseek(f, 0, SEEK_END);
@@ -228,39 +416,39 @@ int subcmd_setf(const char *filename, const char *tokens[]) {
     if (!value) {
       print_error("Failed to allocate memory");
       fclose(f);
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     if (fread(value, 1, len, f) != len) {
       print_error("Failed to read file");
       fclose(f);
       free(value);
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
-    if (dtag_set(block, key_str, value, len) != DTAG_OK) {
+    if (dtag_grow_set(grow, key_str, value, len) != DTAG_OK) {
       print_error("Failed to set key");
       fclose(f);
       free(value);
-      free(block);
+      dtag_grow_close(grow);
       return EXIT_FAILURE;
     }
     fclose(f);
     free(value);
   }
-  dtag_complete(block);
-  if (dtag_export_file(block, filename) != DTAG_OK) {
+  dtag_complete(dtag_grow_block(grow));
+  if (cli_export(dtag_grow_block(grow), filename) != DTAG_OK) {
     print_error("Failed to export dtag block");
-    free(block);
+    dtag_grow_close(grow);
     return EXIT_FAILURE;
   }
-  free(block);
+  dtag_grow_close(grow);
   return EXIT_SUCCESS;
 }
 
 int subcmd_getf(const char *filename, const char *tokens[]) {
   dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  int32_t ret = cli_import(&block, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
@@ -292,12 +480,28 @@ int subcmd_getf(const char *filename, const char *tokens[]) {
       free(block);
       return EXIT_FAILURE;
     }
-    if (fwrite(&item->kv[item->klen], 1, item->vlen, f) != item->vlen) {
+    /* 未压缩时直接写出 `dblock` 内的 value */
+    dtag_view_t view;
+    dtag_item_view(block, item, &view);
+    uint8_t *val = view.val;
+    if (view.rawlen != view.vlen && (!(val = malloc(view.rawlen)) ||
+                                     dtag_item_value(block, item, val, &view.rawlen) != DTAG_OK)) {
+      print_error("Failed to decompress value");
+      free(val);
+      fclose(f);
+      free(block);
+      return EXIT_FAILURE;
+    }
+    if (fwrite(val, 1, view.rawlen, f) != view.rawlen) {
       print_error("Failed to write file");
+      if (val != view.val)
+        free(val);
       fclose(f);
       free(block);
       return EXIT_FAILURE;
     }
+    if (val != view.val)
+      free(val);
     fclose(f);
   }
   free(block);
@@ -306,7 +510,7 @@ int subcmd_getf(const char *filename, const char *tokens[]) {
 
 int subcmd_del(const char *filename, const char *tokens[]) {
   dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  int32_t ret = cli_import(&block, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
@@ -327,7 +531,7 @@ int subcmd_del(const char *filename, const char *tokens[]) {
     }
   }
   dtag_complete(block);
-  if (dtag_export_file(block, filename) != DTAG_OK) {
+  if (cli_export(block, filename) != DTAG_OK) {
     print_error("Failed to export dtag block");
     free(block);
     return EXIT_FAILURE;
@@ -338,7 +542,7 @@ int subcmd_del(const char *filename, const char *tokens[]) {
 
 int subcmd_hexdump(const char *filename) {
   dblock_t *block = NULL;
-  int32_t ret = dtag_import_file(&block, filename);
+  int32_t ret = cli_import(&block, filename);
   if (ret != DTAG_OK) {
     print_error("Failed to import dtag block");
     return EXIT_FAILURE;
@@ -347,8 +551,13 @@ int subcmd_hexdump(const char *filename) {
   uint8_t *ptr = (uint8_t *)block;
   uint32_t len = block->capacity + sizeof(dblock_t);
   int zero_line_count = 0;
+  uint32_t items_offset = 0, items_length = 0;
+  dtag_items_region(block, &items_offset, &items_length);
+  uint8_t *items_begin = block->data + items_offset;
+  uint8_t *items_end = items_begin + items_length;
 
-  ditem_t *item = NULL;
+  ditem_t *item = NULL, *next = NULL;
+  dtag_view_t view;
   for (uint32_t i = 0; i < len; i += 16) {
     int is_zero_line = 1;
     for (uint32_t j = 0; j < 16 && i + j < len; j++) {
@@ -382,25 +591,41 @@ int subcmd_hexdump(const char *filename) {
             printf(COLOR_YELLOW "%02x " COLOR_RESET, ptr[i + j]);
           } else if (i + j < offsetof(dblock_t, length) + sizeof(block->length)) {
             printf(COLOR_BLUE "%02x " COLOR_RESET, ptr[i + j]);
+          } else if (i + j < offsetof(dblock_t, flags) + sizeof(block->flags)) {
+            printf(COLOR_CYAN "%02x " COLOR_RESET, ptr[i + j]);
           } else if (i + j < offsetof(dblock_t, chksum) + sizeof(block->chksum)) {
             printf(COLOR_RED "%02x " COLOR_RESET, ptr[i + j]);
           } else {
             printf("%02x ", ptr[i + j]);
           }
+        } else if (ptr + i + j < items_begin || ptr + i + j >= items_end) {
+          printf("%02x ", ptr[i + j]);
         } else {
-          if (item == NULL) {
-            item = (ditem_t *)(block->data);
-          } else if (ptr + i + j == (uint8_t *)item->kv + item->klen + item->vlen) {
-            item = (ditem_t *)((uint8_t *)item->kv + item->klen + item->vlen);
+          /* `ditem` 之间可能有对齐填充，由 `dtag_next` 确定下一个的位置 */
+          if (item == NULL || (uint8_t *)next == ptr + i + j) {
+            item = (ditem_t *)(ptr + i + j);
+            dtag_item_view(block, item, &view);
+            next = item;
+            if (dtag_next(block, &next) != DTAG_OK)
+              next = NULL;
           }
-          if (ptr + i + j < (uint8_t *)item + 1) {
+          /* klen 占 1 字节，或为 LEB128 */
+          uint8_t *klen_end = (uint8_t *)item + 1;
+          while ((block->flags & DTAG_FLAG_VARINT) && (klen_end[-1] & 0x80))
+            klen_end++;
+          if (ptr + i + j < klen_end) {
             printf(COLOR_CYAN "%02x " COLOR_RESET, ptr[i + j]);
-          } else if (ptr + i + j < (uint8_t *)item + 4) {
+          } else if (ptr + i + j < (uint8_t *)view.key) {
             printf(COLOR_GREEN "%02x " COLOR_RESET, ptr[i + j]);
-          } else if (ptr + i + j < (uint8_t *)item + offsetof(ditem_t, kv) + item->klen) {
+          } else if (ptr + i + j < (uint8_t *)view.key + view.klen + !(block->flags & DTAG_FLAG_VARINT) ||
+                     ((block->flags & DTAG_FLAG_ALIGNED) && ptr + i + j < view.val)) {
             printf(COLOR_YELLOW "%02x " COLOR_RESET, ptr[i + j]);
-          } else if (ptr + i + j < (uint8_t *)item + offsetof(ditem_t, kv) + item->klen + item->vlen) {
+          } else if (ptr + i + j < view.val) {
+            printf(COLOR_RED "%02x " COLOR_RESET, ptr[i + j]);
+          } else if (ptr + i + j < view.val + view.vlen) {
             printf(COLOR_BLUE "%02x " COLOR_RESET, ptr[i + j]);
+          } else {
+            printf("%02x ", ptr[i + j]);
           }
         }
       } else if (ptr + i + j < (uint8_t *)block->data + block->capacity) {
@@ -426,7 +651,546 @@ int subcmd_hexdump(const char *filename) {
   return EXIT_SUCCESS;
 }
 
+static void stats_print_ops(const dtag_stats_t *stats) {
+  printf("%-12s %8s %8s %12s\n", "Op", "Calls", "Errors", "Mean(ns)");
+  for (uint32_t op = 1; op < DTAG_OP_MAX; op++) {
+    if (!stats->calls[op])
+      continue;
+    printf("%-12s %8lu %8lu %12lu\n", dtag_op_name(op), stats->calls[op], stats->errors[op],
+           stats->nanos[op] / stats->calls[op]);
+  }
+  printf("Checksum: %lu bytes in %lu ns, File I/O: %lu bytes in %lu ns\n", stats->chksum_bytes, stats->chksum_nanos,
+         stats->fileio_bytes, stats->fileio_nanos);
+  if (stats->codec_bytes)
+    printf("Codec: %lu bytes in %lu ns\n", stats->codec_bytes, stats->codec_nanos);
+}
+
+int subcmd_stats(const char *filename) {
+  dblock_t *block = NULL;
+  int32_t ret = cli_import(&block, filename);
+  if (ret != DTAG_OK) {
+    print_error("Failed to import dtag block");
+    return EXIT_FAILURE;
+  }
+  uint32_t offset = 0, length = 0;
+  dtag_items_region(block, &offset, &length);
+  uint32_t count = 0, compressed = 0, shared = 0, extents = 0;
+  uint64_t klens = 0, vlens = 0, zraws = 0, zlens = 0, slens = 0, elens = 0;
+  for (ditem_t *curr = NULL;;) {
+    if (dtag_next(block, &curr) != DTAG_OK) {
+      print_error("Failed to next");
+      free(block);
+      return EXIT_FAILURE;
+    }
+    if (curr == NULL)
+      break;
+    dtag_view_t view;
+    dtag_item_view(block, curr, &view);
+    count++;
+    klens += view.klen;
+    /* extent 区（`ditem` 之前）与共享池（之后）中的 value 不计入 `ditem` 的长度 */
+    if (view.val < block->data + offset) {
+      extents++;
+      elens += view.vlen;
+    } else if (view.val >= block->data + offset + length) {
+      shared++;
+      slens += view.vlen;
+    } else {
+      vlens += view.vlen;
+    }
+    if (view.rawlen != view.vlen) {
+      compressed++;
+      zraws += view.rawlen;
+      zlens += view.vlen;
+    }
+  }
+
+  printf("Items: %u, Avg key: %.1f bytes, Avg value: %.1f bytes\n", count, count ? (double)klens / count : 0,
+         count ? (double)(vlens + slens + elens) / count : 0);
+  printf("Capacity: %u, Length: %u, Fill: %.1f%%, Free: %u\n", block->capacity, block->length,
+         block->capacity ? block->length * 100.0 / block->capacity : 0, block->capacity - block->length);
+  printf("Payload: %lu, Item headers: %lu, Metadata: %lu\n", klens + vlens, length - klens - vlens,
+         block->length - length - elens);
+  if (extents)
+    printf("Extents: %u items store %lu bytes out of line\n", extents, elens);
+  if (shared)
+    printf("Shared: %u items reference %lu bytes in the value pool\n", shared, slens);
+  if (compressed)
+    printf("Compressed: %u items, %lu -> %lu bytes (%.1fx)\n", compressed, zraws, zlens, (double)zraws / zlens);
+
+  /* 查找需要比较的 `ditem` 数：有序时为二分查找的深度，否则为线性扫描 */
+  double fpr = dtag_bloom_fpr(block);
+  double hit = 0, miss = 0;
+  if (block->flags & DTAG_FLAG_SORTED) {
+    hit = miss = count ? ceil(log2(count + 1.0)) : 0;
+  } else {
+    hit = (count + 1) / 2.0;
+    miss = count;
+  }
+  printf("Lookup cost: %.1f items per hit, %.1f items per miss", hit, miss * fpr);
+  if (block->flags & DTAG_FLAG_BLOOM)
+    printf(" (bloom FPR %.2f%%)", fpr * 100);
+  printf("\n");
+
+  /* 编译了统计功能时，实测一轮全部命中的查找 */
+  dtag_stats_t stats;
+  if (dtag_stats_get(&stats) == DTAG_OK) {
+    uint64_t scanned = stats.items_scanned;
+    for (ditem_t *curr = NULL; dtag_next(block, &curr) == DTAG_OK && curr;) {
+      dtag_view_t view;
+      dtag_key_t key;
+      dtag_item_view(block, curr, &view);
+      dtag_key_prepare_n(&key, view.key, view.klen);
+      dtag_get_inner_k(block, &key, NULL);
+    }
+    dtag_stats_get(&stats);
+    if (count)
+      printf("Measured: %.1f items per hit\n", (double)(stats.items_scanned - scanned) / count);
+    stats_print_ops(&stats);
+  }
+  free(block);
+  return EXIT_SUCCESS;
+}
+
+int subcmd_convert(const char *filename, const char *tokens[]) {
+  token_iter_t it;
+  token_iter_init(&it, tokens);
+  const char *dst_name = token_iter_pop(&it);
+  if (!dst_name) {
+    print_error("Missing destination");
+    return EXIT_FAILURE;
+  }
+  uint32_t flags = 0;
+  if (parse_features(&it, &flags))
+    return EXIT_FAILURE;
+
+  dblock_t *src = NULL;
+  if (cli_import(&src, filename) != DTAG_OK) {
+    print_error("Failed to import dtag block");
+    return EXIT_FAILURE;
+  }
+  /* 保留源 block 的槽位数量 */
+  uint32_t nslots = 0;
+  ditem_t *item = NULL;
+  while ((src->flags & DTAG_FLAG_SCHEMA) && dtag_get_slot(src, nslots, &item) != DTAG_ERR_INVPARAM)
+    nslots++;
+
+  uint32_t len = src->capacity + sizeof(dblock_t);
+  uint8_t *buffer = (uint8_t *)malloc(len);
+  if (!buffer) {
+    print_error("Failed to allocate memory");
+    free(src);
+    return EXIT_FAILURE;
+  }
+  dblock_t *dst = NULL;
+  int32_t ret = nslots ? dtag_init_schema(&dst, buffer, len, flags, nslots) : dtag_init_ex(&dst, buffer, len, flags);
+  if (ret == DTAG_OK)
+    ret = dtag_convert(dst, src);
+  if (ret != DTAG_OK) {
+    print_error("Failed to convert dtag block");
+    free(buffer);
+    free(src);
+    return EXIT_FAILURE;
+  }
+  dtag_complete(dst);
+  if (cli_export(dst, dst_name) != DTAG_OK) {
+    print_error("Failed to export dtag block");
+    free(buffer);
+    free(src);
+    return EXIT_FAILURE;
+  }
+  printf("Length: %u -> %u\n", src->length, dst->length);
+  free(buffer);
+  free(src);
+  return EXIT_SUCCESS;
+}
+
+int subcmd_diff(const char *filename, const char *tokens[]) {
+  token_iter_t it;
+  token_iter_init(&it, tokens);
+  const char *to_file = token_iter_pop(&it);
+  const char *patch_file = token_iter_pop(&it);
+  if (!to_file || !patch_file) {
+    print_error("Missing file");
+    return EXIT_FAILURE;
+  }
+  dblock_t *from = NULL, *to = NULL;
+  if (cli_import(&from, filename) != DTAG_OK || cli_import(&to, to_file) != DTAG_OK) {
+    print_error("Failed to import dtag block");
+    free(from);
+    return EXIT_FAILURE;
+  }
+  uint8_t *patch = NULL;
+  uint32_t len = 0;
+  if (dtag_diff(from, to, &patch, &len) != DTAG_OK) {
+    print_error("Failed to diff");
+    free(to);
+    free(from);
+    return EXIT_FAILURE;
+  }
+  int ret = EXIT_SUCCESS;
+  FILE *f = fopen(patch_file, "wb");
+  if (!f || fwrite(patch, 1, len, f) != len) {
+    print_error("Failed to write file");
+    ret = EXIT_FAILURE;
+  } else {
+    printf("Patch: %u ops, %u bytes (block: %lu bytes)\n", ((dpatch_head_t *)patch)->count, len,
+           to->capacity + sizeof(dblock_t));
+  }
+  if (f)
+    fclose(f);
+  free(patch);
+  free(to);
+  free(from);
+  return ret;
+}
+
+int subcmd_patch(const char *filename, const char *tokens[]) {
+  token_iter_t it;
+  token_iter_init(&it, tokens);
+  const char *patch_file = token_iter_pop(&it);
+  if (!patch_file) {
+    print_error("Missing file");
+    return EXIT_FAILURE;
+  }
+  FILE *f = fopen(patch_file, "rb");
+  if (!f) {
+    print_error("Failed to open file");
+    return EXIT_FAILURE;
+  }
+  fseek(f, 0, SEEK_END);
+  uint32_t len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *patch = (uint8_t *)malloc(len);
+  if (!patch || fread(patch, 1, len, f) != len) {
+    print_error("Failed to read file");
+    fclose(f);
+    free(patch);
+    return EXIT_FAILURE;
+  }
+  fclose(f);
+  dblock_t *block = NULL;
+  if (cli_import(&block, filename) != DTAG_OK) {
+    print_error("Failed to import dtag block");
+    free(patch);
+    return EXIT_FAILURE;
+  }
+  int32_t ret = dtag_patch_apply(block, patch, len);
+  free(patch);
+  if (ret != DTAG_OK) {
+    print_error(ret == DTAG_ERR_CHECKSUM ? "Patch does not apply to this block" : "Failed to apply patch");
+    free(block);
+    return EXIT_FAILURE;
+  }
+  if (cli_export(block, filename) != DTAG_OK) {
+    print_error("Failed to export dtag block");
+    free(block);
+    return EXIT_FAILURE;
+  }
+  free(block);
+  return EXIT_SUCCESS;
+}
+
+/* 导入时已升级为当前版本，写回即可 */
+int subcmd_upgrade(const char *filename) {
+  dblock_t *block = NULL;
+  if (cli_import(&block, filename) != DTAG_OK) {
+    print_error("Failed to import dtag block");
+    return EXIT_FAILURE;
+  }
+  if (cli_export(block, filename) != DTAG_OK) {
+    print_error("Failed to export dtag block");
+    free(block);
+    return EXIT_FAILURE;
+  }
+  free(block);
+  return EXIT_SUCCESS;
+}
+
+static int32_t print_entity(const dcontainer_entry_t *entry, void *arg) {
+  printf("Entity:%s, Offset: %lu, Size: %lu\n", entry->id, entry->offset, entry->size);
+  return 0;
+}
+
+int subcmd_entities(const char *filename) {
+  dcontainer_t *container = NULL;
+  if (dtag_container_open(&container, filename, 0, 0) != DTAG_OK) {
+    print_error("Failed to open container");
+    return EXIT_FAILURE;
+  }
+  dtag_container_foreach(container, print_entity, NULL);
+  dtag_container_close(container);
+  return EXIT_SUCCESS;
+}
+
+/* 多文件模式：`jobs` 个线程从共享游标领取文件，各自复用读取 buffer */
+typedef struct {
+  char *text;
+  size_t size;
+  int status;
+  int done;
+} job_result_t;
+
+typedef struct {
+  const char *operation;
+  const char **tokens;
+  char **files;
+  uint32_t nfiles;
+  uint32_t next;
+  int ordered;
+  int status;
+  job_result_t *results;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} jobs_t;
+
+typedef struct {
+  jobs_t *jobs;
+  uint8_t *buf;
+  size_t capacity;
+} job_worker_t;
+
+/* 将 `filename` 读入 worker 的 buffer 并按 `mode` 导入，buffer 仅在不足时扩大 */
+static int32_t job_import(job_worker_t *worker, const char *filename, dblock_t **block, uint32_t mode) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return DTAG_ERR_FILEIO;
+  struct stat st;
+  if (fstat(fd, &st) || st.st_size > UINT32_MAX) {
+    close(fd);
+    return DTAG_ERR_FILEIO;
+  }
+  size_t size = st.st_size;
+  if (size > worker->capacity) {
+    uint8_t *buf = realloc(worker->buf, size);
+    if (!buf) {
+      close(fd);
+      return DTAG_ERR_NOMEM;
+    }
+    worker->buf = buf;
+    worker->capacity = size;
+  }
+  size_t done = 0;
+  for (ssize_t n = 0; done < size; done += n) {
+    if ((n = read(fd, worker->buf + done, size - done)) <= 0)
+      break;
+  }
+  close(fd);
+  if (done != size)
+    return DTAG_ERR_FILEIO;
+  return dtag_import_ex(block, worker->buf, size, mode);
+}
+
+/* 对单个文件执行操作并将结果输出到 `out`，失败时返回 EXIT_FAILURE */
+static int job_run(job_worker_t *worker, const char *filename, FILE *out) {
+  const char *operation = worker->jobs->operation;
+  dblock_t *block = NULL;
+  uint32_t mode = DTAG_VERIFY_FULL | (strcmp(operation, "verify") ? 0 : DTAG_VERIFY_STRUCTURE);
+  int32_t ret = job_import(worker, filename, &block, mode);
+  if (ret != DTAG_OK) {
+    fprintf(out, "%s: " COLOR_RED "import failed (%d)" COLOR_RESET "\n", filename, ret);
+    return EXIT_FAILURE;
+  }
+  if (!strcmp(operation, "verify")) {
+    fprintf(out, "%s: " COLOR_GREEN "OK" COLOR_RESET "\n", filename);
+    return EXIT_SUCCESS;
+  }
+  if (!strcmp(operation, "dump")) {
+    fprintf(out, "==> %s <==\n", filename);
+    if (dump_block(out, block)) {
+      fprintf(out, COLOR_RED "next failed" COLOR_RESET "\n");
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+  int status = EXIT_SUCCESS;
+  token_iter_t it;
+  token_iter_init(&it, worker->jobs->tokens);
+  while (token_iter_top(&it)) {
+    ditem_t *item = NULL;
+    const char *key_str = token_iter_pop(&it);
+    fprintf(out, "%s: ", filename);
+    ret = dtag_get_inner(block, key_str, &item);
+    if (ret != DTAG_OK) {
+      fprintf(out, COLOR_RED "%s: %s" COLOR_RESET "\n", key_str, ret == DTAG_ERR_NOTFOUND ? "not found" : "get failed");
+      status = EXIT_FAILURE;
+      continue;
+    }
+    print_item(out, block, item, 1);
+  }
+  return status;
+}
+
+static void *job_worker(void *arg) {
+  job_worker_t *worker = (job_worker_t *)arg;
+  jobs_t *jobs = worker->jobs;
+  for (;;) {
+    uint32_t index = __atomic_fetch_add(&jobs->next, 1, __ATOMIC_RELAXED);
+    if (index >= jobs->nfiles)
+      break;
+    job_result_t result = {0};
+    FILE *out = open_memstream(&result.text, &result.size);
+    if (!out) {
+      result.status = EXIT_FAILURE;
+    } else {
+      result.status = job_run(worker, jobs->files[index], out);
+      fclose(out);
+    }
+    pthread_mutex_lock(&jobs->lock);
+    if (result.status != EXIT_SUCCESS)
+      jobs->status = EXIT_FAILURE;
+    if (jobs->ordered) {
+      result.done = 1;
+      jobs->results[index] = result;
+      pthread_cond_broadcast(&jobs->cond);
+    } else {
+      fwrite(result.text, 1, result.size, stdout);
+      free(result.text);
+    }
+    pthread_mutex_unlock(&jobs->lock);
+  }
+  return NULL;
+}
+
+static char **g_walk_files;
+static uint32_t g_walk_count, g_walk_capacity;
+
+/* 收集 `path` 本身或其下（递归）的普通文件，失败时返回 -1 */
+static int walk_path(const char *path) {
+  struct stat st;
+  if (stat(path, &st))
+    return -1;
+  if (S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(path);
+    if (!dir)
+      return -1;
+    int ret = 0;
+    for (struct dirent *ent; !ret && (ent = readdir(dir));) {
+      if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+        continue;
+      char child[PATH_MAX];
+      if (snprintf(child, sizeof(child), "%s/%s", path, ent->d_name) >= (int)sizeof(child))
+        ret = -1;
+      else
+        ret = walk_path(child);
+    }
+    closedir(dir);
+    return ret;
+  }
+  if (!S_ISREG(st.st_mode))
+    return 0;
+  if (g_walk_count == g_walk_capacity) {
+    uint32_t capacity = g_walk_capacity ? g_walk_capacity * 2 : 64;
+    char **files = realloc(g_walk_files, capacity * sizeof(char *));
+    if (!files)
+      return -1;
+    g_walk_files = files;
+    g_walk_capacity = capacity;
+  }
+  if (!(g_walk_files[g_walk_count] = strdup(path)))
+    return -1;
+  g_walk_count++;
+  return 0;
+}
+
+/* 在 `jobs` 个线程上对 `paths` 中的文件（目录则递归其中的普通文件）执行 `operation` */
+int multi_run(uint32_t jobs_count, int ordered, const char *operation, const char *tokens[], char *paths[]) {
+  if (strcmp(operation, "verify") && strcmp(operation, "dump") && strcmp(operation, "get")) {
+    print_error("Operation not supported on multiple files");
+    return EXIT_FAILURE;
+  }
+  for (; *paths; paths++) {
+    if (walk_path(*paths)) {
+      print_error("Failed to walk path");
+      return EXIT_FAILURE;
+    }
+  }
+  if (!g_walk_count)
+    return EXIT_SUCCESS;
+  if (jobs_count > g_walk_count)
+    jobs_count = g_walk_count;
+
+  jobs_t jobs = {
+      .operation = operation,
+      .tokens = tokens,
+      .files = g_walk_files,
+      .nfiles = g_walk_count,
+      .ordered = ordered,
+      .status = EXIT_SUCCESS,
+      .lock = PTHREAD_MUTEX_INITIALIZER,
+      .cond = PTHREAD_COND_INITIALIZER,
+  };
+  pthread_t *threads = calloc(jobs_count, sizeof(pthread_t));
+  job_worker_t *workers = calloc(jobs_count, sizeof(job_worker_t));
+  if (ordered)
+    jobs.results = calloc(jobs.nfiles, sizeof(job_result_t));
+  if (!threads || !workers || (ordered && !jobs.results)) {
+    print_error("Failed to allocate memory");
+    free(threads);
+    free(workers);
+    free(jobs.results);
+    return EXIT_FAILURE;
+  }
+  uint32_t started = 0;
+  for (; started < jobs_count; started++) {
+    workers[started].jobs = &jobs;
+    if (pthread_create(&threads[started], NULL, job_worker, &workers[started]))
+      break;
+  }
+  if (!started) {
+    print_error("Failed to create thread");
+    jobs.status = EXIT_FAILURE;
+  }
+  /* 按输入顺序输出已完成的结果 */
+  for (uint32_t i = 0; started && ordered && i < jobs.nfiles; i++) {
+    pthread_mutex_lock(&jobs.lock);
+    while (!jobs.results[i].done)
+      pthread_cond_wait(&jobs.cond, &jobs.lock);
+    pthread_mutex_unlock(&jobs.lock);
+    fwrite(jobs.results[i].text, 1, jobs.results[i].size, stdout);
+    free(jobs.results[i].text);
+  }
+  for (uint32_t i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+    free(workers[i].buf);
+  }
+  for (uint32_t i = 0; i < g_walk_count; i++)
+    free(g_walk_files[i]);
+  free(g_walk_files);
+  free(jobs.results);
+  free(workers);
+  free(threads);
+  return jobs.status;
+}
+
 int main(int argc, char *argv[]) {
+  if (argc > 1 && argv[1][0] == '-') {
+    uint32_t jobs_count = 0;
+    int ordered = 1;
+    for (int opt; (opt = getopt(argc, argv, "+j:u")) != -1;) {
+      switch (opt) {
+      case 'j':
+        jobs_count = strtoul(optarg, NULL, 0);
+        break;
+      case 'u':
+        ordered = 0;
+        break;
+      default:
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+    /* <operation> [...] -- {file|dir} ... */
+    int sep = optind + 1;
+    while (sep < argc && strcmp(argv[sep], "--"))
+      sep++;
+    if (jobs_count == 0 || optind >= argc || sep >= argc - 1) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    argv[sep] = NULL;
+    return multi_run(jobs_count, ordered, argv[optind], (const char **)&argv[optind + 1], &argv[sep + 1]);
+  }
   if (argc < 3) {
     print_usage(argv[0]);
     return EXIT_FAILURE;
@@ -441,6 +1205,9 @@ int main(int argc, char *argv[]) {
   if (!strcmp(operation, "dump")) {
     return subcmd_dump(filename);
   }
+  if (!strcmp(operation, "ls")) {
+    return subcmd_ls(filename, (const char **)&argv[3]);
+  }
   if (!strcmp(operation, "set")) {
     return subcmd_set(filename, (const char **)&argv[3]);
   }
@@ -459,6 +1226,24 @@ int main(int argc, char *argv[]) {
   if (!strcmp(operation, "hexdump")) {
     return subcmd_hexdump(filename);
   }
+  if (!strcmp(operation, "stats")) {
+    return subcmd_stats(filename);
+  }
+  if (!strcmp(operation, "convert")) {
+    return subcmd_convert(filename, (const char **)&argv[3]);
+  }
+  if (!strcmp(operation, "diff")) {
+    return subcmd_diff(filename, (const char **)&argv[3]);
+  }
+  if (!strcmp(operation, "patch")) {
+    return subcmd_patch(filename, (const char **)&argv[3]);
+  }
+  if (!strcmp(operation, "entities")) {
+    return subcmd_entities(filename);
+  }
+  if (!strcmp(operation, "upgrade")) {
+    return subcmd_upgrade(filename);
+  }
 
   print_usage(argv[0]);
   return EXIT_FAILURE;
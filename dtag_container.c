@@ -0,0 +1,318 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtag_container.h"
+#include "logger/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CONTAINER_PAGE (4096)
+#define ALIGN_UP(n, a) (((n) + (a) - 1) & ~(uint64_t)((a) - 1))
+
+struct dtag_container {
+  int fd;
+  /* 映射整个文件，`size` 同时是文件的大小 */
+  uint8_t *base;
+  uint64_t size;
+};
+
+static inline dcontainer_head_t *container_head(dcontainer_t *c) { return (dcontainer_head_t *)c->base; }
+
+static inline dcontainer_entry_t *container_dir(dcontainer_t *c) {
+  return (dcontainer_entry_t *)(c->base + container_head(c)->directory);
+}
+
+/* 将文件扩大到 `size` 并重新映射，此前的指针全部失效 */
+static int32_t container_map(dcontainer_t *c, uint64_t size) {
+  if (size > c->size && ftruncate(c->fd, size)) {
+    logfE("fail to truncate container: %lu (%d:%s)", size, errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  if (c->base)
+    munmap(c->base, c->size);
+  c->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0);
+  c->size = size;
+  if (c->base == MAP_FAILED) {
+    logfE("fail to map container: %lu (%d:%s)", size, errno, strerror(errno));
+    c->base = NULL;
+    return DTAG_ERR_FILEIO;
+  }
+  return DTAG_OK;
+}
+
+/* 首次适配空闲表，否则从 `end` 分配，文件不足时按 1.5 倍扩大 */
+static int32_t container_alloc(dcontainer_t *c, uint64_t size, uint64_t *offset) {
+  dcontainer_head_t *head = container_head(c);
+  size = ALIGN_UP(size, DTAG_ALIGN);
+  for (uint32_t i = 0; i < DTAG_CONTAINER_FREE; i++) {
+    if (head->free[i].size >= size) {
+      *offset = head->free[i].offset;
+      head->free[i].offset += size;
+      head->free[i].size -= size;
+      return DTAG_OK;
+    }
+  }
+  uint64_t end = head->end + size;
+  if (end > c->size) {
+    uint64_t grow = c->size + c->size / 2;
+    int32_t result = container_map(c, ALIGN_UP(end > grow ? end : grow, CONTAINER_PAGE));
+    if (result != DTAG_OK)
+      return result;
+    head = container_head(c);
+  }
+  *offset = head->end;
+  head->end = end;
+  return DTAG_OK;
+}
+
+/* 与相邻的空闲块合并后记入空闲表，位于末尾时直接缩减 `end` */
+static void container_free(dcontainer_t *c, uint64_t offset, uint64_t size) {
+  dcontainer_head_t *head = container_head(c);
+  dcontainer_extent_t *slot = &head->free[0];
+  for (uint32_t i = 0; i < DTAG_CONTAINER_FREE; i++) {
+    dcontainer_extent_t *extent = &head->free[i];
+    if (extent->size && extent->offset + extent->size == offset) {
+      offset = extent->offset;
+      size += extent->size;
+      extent->size = 0;
+    } else if (extent->size && offset + size == extent->offset) {
+      size += extent->size;
+      extent->size = 0;
+    }
+    if (extent->size < slot->size)
+      slot = extent;
+  }
+  if (offset + size == head->end) {
+    head->end = offset;
+    return;
+  }
+  /* 空闲表已满时放弃较小的一个 */
+  if (slot->size < size) {
+    slot->offset = offset;
+    slot->size = size;
+  }
+}
+
+/* 查找 `id` 的目录项；不存在时返回 NULL，并由 `slot` 返回可插入的位置 */
+static dcontainer_entry_t *container_find(dcontainer_t *c, const char *id, uint32_t len, dcontainer_entry_t **slot) {
+  dcontainer_entry_t *dir = container_dir(c);
+  uint32_t mask = container_head(c)->nslots - 1;
+  uint32_t i = dtag_key_hash(id, len) & mask;
+  *slot = NULL;
+  for (uint32_t n = 0; n <= mask; n++, i = (i + 1) & mask) {
+    dcontainer_entry_t *entry = &dir[i];
+    if (entry->state == DTAG_CONTAINER_USED && !memcmp(entry->id, id, len + 1))
+      return entry;
+    if (entry->state != DTAG_CONTAINER_USED && !*slot)
+      *slot = entry;
+    if (entry->state == DTAG_CONTAINER_EMPTY)
+      break;
+  }
+  return NULL;
+}
+
+/* 将目录迁移到两倍大小的新位置，同时清除删除标记 */
+static int32_t container_rehash(dcontainer_t *c) {
+  uint32_t nslots = container_head(c)->nslots;
+  uint64_t offset = 0, size = (uint64_t)nslots * 2 * sizeof(dcontainer_entry_t);
+  int32_t result = container_alloc(c, size, &offset);
+  if (result != DTAG_OK)
+    return result;
+  dcontainer_head_t *head = container_head(c);
+  dcontainer_entry_t *from = container_dir(c), *to = (dcontainer_entry_t *)(c->base + offset);
+  uint64_t old = head->directory;
+  memset(to, 0, size);
+  for (uint32_t i = 0; i < nslots; i++) {
+    if (from[i].state != DTAG_CONTAINER_USED)
+      continue;
+    uint32_t mask = nslots * 2 - 1;
+    uint32_t j = dtag_key_hash(from[i].id, strlen(from[i].id)) & mask;
+    while (to[j].state != DTAG_CONTAINER_EMPTY)
+      j = (j + 1) & mask;
+    to[j] = from[i];
+  }
+  head->directory = offset;
+  head->nslots = nslots * 2;
+  container_free(c, old, (uint64_t)nslots * sizeof(dcontainer_entry_t));
+  return DTAG_OK;
+}
+
+static int32_t container_create(dcontainer_t *c, uint32_t nslots) {
+  uint32_t n = 1;
+  while (n < (nslots ? nslots : DTAG_CONTAINER_SLOTS))
+    n <<= 1;
+  uint64_t directory = ALIGN_UP(sizeof(dcontainer_head_t), DTAG_ALIGN);
+  uint64_t end = directory + (uint64_t)n * sizeof(dcontainer_entry_t);
+  int32_t result = container_map(c, ALIGN_UP(end, CONTAINER_PAGE));
+  if (result != DTAG_OK)
+    return result;
+  dcontainer_head_t *head = container_head(c);
+  memset(head, 0, end);
+  head->magic = DTAG_CONTAINER_MAGIC;
+  head->version = DTAG_CONTAINER_VERSION;
+  head->nslots = n;
+  head->directory = directory;
+  head->end = end;
+  return DTAG_OK;
+}
+
+static int32_t container_check(dcontainer_t *c) {
+  const dcontainer_head_t *head = container_head(c);
+  if (c->size < sizeof(dcontainer_head_t) || head->magic != DTAG_CONTAINER_MAGIC)
+    return DTAG_ERR_MAGIC;
+  if (head->version != DTAG_CONTAINER_VERSION)
+    return DTAG_ERR_VERSION;
+  if (!head->nslots || (head->nslots & (head->nslots - 1)) || head->end > c->size ||
+      head->directory % DTAG_ALIGN || head->directory > head->end ||
+      (uint64_t)head->nslots * sizeof(dcontainer_entry_t) > head->end - head->directory)
+    return DTAG_ERR_DATA;
+  return DTAG_OK;
+}
+
+int32_t dtag_container_open(dcontainer_t **container, const char *filename, uint32_t flags, uint32_t nslots) {
+  dcontainer_t *c = (dcontainer_t *)calloc(1, sizeof(dcontainer_t));
+  if (!c)
+    return DTAG_ERR_NOMEM;
+  struct stat st;
+  int32_t result = DTAG_OK;
+  int create = flags & DTAG_CONTAINER_CREATE;
+  if ((c->fd = open(filename, O_RDWR | (create ? O_CREAT : 0), 0666)) < 0 || fstat(c->fd, &st)) {
+    logfE("fail to open container: %s (%d:%s)", filename, errno, strerror(errno));
+    result = DTAG_ERR_FILEIO;
+  }
+  if (result == DTAG_OK) {
+    c->size = st.st_size;
+    if (c->size)
+      result = container_map(c, c->size);
+    else
+      result = create ? container_create(c, nslots) : DTAG_ERR_MAGIC;
+  }
+  if (result == DTAG_OK && (result = container_check(c)) != DTAG_OK)
+    logfE("fail to check container: %s (%d)", filename, result);
+  if (result != DTAG_OK) {
+    if (c->base)
+      munmap(c->base, c->size);
+    if (c->fd >= 0)
+      close(c->fd);
+    free(c);
+    return result;
+  }
+  *container = c;
+  return DTAG_OK;
+}
+
+void dtag_container_close(dcontainer_t *container) {
+  munmap(container->base, container->size);
+  close(container->fd);
+  free(container);
+}
+
+int32_t dtag_container_get(dcontainer_t *container, const char *id, dblock_t **block) {
+  dcontainer_entry_t *slot = NULL;
+  dcontainer_entry_t *entry = container_find(container, id, strlen(id), &slot);
+  if (!entry)
+    return DTAG_ERR_NOTFOUND;
+  if (entry->offset % DTAG_ALIGN || entry->offset > container_head(container)->end ||
+      entry->size > container_head(container)->end - entry->offset || entry->size > UINT32_MAX)
+    return DTAG_ERR_DATA;
+  return dtag_import(block, container->base + entry->offset, entry->size);
+}
+
+int32_t dtag_container_put(dcontainer_t *container, const char *id, const dblock_t *block) {
+  uint32_t len = strlen(id);
+  if (len == 0 || len >= DTAG_CONTAINER_IDLEN)
+    return DTAG_ERR_INVPARAM;
+  uint64_t size = block->capacity + sizeof(dblock_t), offset = 0;
+  /* `block` 可能位于映射中（如 `dtag_container_get` 的结果），分配会重新映射，因此记下其偏移 */
+  const uint8_t *src = (const uint8_t *)block;
+  int32_t mapped = src >= container->base && src < container->base + container->size;
+  uint64_t src_offset = mapped ? src - container->base : 0;
+  dcontainer_entry_t *slot = NULL;
+  dcontainer_entry_t *entry = container_find(container, id, len, &slot);
+  if (entry && entry->size >= size) {
+    memmove(container->base + entry->offset, src, size);
+    return DTAG_OK;
+  }
+  int32_t result = DTAG_OK;
+  dcontainer_head_t *head = container_head(container);
+  if (!entry && (head->count + 1) * 4 > head->nslots * 3)
+    result = container_rehash(container);
+  if (result == DTAG_OK)
+    result = container_alloc(container, size, &offset);
+  if (result != DTAG_OK)
+    return result;
+  /* 分配可能重新映射，重新查找 */
+  head = container_head(container);
+  if (mapped)
+    src = container->base + src_offset;
+  if ((entry = container_find(container, id, len, &slot))) {
+    container_free(container, entry->offset, entry->size);
+  } else {
+    entry = slot;
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->id, id, len + 1);
+    entry->state = DTAG_CONTAINER_USED;
+    head->count++;
+  }
+  entry->offset = offset;
+  entry->size = ALIGN_UP(size, DTAG_ALIGN);
+  memcpy(container->base + offset, src, size);
+  return DTAG_OK;
+}
+
+int32_t dtag_container_del(dcontainer_t *container, const char *id) {
+  dcontainer_entry_t *slot = NULL;
+  dcontainer_entry_t *entry = container_find(container, id, strlen(id), &slot);
+  if (!entry)
+    return DTAG_ERR_NOTFOUND;
+  entry->state = DTAG_CONTAINER_DELETED;
+  container_head(container)->count--;
+  container_free(container, entry->offset, entry->size);
+  return DTAG_OK;
+}
+
+int32_t dtag_container_sync(dcontainer_t *container) {
+  if (msync(container->base, container->size, MS_SYNC)) {
+    logfE("fail to sync container (%d:%s)", errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  return DTAG_OK;
+}
+
+int32_t dtag_container_foreach(dcontainer_t *container, dtag_container_f cb, void *arg) {
+  dcontainer_entry_t *dir = container_dir(container);
+  for (uint32_t i = 0; i < container_head(container)->nslots; i++) {
+    if (dir[i].state != DTAG_CONTAINER_USED)
+      continue;
+    int32_t ret = cb(&dir[i], arg);
+    if (ret)
+      return ret;
+  }
+  return DTAG_OK;
+}
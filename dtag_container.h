@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_CONTAINER_H__
+#define __DTAG_CONTAINER_H__
+
+#include "dtag.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 将多个 `dblock` 存入同一个文件，以实体 id 寻址：
+ *   file: | dcontainer_head_t | ... dcontainer_entry_t[nslots] ... dblock ... |
+ * 目录为以 id 哈希（FNV-1a）开放寻址的表，位置记录在头部，装载超过 3/4 时迁移到两倍大小的新位置。
+ * 删除或迁移释放的空间记入头部的空闲表，分配时首次适配，空闲表满时最小的空闲块被放弃。
+ * 文件以 mmap 共享映射，`dtag_container_get` 返回的 `dblock` 直接位于映射中，原位修改即写回文件。
+ */
+
+struct dtag_container_extent {
+  uint64_t offset;
+  uint64_t size;
+} __attribute__((packed));
+typedef struct dtag_container_extent dcontainer_extent_t;
+
+struct dtag_container_head {
+#define DTAG_CONTAINER_MAGIC 0x4E435444
+  uint32_t magic;
+#define DTAG_CONTAINER_VERSION 0x01
+  uint16_t version;
+  uint16_t reserved;
+  // The number of directory entries, a power of 2.
+  uint32_t nslots;
+  // The number of entries in use.
+  uint32_t count;
+  // The offset of the directory in the file.
+  uint64_t directory;
+  // The end of the allocated space, not larger than the file.
+  uint64_t end;
+#define DTAG_CONTAINER_FREE (32)
+  dcontainer_extent_t free[DTAG_CONTAINER_FREE];
+} __attribute__((packed));
+typedef struct dtag_container_head dcontainer_head_t;
+
+struct dtag_container_entry {
+#define DTAG_CONTAINER_IDLEN (32)
+  // Null-terminated.
+  char id[DTAG_CONTAINER_IDLEN];
+  // The extent holding the block, aligned to `DTAG_ALIGN`.
+  uint64_t offset;
+  uint64_t size;
+#define DTAG_CONTAINER_EMPTY 0
+#define DTAG_CONTAINER_USED 1
+#define DTAG_CONTAINER_DELETED 2
+  uint32_t state;
+  uint32_t reserved;
+} __attribute__((packed));
+typedef struct dtag_container_entry dcontainer_entry_t;
+
+#define DTAG_CONTAINER_SLOTS (1024)
+
+typedef struct dtag_container dcontainer_t;
+
+#define DTAG_CONTAINER_CREATE 0x00000001
+
+/**
+ * @brief 打开 `filename`，`flags` 含 `DTAG_CONTAINER_CREATE` 时不存在（或为空）则创建
+ *
+ * @param container 返回句柄，以 `dtag_container_close` 释放
+ * @param filename
+ * @param flags
+ * @param nslots 创建时目录的初始大小，为 0 时使用 `DTAG_CONTAINER_SLOTS`
+ * @return * int32_t 不创建且文件不存在时，返回 DTAG_ERR_FILEIO
+ */
+extern int32_t dtag_container_open(dcontainer_t **container, const char *filename, uint32_t flags, uint32_t nslots);
+/**
+ * @brief 写回映射并关闭，此前取得的 `dblock` 随之失效
+ *
+ * @param container
+ * @return * void
+ */
+extern void dtag_container_close(dcontainer_t *container);
+/**
+ * @brief 通过目录取得 `id` 对应的 `dblock`（经 `dtag_import` 校验）
+ *
+ * @note 返回的 `dblock` 在下一次 `dtag_container_put`/`dtag_container_del` 后失效
+ *
+ * @param container
+ * @param id
+ * @param block
+ * @return * int32_t 不存在时，返回 DTAG_ERR_NOTFOUND
+ */
+extern int32_t dtag_container_get(dcontainer_t *container, const char *id, dblock_t **block);
+/**
+ * @brief 将 `block` 完整复制为 `id` 对应的 `dblock`，已存在时替换
+ *
+ * @note `block` 可以是 `dtag_container_get` 取得的 `dblock`（如复制实体），重新映射时按其偏移重新定位
+ *
+ * @param container
+ * @param id 长度小于 `DTAG_CONTAINER_IDLEN`
+ * @param block
+ * @return * int32_t
+ */
+extern int32_t dtag_container_put(dcontainer_t *container, const char *id, const dblock_t *block);
+/**
+ * @brief 删除 `id` 对应的 `dblock`，释放其空间
+ *
+ * @param container
+ * @param id
+ * @return * int32_t 不存在时，返回 DTAG_ERR_NOTFOUND
+ */
+extern int32_t dtag_container_del(dcontainer_t *container, const char *id);
+/**
+ * @brief 将映射中的修改同步写入磁盘
+ *
+ * @param container
+ * @return * int32_t
+ */
+extern int32_t dtag_container_sync(dcontainer_t *container);
+
+typedef int32_t (*dtag_container_f)(const dcontainer_entry_t *entry, void *arg);
+/**
+ * @brief 按目录顺序遍历全部实体，`cb` 返回非 0 时停止并返回该值
+ *
+ * @param container
+ * @param cb
+ * @param arg
+ * @return * int32_t
+ */
+extern int32_t dtag_container_foreach(dcontainer_t *container, dtag_container_f cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DTAG_CONTAINER_H__
@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtag_flush.h"
+#include "logger/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct dtag_flush {
+  char *filename;
+  char *tmpname;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  /* 通知后台线程有新的快照或需要结束 */
+  pthread_cond_t wake;
+  /* 通知 `dtag_flush_wait` 有快照写入完成 */
+  pthread_cond_t done;
+  /* `buf[front]` 接收快照，另一个由后台线程写入，二者在后台线程取走快照时交换 */
+  uint8_t *buf[2];
+  uint32_t size[2];
+  /* 各 buffer 中上一次快照的长度，新快照较短时清零多出的部分 */
+  uint32_t used[2];
+  uint32_t front;
+  /* 已提交、已取走、已写入的快照序号 */
+  uint64_t requested;
+  uint64_t taken;
+  uint64_t written;
+  int32_t result;
+  int stop;
+};
+
+static int32_t flush_write(dflush_t *flush, dblock_t *block) {
+  uint32_t len = block->capacity + sizeof(dblock_t);
+  const uint8_t *ptr = (const uint8_t *)block;
+
+  dtag_complete(block);
+  int fd = open(flush->tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    logfE("fail to open file: %s (%d:%s)", flush->tmpname, errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  for (uint32_t done = 0; done < len;) {
+    ssize_t n = write(fd, ptr + done, len - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      logfE("fail to write file: %s,%u (%d:%s)", flush->tmpname, len - done, errno, strerror(errno));
+      close(fd);
+      return DTAG_ERR_FILEIO;
+    }
+    done += n;
+  }
+  if (fsync(fd) || close(fd)) {
+    logfE("fail to sync file: %s (%d:%s)", flush->tmpname, errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  if (rename(flush->tmpname, flush->filename)) {
+    logfE("fail to rename file: %s (%d:%s)", flush->filename, errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  return DTAG_OK;
+}
+
+static void *flush_thread(void *arg) {
+  dflush_t *flush = (dflush_t *)arg;
+
+  pthread_mutex_lock(&flush->lock);
+  for (;;) {
+    while (!flush->stop && flush->taken == flush->requested)
+      pthread_cond_wait(&flush->wake, &flush->lock);
+    if (flush->taken == flush->requested)
+      break;
+    uint32_t back = flush->front;
+    uint64_t seq = flush->requested;
+    flush->front ^= 1;
+    flush->taken = seq;
+    pthread_mutex_unlock(&flush->lock);
+
+    int32_t result = flush_write(flush, (dblock_t *)flush->buf[back]);
+
+    pthread_mutex_lock(&flush->lock);
+    flush->written = seq;
+    flush->result = result;
+    pthread_cond_broadcast(&flush->done);
+  }
+  pthread_mutex_unlock(&flush->lock);
+  return NULL;
+}
+
+int32_t dtag_flush_open(dflush_t **flush, const char *filename) {
+  dflush_t *_flush = (dflush_t *)calloc(1, sizeof(dflush_t));
+  if (!_flush)
+    return DTAG_ERR_NOMEM;
+  size_t len = strlen(filename);
+  _flush->filename = strdup(filename);
+  _flush->tmpname = (char *)malloc(len + sizeof(".tmp"));
+  if (!_flush->filename || !_flush->tmpname) {
+    free(_flush->filename);
+    free(_flush->tmpname);
+    free(_flush);
+    return DTAG_ERR_NOMEM;
+  }
+  snprintf(_flush->tmpname, len + sizeof(".tmp"), "%s.tmp", filename);
+  pthread_mutex_init(&_flush->lock, NULL);
+  pthread_cond_init(&_flush->wake, NULL);
+  pthread_cond_init(&_flush->done, NULL);
+  if (pthread_create(&_flush->thread, NULL, flush_thread, _flush)) {
+    logfE("fail to create flush thread: %s", filename);
+    pthread_cond_destroy(&_flush->done);
+    pthread_cond_destroy(&_flush->wake);
+    pthread_mutex_destroy(&_flush->lock);
+    free(_flush->filename);
+    free(_flush->tmpname);
+    free(_flush);
+    return DTAG_ERR_NOMEM;
+  }
+  *flush = _flush;
+  return DTAG_OK;
+}
+
+int32_t dtag_flush(dflush_t *flush, const dblock_t *block) {
+  uint32_t size = block->capacity + sizeof(dblock_t);
+  uint32_t used = block->length + sizeof(dblock_t);
+
+  pthread_mutex_lock(&flush->lock);
+  uint32_t front = flush->front;
+  if (flush->size[front] < size) {
+    uint8_t *buf = (uint8_t *)realloc(flush->buf[front], size);
+    if (!buf) {
+      pthread_mutex_unlock(&flush->lock);
+      logfE("fail to allocate memory: %u", size);
+      return DTAG_ERR_NOMEM;
+    }
+    memset(buf + flush->size[front], 0, size - flush->size[front]);
+    flush->buf[front] = buf;
+    flush->size[front] = size;
+  }
+  memcpy(flush->buf[front], block, used);
+  if (flush->used[front] > used)
+    memset(flush->buf[front] + used, 0, flush->used[front] - used);
+  flush->used[front] = used;
+  flush->requested++;
+  pthread_cond_signal(&flush->wake);
+  pthread_mutex_unlock(&flush->lock);
+  return DTAG_OK;
+}
+
+int32_t dtag_flush_wait(dflush_t *flush) {
+  pthread_mutex_lock(&flush->lock);
+  uint64_t target = flush->requested;
+  while (flush->written < target)
+    pthread_cond_wait(&flush->done, &flush->lock);
+  int32_t result = flush->result;
+  pthread_mutex_unlock(&flush->lock);
+  return result;
+}
+
+void dtag_flush_close(dflush_t *flush) {
+  pthread_mutex_lock(&flush->lock);
+  flush->stop = 1;
+  pthread_cond_signal(&flush->wake);
+  pthread_mutex_unlock(&flush->lock);
+  pthread_join(flush->thread, NULL);
+
+  pthread_cond_destroy(&flush->done);
+  pthread_cond_destroy(&flush->wake);
+  pthread_mutex_destroy(&flush->lock);
+  free(flush->buf[0]);
+  free(flush->buf[1]);
+  free(flush->filename);
+  free(flush->tmpname);
+  free(flush);
+}
@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_FLUSH_H__
+#define __DTAG_FLUSH_H__
+
+#include "dtag.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 后台落盘：`dtag_flush` 只复制 `dblock` 的已用部分作为快照，由后台线程计算 chksum 并写入文件，
+ * 写入期间可继续修改 `dblock`。后台线程忙时，新的快照覆盖尚未开始写入的旧快照（合并）。
+ * 文件先写入 "<filename>.tmp" 并 fsync，再 rename 到 `filename`，不会出现写了一半的文件。
+ */
+
+typedef struct dtag_flush dflush_t;
+
+/**
+ * @brief 创建写入 `filename` 的后台线程
+ *
+ * @param flush 返回句柄，以 `dtag_flush_close` 释放
+ * @param filename
+ * @return * int32_t
+ */
+extern int32_t dtag_flush_open(dflush_t **flush, const char *filename);
+/**
+ * @brief 提交 `block` 的快照，不等待写入
+ *
+ * @note 与修改 `block` 的操作互斥（由调用者保证），仅复制 `sizeof(dblock_t) + length` 字节
+ *
+ * @param flush
+ * @param block
+ * @return * int32_t
+ */
+extern int32_t dtag_flush(dflush_t *flush, const dblock_t *block);
+/**
+ * @brief 等待此前提交的快照（或覆盖它的更新的快照）写入完成
+ *
+ * @param flush
+ * @return * int32_t 最近一次写入的结果
+ */
+extern int32_t dtag_flush_wait(dflush_t *flush);
+/**
+ * @brief 写入尚未写入的快照后，结束后台线程并释放
+ *
+ * @param flush
+ * @return * void
+ */
+extern void dtag_flush_close(dflush_t *flush);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DTAG_FLUSH_H__
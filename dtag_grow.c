@@ -0,0 +1,210 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtag_grow.h"
+#include "logger/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GROW_MAX (UINT32_MAX - sizeof(dblock_t))
+/* 写入一个 ditem 除 key、value 之外可能需要的空间：ditem 头、对齐、偏移表、共享池的条目头 */
+#define GROW_SLACK (64)
+
+struct dtag_grow {
+  dblock_t *block;
+  /* 文件映射时为文件描述符，堆上时为 -1 */
+  int fd;
+  dtag_grow_cb_t cb;
+  void *arg;
+};
+
+/* 先建立新映射再解除旧映射，失败时保持原状 */
+static int32_t grow_remap(dgrow_t *grow, uint32_t capacity) {
+  uint32_t old = grow->block->capacity;
+  size_t size = sizeof(dblock_t) + (size_t)capacity;
+  if (capacity > old && ftruncate(grow->fd, size)) {
+    logfE("fail to truncate block: %lu (%d:%s)", size, errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, grow->fd, 0);
+  if (base == MAP_FAILED) {
+    logfE("fail to map block: %lu (%d:%s)", size, errno, strerror(errno));
+    if (capacity > old)
+      ftruncate(grow->fd, sizeof(dblock_t) + (size_t)old);
+    return DTAG_ERR_FILEIO;
+  }
+  munmap(grow->block, sizeof(dblock_t) + (size_t)old);
+  grow->block = (dblock_t *)base;
+  grow->block->capacity = capacity;
+  /* 此时容量已缩小，截断失败只是文件留有多余的尾部 */
+  if (capacity < old && ftruncate(grow->fd, size))
+    logfW("fail to truncate block: %lu (%d:%s)", size, errno, strerror(errno));
+  return DTAG_OK;
+}
+
+static int32_t grow_realloc(dgrow_t *grow, uint32_t capacity) {
+  uint32_t old = grow->block->capacity;
+  dblock_t *block = (dblock_t *)realloc(grow->block, sizeof(dblock_t) + (size_t)capacity);
+  if (!block) {
+    logfE("fail to realloc block: %u", capacity);
+    return DTAG_ERR_NOMEM;
+  }
+  /* 新增部分清零，导出的文件不含未初始化的内存 */
+  if (capacity > old)
+    memset(block->data + old, 0, capacity - old);
+  block->capacity = capacity;
+  grow->block = block;
+  return DTAG_OK;
+}
+
+static int32_t grow_resize(dgrow_t *grow, uint32_t capacity) {
+  uint32_t old = grow->block->capacity;
+  if (capacity == old)
+    return DTAG_OK;
+  int32_t result = grow->fd < 0 ? grow_realloc(grow, capacity) : grow_remap(grow, capacity);
+  if (result == DTAG_OK && grow->cb)
+    grow->cb(grow->block, old, grow->arg);
+  return result;
+}
+
+/* 扩大到两倍，且至少能再容纳 `need` 字节 */
+static int32_t grow_expand(dgrow_t *grow, uint64_t need) {
+  uint64_t capacity = (uint64_t)grow->block->capacity * 2;
+  if (capacity < grow->block->length + need)
+    capacity = grow->block->length + need;
+  if (capacity > GROW_MAX)
+    capacity = GROW_MAX;
+  if (capacity <= grow->block->capacity)
+    return DTAG_ERR_CAPACITY;
+  return grow_resize(grow, capacity);
+}
+
+static int32_t grow_wrap(dgrow_t **grow, dblock_t *block, int fd) {
+  dgrow_t *g = (dgrow_t *)calloc(1, sizeof(dgrow_t));
+  if (!g)
+    return DTAG_ERR_NOMEM;
+  g->block = block;
+  g->fd = fd;
+  *grow = g;
+  return DTAG_OK;
+}
+
+int32_t dtag_grow_new(dgrow_t **grow, uint32_t capacity, uint32_t flags, uint32_t nslots) {
+  if (capacity > GROW_MAX)
+    return DTAG_ERR_CAPACITY;
+  uint32_t len = sizeof(dblock_t) + capacity;
+  uint8_t *buf = (uint8_t *)calloc(1, len);
+  if (!buf)
+    return DTAG_ERR_NOMEM;
+  dblock_t *block = NULL;
+  int32_t result = nslots ? dtag_init_schema(&block, buf, len, flags, nslots) : dtag_init_ex(&block, buf, len, flags);
+  if (result == DTAG_OK)
+    result = grow_wrap(grow, block, -1);
+  if (result != DTAG_OK)
+    free(buf);
+  return result;
+}
+
+int32_t dtag_grow_adopt(dgrow_t **grow, dblock_t *block) { return grow_wrap(grow, block, -1); }
+
+int32_t dtag_grow_map(dgrow_t **grow, const char *filename) {
+  struct stat st;
+  int fd = open(filename, O_RDWR);
+  if (fd < 0 || fstat(fd, &st)) {
+    logfE("fail to open file: %s (%d:%s)", filename, errno, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return DTAG_ERR_FILEIO;
+  }
+  if (st.st_size < sizeof(dblock_t) || st.st_size > UINT32_MAX) {
+    logfE("invalid size of file: %s,%ld", filename, (long)st.st_size);
+    close(fd);
+    return DTAG_ERR_CAPACITY;
+  }
+  void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    logfE("fail to map file: %s (%d:%s)", filename, errno, strerror(errno));
+    close(fd);
+    return DTAG_ERR_FILEIO;
+  }
+  dblock_t *block = NULL;
+  int32_t result = dtag_import(&block, (uint8_t *)base, st.st_size);
+  if (result == DTAG_OK) {
+    /* 映射的大小由 `capacity` 推算，多余的尾部并入容量 */
+    block->capacity = st.st_size - sizeof(dblock_t);
+    result = grow_wrap(grow, block, fd);
+  }
+  if (result != DTAG_OK) {
+    munmap(base, st.st_size);
+    close(fd);
+  }
+  return result;
+}
+
+void dtag_grow_close(dgrow_t *grow) {
+  if (grow->fd < 0) {
+    free(grow->block);
+  } else {
+    munmap(grow->block, sizeof(dblock_t) + (size_t)grow->block->capacity);
+    close(grow->fd);
+  }
+  free(grow);
+}
+
+dblock_t *dtag_grow_block(dgrow_t *grow) { return grow->block; }
+
+void dtag_grow_notify(dgrow_t *grow, dtag_grow_cb_t cb, void *arg) {
+  grow->cb = cb;
+  grow->arg = arg;
+}
+
+/* `dtag_set` 在 `DTAG_ERR_CAPACITY` 时不修改 `dblock`，可以直接重试 */
+int32_t dtag_grow_set(dgrow_t *grow, const char *key, const uint8_t *val, uint32_t len) {
+  int32_t result = dtag_set(grow->block, key, val, len);
+  while (result == DTAG_ERR_CAPACITY &&
+         (result = grow_expand(grow, (uint64_t)strnlen(key, DTAG_MAX_KLEN) + len + GROW_SLACK)) == DTAG_OK)
+    result = dtag_set(grow->block, key, val, len);
+  return result;
+}
+
+int32_t dtag_grow_set_k(dgrow_t *grow, const dtag_key_t *key, const uint8_t *val, uint32_t len) {
+  int32_t result = dtag_set_k(grow->block, key, val, len);
+  while (result == DTAG_ERR_CAPACITY &&
+         (result = grow_expand(grow, (uint64_t)key->len + len + GROW_SLACK)) == DTAG_OK)
+    result = dtag_set_k(grow->block, key, val, len);
+  return result;
+}
+
+int32_t dtag_grow_reserve(dgrow_t *grow, uint32_t capacity) {
+  if (capacity > GROW_MAX)
+    return DTAG_ERR_CAPACITY;
+  return capacity > grow->block->capacity ? grow_resize(grow, capacity) : DTAG_OK;
+}
+
+int32_t dtag_shrink_to_fit(dgrow_t *grow) { return grow_resize(grow, grow->block->length); }
@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_GROW_H__
+#define __DTAG_GROW_H__
+
+#include "dtag.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 可扩容的 `dblock`：写入因 `DTAG_ERR_CAPACITY` 失败时，容量扩大到原来的两倍（至少容纳本次写入）后重试，
+ * 摊还后每次写入的复制开销为常数。堆上的 `dblock` 以 realloc 扩容；文件映射的 `dblock` 先以 ftruncate
+ * 扩大文件再重新映射，映射的大小即文件的大小。chksum 不覆盖 `capacity` 以外的部分，扩容不影响 `dtag_complete`。
+ * 容量变化后 `dblock` 的地址可能改变，此前取得的 `dblock`、`ditem` 指针全部失效，需经 `dtag_grow_block` 重新获取。
+ */
+
+typedef struct dtag_grow dgrow_t;
+
+/**
+ * @brief 容量变化时的通知，在 `dblock` 已位于新地址后调用
+ *
+ * @param block 新的 `dblock`，其 `capacity` 为新的容量
+ * @param old_capacity 变化前的容量
+ * @param arg
+ */
+typedef void (*dtag_grow_cb_t)(dblock_t *block, uint32_t old_capacity, void *arg);
+
+/**
+ * @brief 在堆上新建 `dblock`，参数同 `dtag_init_schema`；`nslots` 为 0 时同 `dtag_init_ex`
+ *
+ * @param grow 返回句柄，以 `dtag_grow_close` 释放
+ * @param capacity 初始容量
+ * @param flags
+ * @param nslots
+ * @return * int32_t
+ */
+extern int32_t dtag_grow_new(dgrow_t **grow, uint32_t capacity, uint32_t flags, uint32_t nslots);
+/**
+ * @brief 接管以 malloc 分配、起始于 `block` 的 `dblock`（如 `dtag_import_file` 的结果）
+ *
+ * @param grow 返回句柄，成功后 `block` 由句柄释放
+ * @param block
+ * @return * int32_t
+ */
+extern int32_t dtag_grow_adopt(dgrow_t **grow, dblock_t *block);
+/**
+ * @brief 以共享映射打开 `dblock` 文件，原位修改即写回文件
+ *
+ * @note 文件大于 `sizeof(dblock_t) + capacity` 时，`capacity` 扩展到整个文件
+ *
+ * @param grow 返回句柄
+ * @param filename
+ * @return * int32_t
+ */
+extern int32_t dtag_grow_map(dgrow_t **grow, const char *filename);
+/**
+ * @brief 释放句柄；堆上的 `dblock` 随之释放，文件映射的 `dblock` 解除映射
+ *
+ * @param grow
+ * @return * void
+ */
+extern void dtag_grow_close(dgrow_t *grow);
+
+/**
+ * @brief 返回当前的 `dblock`
+ *
+ * @param grow
+ * @return * dblock_t*
+ */
+extern dblock_t *dtag_grow_block(dgrow_t *grow);
+/**
+ * @brief 设置容量变化的通知，`cb` 为 NULL 时取消
+ *
+ * @param grow
+ * @param cb
+ * @param arg
+ * @return * void
+ */
+extern void dtag_grow_notify(dgrow_t *grow, dtag_grow_cb_t cb, void *arg);
+
+/**
+ * @brief 同 `dtag_set`，容量不足时扩容后重试
+ *
+ * @param grow
+ * @param key
+ * @param val
+ * @param len
+ * @return * int32_t 扩容失败时，返回 DTAG_ERR_NOMEM 或 DTAG_ERR_FILEIO；已达到最大容量时，返回 DTAG_ERR_CAPACITY
+ */
+extern int32_t dtag_grow_set(dgrow_t *grow, const char *key, const uint8_t *val, uint32_t len);
+extern int32_t dtag_grow_set_k(dgrow_t *grow, const dtag_key_t *key, const uint8_t *val, uint32_t len);
+/**
+ * @brief 确保容量不小于 `capacity`，不会缩小
+ *
+ * @param grow
+ * @param capacity
+ * @return * int32_t
+ */
+extern int32_t dtag_grow_reserve(dgrow_t *grow, uint32_t capacity);
+/**
+ * @brief 将容量缩小到 `length`，文件映射时同时截断文件
+ *
+ * @param grow
+ * @return * int32_t
+ */
+extern int32_t dtag_shrink_to_fit(dgrow_t *grow);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DTAG_GROW_H__
@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtag_heat.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HEAT_INITIAL (64)
+
+struct dtag_heat {
+  uint32_t rate;
+  /* 以 key 的哈希开放寻址，`hash` 为 0 表示空 */
+  uint32_t nslots;
+  uint32_t count;
+  struct {
+    uint32_t hash;
+    uint32_t count;
+  } *slots;
+};
+
+_Thread_local dheat_t *g_dtag_heat;
+static _Thread_local uint32_t g_heat_tick;
+
+inline static uint32_t heat_hash(const char *key, uint32_t klen) {
+  uint32_t hash = dtag_key_hash(key, klen);
+  return hash ? hash : 1;
+}
+
+static uint32_t heat_find(const dheat_t *heat, uint32_t hash) {
+  uint32_t mask = heat->nslots - 1, i = hash & mask;
+  while (heat->slots[i].hash && heat->slots[i].hash != hash)
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* 装载超过 3/4 时迁移到两倍大小 */
+static int32_t heat_grow(dheat_t *heat) {
+  dheat_t bigger = *heat;
+  bigger.nslots = heat->nslots * 2;
+  if (!(bigger.slots = calloc(bigger.nslots, sizeof(*bigger.slots))))
+    return DTAG_ERR_NOMEM;
+  for (uint32_t i = 0; i < heat->nslots; i++) {
+    if (heat->slots[i].hash)
+      bigger.slots[heat_find(&bigger, heat->slots[i].hash)] = heat->slots[i];
+  }
+  free(heat->slots);
+  *heat = bigger;
+  return DTAG_OK;
+}
+
+int32_t dtag_heat_new(dheat_t **heat, uint32_t rate) {
+  dheat_t *h = (dheat_t *)calloc(1, sizeof(dheat_t));
+  if (!h)
+    return DTAG_ERR_NOMEM;
+  h->rate = rate ? rate : 1;
+  h->nslots = HEAT_INITIAL;
+  if (!(h->slots = calloc(h->nslots, sizeof(*h->slots)))) {
+    free(h);
+    return DTAG_ERR_NOMEM;
+  }
+  *heat = h;
+  return DTAG_OK;
+}
+
+void dtag_heat_free(dheat_t *heat) {
+  free(heat->slots);
+  free(heat);
+}
+
+dheat_t *dtag_heat_bind(dheat_t *heat) {
+  dheat_t *prev = g_dtag_heat;
+  g_dtag_heat = heat;
+  g_heat_tick = 0;
+  return prev;
+}
+
+uint32_t dtag_heat_count(const dheat_t *heat, const char *key, uint32_t klen) {
+  return heat->slots[heat_find(heat, heat_hash(key, klen))].count;
+}
+
+void dtag_heat_reset(dheat_t *heat) {
+  memset(heat->slots, 0, sizeof(*heat->slots) * heat->nslots);
+  heat->count = 0;
+}
+
+void dtag_heat_sample(const char *key, uint32_t klen) {
+  dheat_t *heat = g_dtag_heat;
+  if (++g_heat_tick < heat->rate)
+    return;
+  g_heat_tick = 0;
+  uint32_t hash = heat_hash(key, klen), i = heat_find(heat, hash);
+  if (!heat->slots[i].hash) {
+    if (heat->count + 1 > heat->nslots / 4 * 3) {
+      if (heat_grow(heat) != DTAG_OK)
+        return;
+      i = heat_find(heat, hash);
+    }
+    heat->slots[i].hash = hash;
+    heat->count++;
+  }
+  if (heat->slots[i].count < UINT32_MAX)
+    heat->slots[i].count++;
+}
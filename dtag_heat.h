@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_HEAT_H__
+#define __DTAG_HEAT_H__
+
+#include "dtag.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 按访问频度重排 `ditem` 链：`dheat_t` 绑定到线程后，该线程对 get, set, del 等公开接口的调用每 `rate` 次采样一次 key
+ * （convert、patch 等内部查找不计入），
+ * 按 key 的 FNV-1a 计数，计数只在内存中，不写入 `dblock`。
+ * 未排序的 `dblock` 线性查找，`dtag_optimize` 将计数最高的 `ditem` 移到链首，热点 key 只需经过最前面的几个 cache line。
+ * 同一 `dheat_t` 不可同时绑定到多个线程。
+ */
+
+typedef struct dtag_heat dheat_t;
+
+/**
+ * @brief 创建计数表
+ *
+ * @param heat 返回句柄，以 `dtag_heat_free` 释放
+ * @param rate 每 `rate` 次查找采样一次，为 0 时同 1
+ * @return * int32_t
+ */
+extern int32_t dtag_heat_new(dheat_t **heat, uint32_t rate);
+/**
+ * @brief 释放计数表，调用前需解除绑定
+ *
+ * @param heat
+ * @return * void
+ */
+extern void dtag_heat_free(dheat_t *heat);
+/**
+ * @brief 将 `heat` 绑定到当前线程，NULL 时解除绑定
+ *
+ * @param heat
+ * @return * dheat_t* 此前绑定的计数表
+ */
+extern dheat_t *dtag_heat_bind(dheat_t *heat);
+/**
+ * @brief 查询 key 的采样计数
+ *
+ * @param heat
+ * @param key
+ * @param klen
+ * @return * uint32_t
+ */
+extern uint32_t dtag_heat_count(const dheat_t *heat, const char *key, uint32_t klen);
+/**
+ * @brief 清零全部计数
+ *
+ * @param heat
+ * @return * void
+ */
+extern void dtag_heat_reset(dheat_t *heat);
+
+/**
+ * @brief 按 `heat` 的计数从高到低重写 `ditem` 链，计数相同时保持原有顺序；槽位随之更新
+ *
+ * @note 有序 `dblock` 以二分查找，与位置无关，不做改动；之后需调用 `dtag_complete`
+ *
+ * @param block
+ * @param heat
+ * @return * int32_t
+ */
+extern int32_t dtag_optimize(dblock_t *block, const dheat_t *heat);
+
+/* 以下供 libdtag 内部使用 */
+
+#ifndef __cplusplus
+/* 当前线程绑定的计数表，未绑定时为 NULL，供调用方内联判断后再调用 `dtag_heat_sample` */
+extern _Thread_local dheat_t *g_dtag_heat;
+#endif
+/**
+ * @brief 采样 key，调用前需确认当前线程绑定了计数表
+ *
+ * @param key
+ * @param klen
+ * @return * void
+ */
+extern void dtag_heat_sample(const char *key, uint32_t klen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DTAG_HEAT_H__
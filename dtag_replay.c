@@ -0,0 +1,389 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// FILE: dtag_replay.c
+
+#include "dtag.h"
+#include "dtag_trace.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/* per-op latency, in log2 buckets of nanoseconds */
+
+#define HIST_BUCKETS 32
+
+typedef struct {
+  uint64_t count;
+  uint64_t mismatch;
+  uint64_t total;
+  uint64_t recorded;
+  uint64_t max;
+  uint64_t buckets[HIST_BUCKETS];
+} replay_hist_t;
+
+static replay_hist_t g_hists[DTAG_OP_MAX];
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void hist_add(replay_hist_t *hist, uint64_t ns, uint32_t recorded, int mismatch) {
+  uint32_t bucket = 0;
+  while (bucket < HIST_BUCKETS - 1 && (ns >> (bucket + 1)))
+    bucket++;
+  hist->count++;
+  hist->mismatch += mismatch;
+  hist->total += ns;
+  hist->recorded += recorded;
+  hist->max = ns > hist->max ? ns : hist->max;
+  hist->buckets[bucket]++;
+}
+
+/* 返回第 `permille`‰ 个样本所在桶的上界 */
+static uint64_t hist_quantile(const replay_hist_t *hist, uint32_t permille) {
+  uint64_t rank = (hist->count * permille + 999) / 1000, seen = 0;
+  for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= rank && seen)
+      return (2ull << i) - 1;
+  }
+  return hist->max;
+}
+
+static void hist_print(int verbose) {
+  printf("%-12s %10s %8s %10s %10s %10s %10s %10s\n", "op", "count", "mismatch", "mean(ns)", "p50(ns)", "p99(ns)",
+         "max(ns)", "rec(ns)");
+  for (uint32_t op = 1; op < DTAG_OP_MAX; op++) {
+    const replay_hist_t *hist = &g_hists[op];
+    if (!hist->count)
+      continue;
+    printf("%-12s %10lu %8lu %10lu %10lu %10lu %10lu %10lu\n", dtag_op_name(op), hist->count, hist->mismatch,
+           hist->total / hist->count, hist_quantile(hist, 500), hist_quantile(hist, 990), hist->max,
+           hist->recorded / hist->count);
+    if (!verbose)
+      continue;
+    uint64_t peak = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++)
+      peak = hist->buckets[i] > peak ? hist->buckets[i] : peak;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+      if (!hist->buckets[i])
+        continue;
+      printf("  %10lu .. %-10lu %10lu |", i ? 1ul << i : 0, (2ul << i) - 1, hist->buckets[i]);
+      for (uint64_t n = hist->buckets[i] * 40 / peak; n; n--)
+        putchar('#');
+      putchar('\n');
+    }
+  }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+typedef struct {
+  dblock_t *block;
+  uint8_t *buf;
+  ditem_t *cursor;
+  uint8_t *value;
+  uint32_t capacity;
+  uint32_t flags;
+  const char *path;
+} replay_ctx_t;
+
+static int32_t count_item(ditem_t *item, void *arg) {
+  (*(uint64_t *)arg)++;
+  return 0;
+}
+
+/* `dtag_import_file` 得到的 `dblock` 由 libdtag 分配，其余使用 `ctx->buf` */
+static void ctx_drop(replay_ctx_t *ctx) {
+  if (ctx->block && (uint8_t *)ctx->block != ctx->buf)
+    free(ctx->block);
+  free(ctx->buf);
+  ctx->block = NULL;
+  ctx->buf = NULL;
+  ctx->cursor = NULL;
+}
+
+static int32_t ctx_init(replay_ctx_t *ctx, uint32_t len, uint32_t flags) {
+  ctx_drop(ctx);
+  if (!(ctx->buf = malloc(len ? len : 1)))
+    return DTAG_ERR_NOMEM;
+  if (flags & DTAG_FLAG_SCHEMA)
+    return dtag_init_schema(&ctx->block, ctx->buf, len, flags & 0xFFFF & ~DTAG_FLAG_SCHEMA, flags >> 16);
+  return dtag_init_ex(&ctx->block, ctx->buf, len, flags);
+}
+
+/* 除 init/import 外的 op 都需要一个 `dblock`，trace 从中途开始时按命令行参数新建 */
+static int32_t ctx_ensure(replay_ctx_t *ctx) {
+  if (ctx->block)
+    return DTAG_OK;
+  return ctx_init(ctx, ctx->capacity, ctx->flags);
+}
+
+static int32_t replay_one(replay_ctx_t *ctx, const dtrace_rec_t *rec, const dtag_key_t *key) {
+  uint32_t len = DTAG_MAX_VLEN;
+  uint64_t found = 0;
+  ditem_t *item = NULL;
+  int32_t result = DTAG_OK;
+
+  if (rec->op != DTAG_OP_INIT && rec->op != DTAG_OP_IMPORT && rec->op != DTAG_OP_IMPORT_FILE &&
+      (result = ctx_ensure(ctx)) != DTAG_OK)
+    return result;
+
+  switch (rec->op) {
+  case DTAG_OP_INIT:
+    return ctx_init(ctx, rec->arg, rec->aux);
+  case DTAG_OP_IMPORT: {
+    /* 以当前 `dblock` 的副本作为输入，尚无 `dblock` 时按记录的容量与特性新建 */
+    if (!ctx->block && rec->arg && (result = ctx_init(ctx, rec->arg, rec->aux)) != DTAG_OK)
+      return result;
+    if ((result = ctx_ensure(ctx)) != DTAG_OK)
+      return result;
+    uint32_t size = sizeof(dblock_t) + ctx->block->capacity;
+    uint8_t *buf = malloc(size);
+    if (!buf)
+      return DTAG_ERR_NOMEM;
+    memcpy(buf, ctx->block, size);
+    dblock_t *block = NULL;
+    if ((result = dtag_import(&block, buf, size)) != DTAG_OK) {
+      free(buf);
+      return result;
+    }
+    ctx_drop(ctx);
+    ctx->block = block;
+    ctx->buf = buf;
+    return DTAG_OK;
+  }
+  case DTAG_OP_IMPORT_FILE: {
+    if (!ctx->block && rec->arg && (result = ctx_init(ctx, rec->arg, rec->aux)) != DTAG_OK)
+      return result;
+    if ((result = ctx_ensure(ctx)) != DTAG_OK)
+      return result;
+    dtag_complete(ctx->block);
+    if ((result = dtag_export_file(ctx->block, ctx->path)) != DTAG_OK)
+      return result;
+    dblock_t *block = NULL;
+    if ((result = dtag_import_file(&block, ctx->path)) != DTAG_OK)
+      return result;
+    ctx_drop(ctx);
+    ctx->block = block;
+    return DTAG_OK;
+  }
+  case DTAG_OP_EXPORT_FILE:
+    return dtag_export_file(ctx->block, ctx->path);
+  case DTAG_OP_COMPLETE:
+    dtag_complete(ctx->block);
+    return DTAG_OK;
+  case DTAG_OP_NEXT:
+    if (rec->arg)
+      ctx->cursor = NULL;
+    result = dtag_next(ctx->block, &ctx->cursor);
+    if (result != DTAG_OK)
+      ctx->cursor = NULL;
+    return result;
+  case DTAG_OP_GET_INNER:
+    return dtag_get_inner_k(ctx->block, key, &item);
+  case DTAG_OP_GET:
+    return dtag_get_k(ctx->block, key, ctx->value, &len);
+  case DTAG_OP_SET:
+    ctx->cursor = NULL;
+    return dtag_set_k(ctx->block, key, ctx->value, rec->arg & DTAG_MAX_VLEN);
+  case DTAG_OP_DEL:
+    ctx->cursor = NULL;
+    return dtag_del_k(ctx->block, key);
+  case DTAG_OP_SCAN:
+    return dtag_scan_prefix(ctx->block, key->str, count_item, &found);
+  case DTAG_OP_GET_SLOT:
+    return dtag_get_slot(ctx->block, rec->arg, &item);
+  case DTAG_OP_SET_SLOT:
+    ctx->cursor = NULL;
+    return dtag_set_slot(ctx->block, rec->arg, key, ctx->value, rec->aux & DTAG_MAX_VLEN);
+  case DTAG_OP_GET_TYPED:
+    if (rec->arg == sizeof(uint32_t))
+      return dtag_get_u32_k(ctx->block, key, (uint32_t *)&found);
+    return dtag_get_u64_k(ctx->block, key, &found);
+  case DTAG_OP_ADD:
+    return dtag_add_u64_k(ctx->block, key, rec->arg, &found);
+  case DTAG_OP_GET_RANGE:
+    len = rec->aux < len ? rec->aux : len;
+    return dtag_get_range(ctx->block, key->str, rec->arg, ctx->value, &len);
+  case DTAG_OP_GET_RANGE_FILE:
+    /* 读取最近一次 export/import_file 写出的 scratch 文件 */
+    len = rec->aux < len ? rec->aux : len;
+    return dtag_get_range_file(ctx->path, key->str, rec->arg, ctx->value, &len);
+  case DTAG_OP_SET_SUB: {
+    dblock_t *sub = NULL;
+    ctx->cursor = NULL;
+    return dtag_set_sub(ctx->block, key->str, rec->arg, rec->aux, &sub);
+  }
+  case DTAG_OP_GET_SUB: {
+    dblock_t *sub = NULL;
+    return dtag_get_sub(ctx->block, key->str, &sub);
+  }
+  case DTAG_OP_GET_PATH:
+    return dtag_get_path(ctx->block, key->str, ctx->value, &len);
+  default:
+    return DTAG_ERR_INVPARAM;
+  }
+}
+
+/* 依赖 trace 以外输入（文件列表、另一个 `dblock`、patch、heat 等）的 op 只记录，回放时跳过 */
+static int replayable(dtag_op_t op) {
+  switch (op) {
+  case DTAG_OP_IMPORT_FILES:
+  case DTAG_OP_EXPORT_FILES:
+  case DTAG_OP_DIFF:
+  case DTAG_OP_PATCH:
+  case DTAG_OP_OPTIMIZE:
+  case DTAG_OP_CONVERT:
+    return 0;
+  default:
+    return 1;
+  }
+}
+
+static void sleep_until(uint64_t deadline) {
+  for (uint64_t now = now_ns(); now < deadline; now = now_ns()) {
+    uint64_t ns = deadline - now;
+    struct timespec ts = {ns / 1000000000ull, ns % 1000000000ull};
+    nanosleep(&ts, NULL);
+  }
+}
+
+static int replay(FILE *file, replay_ctx_t *ctx, int realtime) {
+  dtrace_head_t head;
+  if (fread(&head, 1, sizeof(head), file) != sizeof(head) || head.magic != DTAG_TRACE_MAGIC) {
+    fprintf(stderr, "not a dtag trace\n");
+    return EXIT_FAILURE;
+  }
+  if (head.version != DTAG_TRACE_VERSION) {
+    fprintf(stderr, "unsupported trace version %u\n", head.version);
+    return EXIT_FAILURE;
+  }
+
+  uint8_t buf[sizeof(dtrace_rec_t) + DTAG_MAX_KLEN];
+  dtrace_rec_t *rec = (dtrace_rec_t *)buf;
+  uint64_t clock = now_ns(), records = 0, skipped = 0;
+  while (fread(rec, 1, sizeof(dtrace_rec_t), file) == sizeof(dtrace_rec_t)) {
+    /* 多留一字节作结尾的 '\0'，按字符串使用的 op（如 scan）依赖它 */
+    char str[DTAG_MAX_KLEN + 1] = {0};
+    if (fread(str, 1, rec->klen, file) != rec->klen) {
+      fprintf(stderr, "truncated record #%lu\n", records);
+      break;
+    }
+    records++;
+    if (rec->op == 0 || rec->op >= DTAG_OP_MAX) {
+      fprintf(stderr, "skip unknown op %u in record #%lu\n", rec->op, records);
+      continue;
+    }
+    if (!replayable(rec->op)) {
+      clock += rec->delta;
+      skipped++;
+      continue;
+    }
+    dtag_key_t key = {str, 0, 0};
+    if (rec->klen && dtag_key_prepare_n(&key, str, rec->klen) != DTAG_OK)
+      key.len = 0;
+    if (realtime) {
+      clock += rec->delta;
+      sleep_until(clock);
+    }
+    uint64_t begin = now_ns();
+    int32_t result = replay_one(ctx, rec, &key);
+    hist_add(&g_hists[rec->op], now_ns() - begin, rec->duration, result != rec->result);
+  }
+  printf("Replayed %lu records\n", records - skipped);
+  if (skipped)
+    printf("Skipped %lu records of ops that cannot be replayed\n", skipped);
+  return EXIT_SUCCESS;
+}
+
+static void print_usage(const char *prog_name) {
+  printf("Usage: %s [options] {trace}\n", prog_name);
+  printf("Options:\n");
+  printf("  -r                  - Replay with the original timing (default max speed)\n");
+  printf("  -c {capacity}       - Capacity of the block if the trace has no init (default 65536)\n");
+  printf("  -F {flags}          - Flags of the block if the trace has no init (default 0)\n");
+  printf("  -o {file}           - Scratch file for export/import (default dtag_replay.bin)\n");
+  printf("  -H                  - Print the latency histogram of each op\n");
+  printf("Record a trace by building with -DDTAG_TRACE=ON and setting env dtag_trace={trace}.\n");
+}
+
+int main(int argc, char *argv[]) {
+  replay_ctx_t ctx = {.capacity = 65536, .path = "dtag_replay.bin"};
+  int realtime = 0, verbose = 0;
+
+  for (int opt; (opt = getopt(argc, argv, "rc:F:o:Hh")) != -1;) {
+    switch (opt) {
+    case 'r':
+      realtime = 1;
+      break;
+    case 'c':
+      ctx.capacity = strtoul(optarg, NULL, 0) + sizeof(dblock_t);
+      break;
+    case 'F':
+      ctx.flags = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      ctx.path = optarg;
+      break;
+    case 'H':
+      verbose = 1;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind != argc - 1) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *file = fopen(argv[optind], "rb");
+  if (!file) {
+    perror(argv[optind]);
+    return EXIT_FAILURE;
+  }
+  /* 回放本身不应被记录 */
+  dtag_trace_close();
+  if (!(ctx.value = calloc(1, DTAG_MAX_VLEN + 1))) {
+    fclose(file);
+    return EXIT_FAILURE;
+  }
+  int ret = replay(file, &ctx, realtime);
+  fclose(file);
+  if (ret == EXIT_SUCCESS)
+    hist_print(verbose);
+  ctx_drop(&ctx);
+  free(ctx.value);
+  unlink(ctx.path);
+  return ret;
+}
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtag_stats.h"
+#include "dtag.h"
+#include <string.h>
+
+/* USDT probe 的参数同样取自这里的计数 */
+#if defined(__DTAG_STATS__) || defined(__DTAG_USDT__)
+static _Thread_local dtag_stats_t g_stats;
+
+dtag_stats_t *dtag_stats_local(void) { return &g_stats; }
+#else
+dtag_stats_t *dtag_stats_local(void) { return NULL; }
+#endif
+
+#ifdef __DTAG_STATS__
+
+void dtag_stats_op(dtag_op_t op, uint64_t nanos, int32_t result) {
+  uint32_t bucket = 0;
+  while (bucket < DTAG_STATS_BUCKETS - 1 && (nanos >> (bucket + 1)))
+    bucket++;
+  g_stats.calls[op]++;
+  g_stats.errors[op] += result != DTAG_OK;
+  g_stats.nanos[op] += nanos;
+  g_stats.latency[op][bucket]++;
+}
+
+int32_t dtag_stats_get(dtag_stats_t *stats) {
+  memcpy(stats, &g_stats, sizeof(g_stats));
+  return DTAG_OK;
+}
+
+void dtag_stats_reset(void) { memset(&g_stats, 0, sizeof(g_stats)); }
+
+#else
+
+void dtag_stats_op(dtag_op_t op, uint64_t nanos, int32_t result) {}
+int32_t dtag_stats_get(dtag_stats_t *stats) { return DTAG_ERR_NOTSUPP; }
+void dtag_stats_reset(void) {}
+
+#endif /* __DTAG_STATS__ */
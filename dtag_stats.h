@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_STATS_H__
+#define __DTAG_STATS_H__
+
+#include "dtag_trace.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 定义 `__DTAG_STATS__` 时编译统计功能。统计按线程独立累计，互不加锁。
+ */
+
+struct dtag_stats {
+  // Calls of each `dtag_op`.
+  uint64_t calls[DTAG_OP_MAX];
+  // Calls of each `dtag_op` not returning DTAG_OK.
+  uint64_t errors[DTAG_OP_MAX];
+  // Total time of each `dtag_op` in nanoseconds.
+  uint64_t nanos[DTAG_OP_MAX];
+#define DTAG_STATS_BUCKETS 32
+  // Latency histogram of each `dtag_op`, bucket `i` counts calls taking [2^i, 2^(i+1)) nanoseconds.
+  uint64_t latency[DTAG_OP_MAX][DTAG_STATS_BUCKETS];
+  // Lookups rejected by the bloom filter.
+  uint64_t bloom_rejects;
+  // Items visited by lookups, including the probes of binary search.
+  uint64_t items_scanned;
+  // Bytes moved by set and del.
+  uint64_t bytes_moved;
+  // Bytes and time spent in `chksum_compute`.
+  uint64_t chksum_bytes;
+  uint64_t chksum_nanos;
+  // Bytes and time spent in file I/O of `dtag_import_file` and `dtag_export_file`.
+  uint64_t fileio_bytes;
+  uint64_t fileio_nanos;
+  // Uncompressed bytes and time spent in LZ4 compression and decompression.
+  uint64_t codec_bytes;
+  uint64_t codec_nanos;
+};
+typedef struct dtag_stats dtag_stats_t;
+
+/**
+ * @brief 获取当前线程的统计
+ *
+ * @param stats
+ * @return * int32_t 未编译统计功能时，返回 DTAG_ERR_NOTSUPP
+ */
+extern int32_t dtag_stats_get(dtag_stats_t *stats);
+/**
+ * @brief 清零当前线程的统计
+ *
+ * @return * void
+ */
+extern void dtag_stats_reset(void);
+
+/* 以下供 libdtag 内部使用 */
+
+extern dtag_stats_t *dtag_stats_local(void);
+extern void dtag_stats_op(dtag_op_t op, uint64_t nanos, int32_t result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DTAG_STATS_H__
@@ -0,0 +1,161 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtag_trace.h"
+#include "dtag.h"
+#include "dtag_stats.h"
+#include "logger/logger.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *g_op_names[DTAG_OP_MAX] = {
+    "unknown", "init", "import", "import_file", "export_file", "complete", "next",
+    "get_inner", "get", "set", "del", "scan", "get_slot", "set_slot", "get_typed", "add",
+    "import_files", "export_files", "diff", "patch",
+    "get_range", "range_file", "optimize", "convert",
+    "set_sub", "get_sub", "get_path",
+};
+
+const char *dtag_op_name(dtag_op_t op) { return g_op_names[op < DTAG_OP_MAX ? op : 0]; }
+
+uint64_t dtag_trace_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+#ifdef __DTAG_TRACE__
+
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_trace_once = PTHREAD_ONCE_INIT;
+static FILE *g_trace = NULL;
+static uint64_t g_trace_last = 0;
+
+static int32_t trace_open(const char *filename) {
+  dtrace_head_t head = {DTAG_TRACE_MAGIC, DTAG_TRACE_VERSION, 0};
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    logfE("fail to open file: %s (%d:%s)", filename, errno, strerror(errno));
+    return DTAG_ERR_FILEIO;
+  }
+  if (fwrite(&head, 1, sizeof(head), file) != sizeof(head)) {
+    logfE("fail to write file: %s,%lu", filename, sizeof(head));
+    fclose(file);
+    return DTAG_ERR_FILEIO;
+  }
+  pthread_mutex_lock(&g_trace_lock);
+  if (g_trace)
+    fclose(g_trace);
+  g_trace = file;
+  g_trace_last = dtag_trace_now();
+  pthread_mutex_unlock(&g_trace_lock);
+  return DTAG_OK;
+}
+
+static void trace_env(void) {
+  const char *filename = getenv(__DTAG_TRACE__);
+  if (filename && filename[0] != '\0')
+    trace_open(filename);
+}
+
+/* 显式调用 open/close 后，不再根据环境变量开始记录 */
+static void trace_none(void) {}
+
+int32_t dtag_trace_open(const char *filename) {
+  pthread_once(&g_trace_once, trace_none);
+  return trace_open(filename);
+}
+
+void dtag_trace_close(void) {
+  pthread_once(&g_trace_once, trace_none);
+  pthread_mutex_lock(&g_trace_lock);
+  if (g_trace)
+    fclose(g_trace);
+  g_trace = NULL;
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
+static void trace_write(uint64_t begin, uint64_t end, dtag_op_t op, const char *key, uint32_t klen, uint32_t arg,
+                        uint32_t aux, int32_t result) {
+  uint8_t buf[sizeof(dtrace_rec_t) + DTAG_MAX_KLEN];
+  dtrace_rec_t *rec = (dtrace_rec_t *)buf;
+
+  rec->op = op;
+  rec->klen = key ? klen : 0;
+  rec->result = result;
+  rec->arg = arg;
+  rec->aux = aux;
+  rec->duration = end - begin > UINT32_MAX ? UINT32_MAX : end - begin;
+  if (rec->klen)
+    memcpy(rec->key, key, rec->klen);
+
+  pthread_mutex_lock(&g_trace_lock);
+  if (g_trace) {
+    rec->delta = begin > g_trace_last ? begin - g_trace_last : 0;
+    g_trace_last = begin > g_trace_last ? begin : g_trace_last;
+    fwrite(rec, 1, sizeof(dtrace_rec_t) + rec->klen, g_trace);
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+}
+
+#else
+
+int32_t dtag_trace_open(const char *filename) { return DTAG_ERR_NOTSUPP; }
+void dtag_trace_close(void) {}
+
+#endif /* __DTAG_TRACE__ */
+
+uint64_t dtag_trace_enter(void) {
+#ifdef __DTAG_STATS__
+  return dtag_trace_now();
+#else
+#ifdef __DTAG_TRACE__
+  pthread_once(&g_trace_once, trace_env);
+  if (__atomic_load_n(&g_trace, __ATOMIC_RELAXED))
+    return dtag_trace_now();
+#endif
+  return 0;
+#endif
+}
+
+void dtag_trace_leave(uint64_t begin, dtag_op_t op, const char *key, uint32_t klen, uint32_t arg, uint32_t aux,
+                      int32_t result) {
+#if defined(__DTAG_STATS__) || defined(__DTAG_TRACE__)
+  if (!begin)
+    return;
+  uint64_t end = dtag_trace_now();
+#ifdef __DTAG_STATS__
+  dtag_stats_op(op, end - begin, result);
+#endif
+#ifdef __DTAG_TRACE__
+  pthread_once(&g_trace_once, trace_env);
+  if (__atomic_load_n(&g_trace, __ATOMIC_RELAXED))
+    trace_write(begin, end, op, key, klen, arg, aux, result);
+#endif
+#endif
+}
@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DTAG_TRACE_H__
+#define __DTAG_TRACE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 定义 `__DTAG_TRACE__` 为环境变量名（如 "dtag_trace"）时编译 trace 功能：
+ * 环境变量指定文件名时，首次调用 API 即开始记录；也可调用 `dtag_trace_open` 显式开始。
+ * trace 文件为 `dtrace_head_t` 后接若干条 `dtrace_rec_t`（各自后接 `klen` 字节的 key）。
+ */
+
+enum dtag_op {
+  DTAG_OP_INIT = 1,
+  DTAG_OP_IMPORT,
+  DTAG_OP_IMPORT_FILE,
+  DTAG_OP_EXPORT_FILE,
+  DTAG_OP_COMPLETE,
+  DTAG_OP_NEXT,
+  DTAG_OP_GET_INNER,
+  DTAG_OP_GET,
+  DTAG_OP_SET,
+  DTAG_OP_DEL,
+  DTAG_OP_SCAN,
+  DTAG_OP_GET_SLOT,
+  DTAG_OP_SET_SLOT,
+  DTAG_OP_GET_TYPED,
+  DTAG_OP_ADD,
+  DTAG_OP_IMPORT_FILES,
+  DTAG_OP_EXPORT_FILES,
+  DTAG_OP_DIFF,
+  DTAG_OP_PATCH,
+  DTAG_OP_GET_RANGE,
+  DTAG_OP_GET_RANGE_FILE,
+  DTAG_OP_OPTIMIZE,
+  DTAG_OP_CONVERT,
+  DTAG_OP_SET_SUB,
+  DTAG_OP_GET_SUB,
+  DTAG_OP_GET_PATH,
+  DTAG_OP_MAX,
+};
+typedef uint8_t dtag_op_t;
+
+struct dtag_trace_head {
+#define DTAG_TRACE_MAGIC 0x52544444
+  uint32_t magic;
+#define DTAG_TRACE_VERSION 0x01
+  uint16_t version;
+  uint16_t reserved;
+} __attribute__((packed));
+typedef struct dtag_trace_head dtrace_head_t;
+
+struct dtag_trace_rec {
+  dtag_op_t op;
+  // The length of the key following the record.
+  uint8_t klen;
+  // The result of the call, see `dtag_error`.
+  int16_t result;
+  // Op specific: value length, capacity, slot, delta (low 32 bits) ...
+  uint32_t arg;
+  // Op specific: flags (with `nslots` in the high 16 bits for init) ...
+  uint32_t aux;
+  // The duration of the call in nanoseconds.
+  uint32_t duration;
+  // The start of the call in nanoseconds, relative to the previous record.
+  uint64_t delta;
+  uint8_t key[];
+} __attribute__((packed));
+typedef struct dtag_trace_rec dtrace_rec_t;
+
+/**
+ * @brief 开始记录到 `filename`（覆盖），已在记录时先结束之前的记录
+ *
+ * @param filename
+ * @return * int32_t 未编译 trace 功能时，返回 DTAG_ERR_NOTSUPP
+ */
+extern int32_t dtag_trace_open(const char *filename);
+/**
+ * @brief 结束记录
+ *
+ * @return * void
+ */
+extern void dtag_trace_close(void);
+extern const char *dtag_op_name(dtag_op_t op);
+
+/* 以下供 libdtag 内部使用 */
+
+extern uint64_t dtag_trace_now(void);
+/**
+ * @brief 未在记录（且未编译统计功能）时返回 0，此时 `dtag_trace_leave` 不会记录
+ */
+extern uint64_t dtag_trace_enter(void);
+extern void dtag_trace_leave(uint64_t begin, dtag_op_t op, const char *key, uint32_t klen, uint32_t arg, uint32_t aux,
+                             int32_t result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DTAG_TRACE_H__
@@ -1,14 +1,22 @@
 #include "logger.h"
 #include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #define FMT_MAX (1024)
 
+#define SINK_STDERR (1 << 0)
+#define SINK_LOGGER (1 << 1)
+
 static log_level_t g_log_level = LOG_DEBUG;
 
+uint8_t g_logger_threshold = UINT8_MAX;
+
 static void default_logger(const char *msg) { fputs(msg, stdout); }
 
 static logger_f g_logger = default_logger;
@@ -21,32 +29,193 @@ static int32_t check_stderr_level() {
   static int32_t value = -2;
   const char *value_s = NULL;
 
-  if (value == -2) {
+  /* racing threads parse the same env and store the same value */
+  int32_t cached = __atomic_load_n(&value, __ATOMIC_RELAXED);
+  if (cached != -2)
+    return cached;
+
 #ifdef __LOGGER_ENV__
-    value_s = getenv(__LOGGER_ENV__);
+  value_s = getenv(__LOGGER_ENV__);
 #endif /* __LOGGER_ENV__ */
-    if (!value_s || value_s[0] == '\0') {
-      value = -1;
+  if (!value_s || value_s[0] == '\0') {
+    cached = -1;
+  }
+  for (int32_t i = 0; cached == -2 && i < LOG_DEBUG + 1; i++) {
+    if (!strcmp(value_s, log_level_names[i])) {
+      cached = i;
     }
   }
-  if (value != -2)
-    return value;
+  if (cached == -2) {
+    char *endptr = NULL;
+    unsigned long parsed = strtoul(value_s, &endptr, 0);
+    if (value_s == endptr || parsed == ULONG_MAX) {
+      cached = LOG_DEBUG;
+    } else {
+      cached = (parsed > LOG_DEBUG) ? LOG_DEBUG : (int32_t)parsed;
+    }
+  }
+  __atomic_store_n(&value, cached, __ATOMIC_RELAXED);
+  return cached;
+}
 
-  for (int32_t i = 0; i < LOG_DEBUG + 1; i++) {
-    if (!strcmp(value_s, log_level_names[i])) {
-      value = i;
-      return value;
+static void write_sinks(uint8_t sinks, const char *line) {
+  if (sinks & SINK_STDERR)
+    fputs(line, stderr);
+  if (sinks & SINK_LOGGER)
+    __atomic_load_n(&g_logger, __ATOMIC_ACQUIRE)(line);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+/* async mode: bounded MPSC ring (per-cell sequence numbers), one consumer */
+
+typedef struct {
+  uint64_t seq;
+  uint8_t sinks;
+  char line[FMT_MAX];
+} log_cell_t;
+
+static log_cell_t *g_ring = NULL;
+static uint32_t g_ring_mask = 0;
+static uint64_t g_enqueue_pos = 0;
+static uint64_t g_dequeue_pos = 0;
+static uint64_t g_dropped = 0;
+/* ASYNC_OFF -> ASYNC_BUSY -> ASYNC_ON and back, only ASYNC_ON pushes into the ring */
+#define ASYNC_OFF 0
+#define ASYNC_ON 1
+#define ASYNC_BUSY 2
+static int32_t g_async = ASYNC_OFF;
+/* producers between checking `g_async` and leaving `ring_push`, stop waits for them */
+static uint32_t g_producers = 0;
+static int32_t g_stopping = 0;
+static pthread_t g_consumer;
+static pthread_mutex_t g_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake = PTHREAD_COND_INITIALIZER;
+
+/* returns 0 when the ring is full */
+static int32_t ring_push(uint8_t sinks, const char *fmt, va_list args) {
+  uint64_t pos = __atomic_load_n(&g_enqueue_pos, __ATOMIC_RELAXED);
+  log_cell_t *cell = NULL;
+  for (;;) {
+    cell = &g_ring[pos & g_ring_mask];
+    int64_t diff = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&g_enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (diff < 0) {
+      return 0;
+    } else {
+      pos = __atomic_load_n(&g_enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  cell->sinks = sinks;
+  cell->line[FMT_MAX - 1] = '\0';
+  (void)vsnprintf(cell->line, FMT_MAX - 1, fmt, args);
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/* returns 0 when the ring is empty */
+static int32_t ring_pop(void) {
+  uint64_t pos = __atomic_load_n(&g_dequeue_pos, __ATOMIC_RELAXED);
+  log_cell_t *cell = &g_ring[pos & g_ring_mask];
+  if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1)
+    return 0;
+  write_sinks(cell->sinks, cell->line);
+  __atomic_store_n(&cell->seq, pos + g_ring_mask + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&g_dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+static void *consumer(void *arg) {
+  uint64_t reported = 0;
+  for (;;) {
+    while (ring_pop())
+      ;
+    uint64_t dropped = __atomic_load_n(&g_dropped, __ATOMIC_RELAXED);
+    if (dropped != reported) {
+      char line[64];
+      snprintf(line, sizeof(line), "logger: %lu messages dropped\n", (unsigned long)(dropped - reported));
+      int32_t stderr_level = check_stderr_level();
+      write_sinks((stderr_level >= LOG_WARNING ? SINK_STDERR : 0) |
+                      (LOG_WARNING <= __atomic_load_n(&g_log_level, __ATOMIC_RELAXED) ? SINK_LOGGER : 0),
+                  line);
+      reported = dropped;
     }
+    if (__atomic_load_n(&g_stopping, __ATOMIC_ACQUIRE) &&
+        __atomic_load_n(&g_dequeue_pos, __ATOMIC_RELAXED) == __atomic_load_n(&g_enqueue_pos, __ATOMIC_RELAXED))
+      break;
+    /* producers don't take the lock, so a wakeup may be missed: poll as well */
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += 10 * 1000 * 1000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&g_wake_lock);
+    if (__atomic_load_n(&g_dequeue_pos, __ATOMIC_RELAXED) == __atomic_load_n(&g_enqueue_pos, __ATOMIC_RELAXED))
+      pthread_cond_timedwait(&g_wake, &g_wake_lock, &ts);
+    pthread_mutex_unlock(&g_wake_lock);
   }
+  return NULL;
+}
 
-  char *endptr = NULL;
-  unsigned long parsed = strtoul(value_s, &endptr, 0);
-  if (value_s == endptr || parsed == ULONG_MAX) {
-    value = LOG_DEBUG;
-  } else {
-    value = (parsed > LOG_DEBUG) ? LOG_DEBUG : (int32_t)parsed;
+int32_t logger_async_start(uint32_t capacity) {
+  if (capacity < 2 || capacity > (1u << 20) || (capacity & (capacity - 1)))
+    return -1;
+  int32_t expected = ASYNC_OFF;
+  if (!__atomic_compare_exchange_n(&g_async, &expected, ASYNC_BUSY, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return -1;
+  g_ring = (log_cell_t *)malloc(sizeof(log_cell_t) * capacity);
+  if (g_ring) {
+    for (uint32_t i = 0; i < capacity; i++)
+      g_ring[i].seq = i;
+    g_ring_mask = capacity - 1;
+    g_enqueue_pos = g_dequeue_pos = 0;
+    g_stopping = 0;
+    if (pthread_create(&g_consumer, NULL, consumer, NULL)) {
+      free(g_ring);
+      g_ring = NULL;
+    }
   }
-  return value;
+  __atomic_store_n(&g_async, g_ring ? ASYNC_ON : ASYNC_OFF, __ATOMIC_RELEASE);
+  return g_ring ? 0 : -1;
+}
+
+/* loggers racing with stop either finish their push first or write synchronously */
+void logger_async_stop(void) {
+  int32_t expected = ASYNC_ON;
+  if (!__atomic_compare_exchange_n(&g_async, &expected, ASYNC_BUSY, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return;
+  /* pairs with the increment in `logger`: a producer that still saw ASYNC_ON is counted here */
+  while (__atomic_load_n(&g_producers, __ATOMIC_SEQ_CST))
+    sched_yield();
+  __atomic_store_n(&g_stopping, 1, __ATOMIC_RELEASE);
+  pthread_cond_signal(&g_wake);
+  pthread_join(g_consumer, NULL);
+  free(g_ring);
+  g_ring = NULL;
+  __atomic_store_n(&g_async, ASYNC_OFF, __ATOMIC_RELEASE);
+}
+
+void logger_flush(void) {
+  if (__atomic_load_n(&g_async, __ATOMIC_ACQUIRE) != ASYNC_ON)
+    return;
+  uint64_t target = __atomic_load_n(&g_enqueue_pos, __ATOMIC_ACQUIRE);
+  while (__atomic_load_n(&g_dequeue_pos, __ATOMIC_ACQUIRE) < target) {
+    pthread_cond_signal(&g_wake);
+    struct timespec ts = {0, 100 * 1000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+uint64_t logger_dropped(void) { return __atomic_load_n(&g_dropped, __ATOMIC_RELAXED); }
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+static void update_threshold(int32_t stderr_level) {
+  log_level_t log_level = __atomic_load_n(&g_log_level, __ATOMIC_RELAXED);
+  __atomic_store_n(&g_logger_threshold, stderr_level > log_level ? stderr_level : log_level, __ATOMIC_RELAXED);
 }
 
 void logger(log_level_t lvl, const char *fmt, ...) {
@@ -54,33 +223,73 @@ void logger(log_level_t lvl, const char *fmt, ...) {
   va_start(args, fmt);
 
   int32_t stderr_level = check_stderr_level();
+  if (__atomic_load_n(&g_logger_threshold, __ATOMIC_RELAXED) == UINT8_MAX)
+    update_threshold(stderr_level);
+  uint8_t sinks = ((stderr_level >= 0 && lvl <= stderr_level) ? SINK_STDERR : 0) |
+                  (lvl <= __atomic_load_n(&g_log_level, __ATOMIC_RELAXED) ? SINK_LOGGER : 0);
 
-  if ((stderr_level >= 0 && lvl <= stderr_level) || lvl <= g_log_level) {
+  int32_t pushed = 0;
+  if (sinks) {
+    __atomic_fetch_add(&g_producers, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_async, __ATOMIC_SEQ_CST) == ASYNC_ON) {
+      pushed = 1;
+      if (!ring_push(sinks, fmt, args))
+        __atomic_fetch_add(&g_dropped, 1, __ATOMIC_RELAXED);
+      else
+        pthread_cond_signal(&g_wake);
+    }
+    __atomic_fetch_sub(&g_producers, 1, __ATOMIC_RELEASE);
+  }
+  if (sinks && !pushed) {
     char line[FMT_MAX] = {0};
     (void)vsnprintf(line, sizeof(line) - 1, fmt, args);
-
-    if (stderr_level >= 0 && lvl <= stderr_level)
-      fputs(line, stderr);
-    if (lvl <= g_log_level)
-      g_logger(line);
+    write_sinks(sinks, line);
   }
 
   va_end(args);
 }
 
 void set_logger(log_level_t lvl, logger_f f) {
-  g_log_level = (lvl > LOG_DEBUG) ? LOG_DEBUG : lvl;
+  __atomic_store_n(&g_log_level, (lvl > LOG_DEBUG) ? LOG_DEBUG : lvl, __ATOMIC_RELAXED);
   if (f)
-    g_logger = f;
+    __atomic_store_n(&g_logger, f, __ATOMIC_RELEASE);
+  update_threshold(check_stderr_level());
 }
 
 #ifdef __TEST_LOGGER__
 
+static int32_t g_test_done = 0;
+
+static void *producer(void *arg) {
+  while (!__atomic_load_n(&g_test_done, __ATOMIC_ACQUIRE))
+    logger(LOG_INFO, "producer message\n");
+  return arg;
+}
+
 int32_t main(int32_t argc, const char *argv[]) {
   set_logger(LOG_INFO, NULL);
   for (int32_t i = 0; i < LOG_DEBUG + 1; i++) {
     logger(i, "message level %s\n", log_level_names[i]);
   }
+  logger_async_start(4);
+  for (int32_t i = 0; i < 16; i++) {
+    logger(LOG_INFO, "async message %d\n", i);
+  }
+  logger_flush();
+  logger_async_stop();
+  printf("dropped %lu\n", (unsigned long)logger_dropped());
+
+  /* start/stop while other threads keep logging */
+  pthread_t producers[4];
+  for (int32_t i = 0; i < 4; i++)
+    pthread_create(&producers[i], NULL, producer, NULL);
+  for (int32_t i = 0; i < 100; i++) {
+    logger_async_start(64);
+    logger_async_stop();
+  }
+  __atomic_store_n(&g_test_done, 1, __ATOMIC_RELEASE);
+  for (int32_t i = 0; i < 4; i++)
+    pthread_join(producers[i], NULL);
 }
 
 #endif /* __TEST_LOGGER__ */
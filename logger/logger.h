@@ -22,11 +22,45 @@ void logger(log_level_t lvl, const char *fmt, ...)
     __attribute__((format(printf, 2, 3)));
 void set_logger(log_level_t lvl, logger_f f);
 
-#define logfE(fmt, ...) logger(LOG_ERROR, fmt "\n", ##__VA_ARGS__)
-#define logfW(fmt, ...) logger(LOG_WARNING, fmt "\n", ##__VA_ARGS__)
-#define logfI(fmt, ...) logger(LOG_INFO, fmt "\n", ##__VA_ARGS__)
-#define logfV(fmt, ...) logger(LOG_VERBOSE, fmt "\n", ##__VA_ARGS__)
-#define logfD(fmt, ...) logger(LOG_DEBUG, fmt "\n", ##__VA_ARGS__)
+/*
+ * Async mode: `logger()` formats on the caller's thread and pushes the line
+ * into a bounded MPSC ring, a background thread writes it to the sinks.
+ * Lines are dropped (and counted) when the ring is full.
+ * Start/stop may race with threads that are logging: stop waits for in-flight
+ * pushes, lines logged while the mode changes are written synchronously.
+ */
+int32_t logger_async_start(uint32_t capacity);
+void logger_async_stop(void);
+void logger_flush(void);
+uint64_t logger_dropped(void);
+
+/*
+ * Levels above LOGGER_MIN_LEVEL (e.g. -DLOGGER_MIN_LEVEL=LOG_WARNING) are
+ * compiled out. The rest are checked against `g_logger_threshold`, the most
+ * verbose level any sink accepts, before the arguments are evaluated.
+ */
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL LOG_DEBUG
+#endif
+
+/* UINT8_MAX until the first `logger()` call reads the env */
+extern uint8_t g_logger_threshold;
+
+static inline int32_t logger_enabled(log_level_t lvl) {
+  return lvl <= LOGGER_MIN_LEVEL && lvl <= __atomic_load_n(&g_logger_threshold, __ATOMIC_RELAXED);
+}
+
+#define logf_(lvl, fmt, ...)                                                                                           \
+  do {                                                                                                                 \
+    if (logger_enabled(lvl))                                                                                           \
+      logger(lvl, fmt "\n", ##__VA_ARGS__);                                                                            \
+  } while (0)
+
+#define logfE(fmt, ...) logf_(LOG_ERROR, fmt, ##__VA_ARGS__)
+#define logfW(fmt, ...) logf_(LOG_WARNING, fmt, ##__VA_ARGS__)
+#define logfI(fmt, ...) logf_(LOG_INFO, fmt, ##__VA_ARGS__)
+#define logfV(fmt, ...) logf_(LOG_VERBOSE, fmt, ##__VA_ARGS__)
+#define logfD(fmt, ...) logf_(LOG_DEBUG, fmt, ##__VA_ARGS__)
 
 #ifdef __cplusplus
 }
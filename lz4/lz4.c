@@ -0,0 +1,168 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lz4.h"
+#include <string.h>
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#define MINMATCH 4
+/* 最后 5 字节总是字面量，最后一个匹配至少在结尾前 12 字节开始 */
+#define LASTLITERALS 5
+#define MFLIMIT 12
+#define MAX_DISTANCE 65535
+#define HASH_LOG 12
+#define RUN_MASK 15
+
+static inline uint32_t _ld32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t _hash(uint32_t seq) { return (seq * 2654435761u) >> (32 - HASH_LOG); }
+
+/* 长度超过 `RUN_MASK` 的部分，以若干 255 加余数追加 */
+static inline uint8_t *_put_len(uint8_t *op, size_t len) {
+  for (; len >= 255; len -= 255)
+    *op++ = 255;
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+/**
+ * @brief 输出一个 sequence：字面量 + 匹配；`mlen` 为 0 时为最后一个（仅字面量）
+ * @return 空间不足时返回 NULL
+ */
+static uint8_t *_emit(uint8_t *op, const uint8_t *oend, const uint8_t *lit, size_t llen, size_t off, size_t mlen) {
+  size_t need = 1 + llen + llen / 255 + 1 + (mlen ? 2 + (mlen - MINMATCH) / 255 + 1 : 0);
+  if ((size_t)(oend - op) < need)
+    return NULL;
+  uint8_t *token = op++;
+  *token = (llen >= RUN_MASK ? RUN_MASK : llen) << 4;
+  if (llen >= RUN_MASK)
+    op = _put_len(op, llen - RUN_MASK);
+  memcpy(op, lit, llen);
+  op += llen;
+  if (mlen) {
+    *op++ = (uint8_t)off;
+    *op++ = (uint8_t)(off >> 8);
+    mlen -= MINMATCH;
+    *token |= mlen >= RUN_MASK ? RUN_MASK : mlen;
+    if (mlen >= RUN_MASK)
+      op = _put_len(op, mlen - RUN_MASK);
+  }
+  return op;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t slen, uint8_t *dst, size_t dcap) {
+  /* 记录各哈希值最近出现的位置，初始为 0 时由比较排除误匹配 */
+  uint32_t table[1 << HASH_LOG] = {0};
+  const uint8_t *ip = src, *anchor = src, *end = src + slen;
+  uint8_t *op = dst;
+  const uint8_t *oend = dst + dcap;
+
+  if (slen > MFLIMIT) {
+    const uint8_t *mflimit = end - MFLIMIT, *mlimit = end - LASTLITERALS;
+    while (ip < mflimit) {
+      uint32_t seq = _ld32(ip);
+      uint32_t h = _hash(seq);
+      const uint8_t *ref = src + table[h];
+      table[h] = (uint32_t)(ip - src);
+      if (ref >= ip || ip - ref > MAX_DISTANCE || _ld32(ref) != seq) {
+        ip++;
+        continue;
+      }
+      while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+      const uint8_t *mp = ip + MINMATCH, *rp = ref + MINMATCH;
+      while (mp < mlimit && *mp == *rp) {
+        mp++;
+        rp++;
+      }
+      if (!(op = _emit(op, oend, anchor, ip - anchor, ip - ref, mp - ip)))
+        return 0;
+      anchor = ip = mp;
+    }
+  }
+  if (!(op = _emit(op, oend, anchor, end - anchor, 0, 0)))
+    return 0;
+  return op - dst;
+}
+
+/* 读取扩展长度，越界时返回 -1 */
+static inline int _get_len(const uint8_t **ip, const uint8_t *iend, size_t *len) {
+  uint8_t byte;
+  do {
+    if (*ip >= iend)
+      return -1;
+    byte = *(*ip)++;
+    *len += byte;
+  } while (byte == 255);
+  return 0;
+}
+
+int lz4_decompress(const uint8_t *src, size_t slen, uint8_t *dst, size_t dlen) {
+  const uint8_t *ip = src, *iend = src + slen;
+  uint8_t *op = dst, *oend = dst + dlen;
+
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    size_t len = token >> 4;
+    if (len == RUN_MASK && _get_len(&ip, iend, &len))
+      return -1;
+    if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+      return -1;
+    memcpy(op, ip, len);
+    op += len;
+    ip += len;
+    if (ip == iend)
+      break;
+
+    if (iend - ip < 2)
+      return -1;
+    size_t off = ip[0] | (size_t)ip[1] << 8;
+    ip += 2;
+    if (off == 0 || off > (size_t)(op - dst))
+      return -1;
+    len = token & RUN_MASK;
+    if (len == RUN_MASK && _get_len(&ip, iend, &len))
+      return -1;
+    len += MINMATCH;
+    if (len > (size_t)(oend - op))
+      return -1;
+    const uint8_t *match = op - off;
+    if (off >= len) {
+      memcpy(op, match, len);
+      op += len;
+    } else {
+      /* 重叠时逐字节复制，以重复最近的 `off` 字节 */
+      while (len--)
+        *op++ = *match++;
+    }
+  }
+  return op == oend ? 0 : -1;
+}
@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * LZ4 block format (no frame header), see
+ * https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+ */
+
+/**
+ * @brief 压缩 `src`
+ *
+ * @param src
+ * @param slen
+ * @param dst
+ * @param dcap `dst` 的大小
+ * @return * size_t 压缩后的长度；结果超过 `dcap` 时返回 0
+ */
+extern size_t lz4_compress(const uint8_t *src, size_t slen, uint8_t *dst, size_t dcap);
+/**
+ * @brief 解压 `src`，结果须恰好为 `dlen` 字节
+ *
+ * @param src
+ * @param slen
+ * @param dst
+ * @param dlen 原始长度
+ * @return * int 成功返回 0；数据非法或长度不符时返回 -1
+ */
+extern int lz4_decompress(const uint8_t *src, size_t slen, uint8_t *dst, size_t dlen);
+
+#endif /* __LZ4_H__ */
@@ -25,9 +25,17 @@
 // FILE: test_dtag.c
 
 #include "dtag.h"
+#include "dtag_container.h"
+#include "dtag_flush.h"
+#include "dtag_grow.h"
+#include "dtag_heat.h"
+#include "dtag_stats.h"
+#include "dtag_trace.h"
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 void test_dtag_init() {
   uint8_t buffer[1024];
@@ -69,6 +77,55 @@ void test_dtag_import_checksum_error() {
   assert(result == DTAG_ERR_CHECKSUM);
 }
 
+void test_dtag_import_v3() {
+  uint8_t buffer[256], image[256];
+  dblock_t *block = NULL, *imported = NULL;
+  dtag_init(&block, buffer, sizeof(buffer));
+  dtag_set(block, "key", (const uint8_t *)"value", 5);
+  dtag_complete(block);
+
+  // v3 的头部没有 `flags`，`data` 紧随 chksum
+  uint32_t head_v3 = sizeof(dblock_t) - sizeof(uint32_t), capacity = sizeof(image) - head_v3;
+  memcpy(image, block, 8);
+  ((dblock_t *)image)->version = DTAG_VERSION_V3;
+  memcpy(image + 8, &capacity, sizeof(capacity));
+  memcpy(image + 12, &block->length, sizeof(block->length));
+  memcpy(image + 16, block->chksum, CHKSUM_LENGTH);
+  memcpy(image + head_v3, block->data, block->length);
+
+  const char *filename = "test_dtag_v3.dtag";
+  FILE *file = fopen(filename, "wb");
+  assert(file && fwrite(image, 1, sizeof(image), file) == sizeof(image));
+  fclose(file);
+  int32_t result = dtag_import_file(&imported, filename);
+  assert(result == DTAG_OK && imported->version == DTAG_VERSION && imported->flags == 0);
+  assert(imported->capacity == capacity);
+  assert(dtag_get(imported, "key", NULL, NULL) == DTAG_OK);
+  free(imported);
+  const char *filenames[] = {filename};
+  result = dtag_import_files_async(&imported, filenames, 1, NULL, NULL);
+  assert(result == DTAG_OK && imported->capacity == capacity);
+  assert(dtag_get(imported, "key", NULL, NULL) == DTAG_OK);
+  free(imported);
+
+  // 调用者的缓冲区不被升级
+  uint8_t copy[sizeof(image)];
+  memcpy(copy, image, sizeof(image));
+  result = dtag_import(&imported, image, sizeof(image));
+  assert(result == DTAG_ERR_VERSION && memcmp(copy, image, sizeof(image)) == 0);
+
+  // 升级前校验 chksum
+  image[head_v3] ^= 0xFF;
+  file = fopen(filename, "wb");
+  assert(file && fwrite(image, 1, sizeof(image), file) == sizeof(image));
+  fclose(file);
+  result = dtag_import_file(&imported, filename);
+  assert(result == (CHKSUM_LENGTH ? DTAG_ERR_CHECKSUM : DTAG_OK));
+  if (result == DTAG_OK)
+    free(imported);
+  remove(filename);
+}
+
 void test_dtag_get_set_del() {
   uint8_t buffer[1024];
   dblock_t *block = NULL;
@@ -93,11 +150,1368 @@ void test_dtag_get_set_del() {
   assert(result == DTAG_ERR_NOTFOUND);
 }
 
+static int32_t count_item(ditem_t *item, void *arg) {
+  (*(uint32_t *)arg)++;
+  return 0;
+}
+
+void test_dtag_sorted() {
+  uint8_t buffer[1024];
+  dblock_t *block = NULL;
+  int32_t result = dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_SORTED);
+  assert(result == DTAG_OK);
+  assert(block->flags == DTAG_FLAG_SORTED);
+
+  const char *keys[] = {"net.eth1.mtu", "board", "net.eth0.mac", "net.eth0.ip", "serial", "net"};
+  for (uint32_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+    uint8_t value[2] = {i, i};
+    result = dtag_set(block, keys[i], value, i % 3);
+    assert(result == DTAG_OK);
+  }
+  // Replace with a longer value in place
+  uint8_t value[] = {9, 9, 9, 9};
+  result = dtag_set(block, "net.eth0.ip", value, sizeof(value));
+  assert(result == DTAG_OK);
+
+  const char *sorted[] = {"board", "net", "net.eth0.ip", "net.eth0.mac", "net.eth1.mtu", "serial"};
+  uint32_t i = 0;
+  for (ditem_t *curr = NULL;; i++) {
+    result = dtag_next(block, &curr);
+    assert(result == DTAG_OK);
+    if (curr == NULL)
+      break;
+    assert(strcmp((const char *)curr->kv, sorted[i]) == 0);
+  }
+  assert(i == sizeof(sorted) / sizeof(sorted[0]));
+
+  uint8_t value_get[sizeof(value)];
+  uint32_t value_len = sizeof(value_get);
+  result = dtag_get(block, "net.eth0.ip", value_get, &value_len);
+  assert(result == DTAG_OK);
+  assert(value_len == sizeof(value));
+  assert(memcmp(value_get, value, sizeof(value)) == 0);
+  result = dtag_get(block, "net.eth0", NULL, NULL);
+  assert(result == DTAG_ERR_NOTFOUND);
+
+  uint32_t count = 0;
+  result = dtag_scan_prefix(block, "net.eth0.", count_item, &count);
+  assert(result == DTAG_OK);
+  assert(count == 2);
+  count = 0;
+  result = dtag_scan_prefix(block, NULL, count_item, &count);
+  assert(result == DTAG_OK);
+  assert(count == 6);
+
+  result = dtag_del(block, "net");
+  assert(result == DTAG_OK);
+  for (i = 0; i < sizeof(sorted) / sizeof(sorted[0]); i++) {
+    result = dtag_get(block, sorted[i], NULL, NULL);
+    assert(result == (strcmp(sorted[i], "net") ? DTAG_OK : DTAG_ERR_NOTFOUND));
+  }
+
+  dtag_complete(block);
+  dblock_t *imported_block = NULL;
+  result = dtag_import(&imported_block, buffer, sizeof(buffer));
+  assert(result == DTAG_OK);
+  count = 0;
+  result = dtag_scan_prefix(imported_block, "net", count_item, &count);
+  assert(result == DTAG_OK);
+  assert(count == 3);
+}
+
+void test_dtag_bloom() {
+  uint8_t buffer[1024];
+  dblock_t *block = NULL;
+  int32_t result = dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_BLOOM | DTAG_FLAG_SORTED);
+  assert(result == DTAG_OK);
+  assert(block->length == DTAG_BLOOM_SIZE + sizeof(uint32_t));
+  assert(dtag_bloom_fpr(block) == 0);
+
+  char key[16];
+  for (uint32_t i = 0; i < 32; i++) {
+    snprintf(key, sizeof(key), "tag%u", i);
+    result = dtag_set(block, key, (uint8_t *)&i, sizeof(i));
+    assert(result == DTAG_OK);
+  }
+  double fpr = dtag_bloom_fpr(block);
+  assert(fpr > 0 && fpr < 0.01);
+  for (uint32_t i = 0; i < 64; i++) {
+    snprintf(key, sizeof(key), "tag%u", i);
+    result = dtag_get(block, key, NULL, NULL);
+    assert(result == (i < 32 ? DTAG_OK : DTAG_ERR_NOTFOUND));
+  }
+
+  for (uint32_t i = 0; i < 32; i++) {
+    snprintf(key, sizeof(key), "tag%u", i);
+    result = dtag_del(block, key);
+    assert(result == DTAG_OK);
+  }
+  assert(dtag_bloom_fpr(block) == 0);
+  assert(block->length == DTAG_BLOOM_SIZE + sizeof(uint32_t));
+}
+
+void test_dtag_key() {
+  uint8_t buffer[1024];
+  dblock_t *block = NULL;
+  dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_BLOOM);
+
+  dtag_key_t key;
+  int32_t result = dtag_key_prepare_n(&key, "serial.number", 6);
+  assert(result == DTAG_OK);
+  assert(key.len == 6 && key.hash == dtag_key_hash("serial", 6));
+
+  uint8_t value[] = {1, 2, 3, 4};
+  result = dtag_set_k(block, &key, value, sizeof(value));
+  assert(result == DTAG_OK);
+  uint8_t value_get[sizeof(value)];
+  uint32_t value_len = sizeof(value_get);
+  result = dtag_get(block, "serial", value_get, &value_len);
+  assert(result == DTAG_OK);
+  assert(memcmp(value_get, value, sizeof(value)) == 0);
+  result = dtag_get_k(block, &key, NULL, NULL);
+  assert(result == DTAG_OK);
+  result = dtag_del_k(block, &key);
+  assert(result == DTAG_OK);
+  result = dtag_get_inner_k(block, &key, NULL);
+  assert(result == DTAG_ERR_NOTFOUND);
+
+  char long_key[DTAG_MAX_KLEN + 1];
+  memset(long_key, 'k', DTAG_MAX_KLEN);
+  long_key[DTAG_MAX_KLEN] = '\0';
+  result = dtag_key_prepare(&key, long_key);
+  assert(result == DTAG_ERR_INVPARAM);
+  result = dtag_key_prepare_n(&key, "a\0b", 3);
+  assert(result == DTAG_ERR_INVPARAM);
+}
+
+#define BOARD_SCHEMA(X) X(SLOT_SERIAL, "serial") X(SLOT_MAC, "mac") X(SLOT_REV, "rev")
+enum { BOARD_SCHEMA(DTAG_SCHEMA_SLOT) SLOT_COUNT };
+static const char *const board_keys[] = {BOARD_SCHEMA(DTAG_SCHEMA_KEY)};
+
+void test_dtag_schema() {
+  uint32_t flags[] = {0, DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM};
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t buffer[1024];
+    dblock_t *block = NULL;
+    int32_t result = dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_SCHEMA);
+    assert(result == DTAG_ERR_FLAGS);
+    result = dtag_init_schema(&block, buffer, sizeof(buffer), flags[f], SLOT_COUNT);
+    assert(result == DTAG_OK);
+    assert(dtag_get_slot(block, SLOT_SERIAL, NULL) == DTAG_ERR_NOTFOUND);
+    assert(dtag_get_slot(block, SLOT_COUNT, NULL) == DTAG_ERR_INVPARAM);
+
+    dtag_key_t keys[SLOT_COUNT];
+    for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+      dtag_key_prepare(&keys[i], board_keys[i]);
+    }
+    dtag_set(block, "zzz", (const uint8_t *)"0", 1);
+    result = dtag_set_slot(block, SLOT_MAC, &keys[SLOT_MAC], (const uint8_t *)"001122", 6);
+    assert(result == DTAG_OK);
+    result = dtag_set_slot(block, SLOT_SERIAL, &keys[SLOT_SERIAL], (const uint8_t *)"SN01", 4);
+    assert(result == DTAG_OK);
+    dtag_set(block, "aaa", (const uint8_t *)"1", 1);
+
+    // Updates through the key move the item, the slot follows
+    result = dtag_set(block, "mac", (const uint8_t *)"33445566", 8);
+    assert(result == DTAG_OK);
+    result = dtag_del(block, "zzz");
+    assert(result == DTAG_OK);
+
+    ditem_t *item = NULL;
+    result = dtag_get_slot(block, SLOT_MAC, &item);
+    assert(result == DTAG_OK);
+    assert(strcmp((const char *)item->kv, "mac") == 0 && item->vlen == 8);
+    result = dtag_get_slot(block, SLOT_SERIAL, &item);
+    assert(result == DTAG_OK);
+    assert(strcmp((const char *)item->kv, "serial") == 0 && item->vlen == 4);
+    assert(dtag_get(block, "serial", NULL, NULL) == DTAG_OK);
+
+    result = dtag_del(block, "serial");
+    assert(result == DTAG_OK);
+    assert(dtag_get_slot(block, SLOT_SERIAL, NULL) == DTAG_ERR_NOTFOUND);
+    result = dtag_get_slot(block, SLOT_MAC, &item);
+    assert(result == DTAG_OK && strcmp((const char *)item->kv, "mac") == 0);
+
+    dtag_complete(block);
+    dblock_t *imported_block = NULL;
+    result = dtag_import(&imported_block, buffer, sizeof(buffer));
+    assert(result == DTAG_OK);
+    assert(dtag_get_slot(imported_block, SLOT_MAC, NULL) == DTAG_OK);
+  }
+}
+
+static int32_t check_aligned(ditem_t *item, void *arg) {
+  dtag_view_t view;
+  dtag_item_view((const dblock_t *)arg, item, &view);
+  assert((uintptr_t)view.val % DTAG_ALIGN == 0);
+  return 0;
+}
+
+void test_dtag_aligned() {
+  uint32_t flags[] = {DTAG_FLAG_ALIGNED, DTAG_FLAG_ALIGNED | DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM};
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    _Alignas(DTAG_ALIGN) uint8_t buffer[1024];
+    dblock_t *block = NULL;
+    int32_t result = dtag_init_ex(&block, buffer, sizeof(buffer), flags[f] | DTAG_FLAG_VARINT);
+    assert(result == DTAG_ERR_FLAGS);
+    result = dtag_init_schema(&block, buffer, sizeof(buffer), flags[f], SLOT_COUNT);
+    assert(result == DTAG_OK);
+
+    uint64_t counter = 40;
+    uint32_t rev = 3;
+    double temp = 36.5;
+    dtag_set(block, "serial", (const uint8_t *)"SN01", 4);
+    dtag_set(block, "counter", (const uint8_t *)&counter, sizeof(counter));
+    dtag_set(block, "rev", (const uint8_t *)&rev, sizeof(rev));
+    dtag_set(block, "temp", (const uint8_t *)&temp, sizeof(temp));
+    // Moving items around keeps the values aligned
+    dtag_set(block, "serial", (const uint8_t *)"SN0001", 6);
+    dtag_del(block, "rev");
+    dtag_set(block, "rev", (const uint8_t *)&rev, sizeof(rev));
+    dtag_scan_prefix(block, NULL, check_aligned, block);
+
+    uint64_t u64 = 0;
+    result = dtag_add_u64(block, "counter", 2, &u64);
+    assert(result == DTAG_OK && u64 == 42);
+    result = dtag_get_u64(block, "counter", &u64);
+    assert(result == DTAG_OK && u64 == 42);
+    uint32_t u32 = 0;
+    result = dtag_get_u32(block, "rev", &u32);
+    assert(result == DTAG_OK && u32 == rev);
+    double f64 = 0;
+    result = dtag_get_f64(block, "temp", &f64);
+    assert(result == DTAG_OK && f64 == temp);
+    assert(dtag_get_u64(block, "rev", &u64) == DTAG_ERR_LEN);
+    assert(dtag_add_u64(block, "none", 1, NULL) == DTAG_ERR_NOTFOUND);
+
+    dtag_complete(block);
+    dblock_t *imported_block = NULL;
+    result = dtag_import(&imported_block, buffer, sizeof(buffer));
+    assert(result == DTAG_OK);
+    dtag_scan_prefix(imported_block, NULL, check_aligned, imported_block);
+
+    // Unaligned values can be read but not incremented in place
+    _Alignas(DTAG_ALIGN) uint8_t classic[1024];
+    dblock_t *classic_block = NULL;
+    dtag_init(&classic_block, classic, sizeof(classic));
+    result = dtag_convert(classic_block, block);
+    assert(result == DTAG_OK);
+    result = dtag_get_u64(classic_block, "counter", &u64);
+    assert(result == DTAG_OK && u64 == 42);
+    ditem_t *item = NULL;
+    dtag_view_t view;
+    dtag_get_inner(classic_block, "counter", &item);
+    dtag_item_view(classic_block, item, &view);
+    result = dtag_add_u64(classic_block, "counter", 1, NULL);
+    assert(result == ((uintptr_t)view.val % DTAG_ALIGN ? DTAG_ERR_NOTSUPP : DTAG_OK));
+  }
+}
+
+void test_dtag_compress() {
+  uint32_t flags[] = {DTAG_FLAG_COMPRESS, DTAG_FLAG_COMPRESS | DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM | DTAG_FLAG_VARINT};
+  static uint8_t text[4096], noise[1024], zeros[300], value_get[4096];
+  for (uint32_t i = 0, seed = 1; i < sizeof(noise); i++) {
+    seed = seed * 1103515245 + 12345;
+    noise[i] = seed >> 16;
+  }
+  for (uint32_t i = 0; i < sizeof(text); i++) {
+    text[i] = "-----BEGIN CERTIFICATE-----\nMIIB"[i % 32] + i / 1024;
+  }
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t buffer[4096];
+    dblock_t *block = NULL;
+    int32_t result = dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_COMPRESS | DTAG_FLAG_ALIGNED);
+    assert(result == DTAG_ERR_FLAGS);
+    result = dtag_init_ex(&block, buffer, sizeof(buffer), flags[f]);
+    assert(result == DTAG_OK);
+
+    // The raw text would not fit in the block
+    result = dtag_set(block, "cert", text, sizeof(text));
+    assert(result == DTAG_OK);
+    result = dtag_set(block, "noise", noise, sizeof(noise));
+    assert(result == DTAG_OK);
+    result = dtag_set(block, "zeros", zeros, sizeof(zeros));
+    assert(result == DTAG_OK);
+    result = dtag_set(block, "small", (const uint8_t *)"value", 5);
+    assert(result == DTAG_OK);
+    assert(block->length < sizeof(text));
+
+    const char *keys[] = {"cert", "noise", "zeros", "small"};
+    const uint8_t *values[] = {text, noise, zeros, (const uint8_t *)"value"};
+    const uint32_t lens[] = {sizeof(text), sizeof(noise), sizeof(zeros), 5};
+    const uint32_t packed[] = {1, 0, 1, 0};
+    for (uint32_t i = 0; i < 4; i++) {
+      uint32_t value_len = sizeof(value_get);
+      result = dtag_get(block, keys[i], value_get, &value_len);
+      assert(result == DTAG_OK && value_len == lens[i]);
+      assert(memcmp(value_get, values[i], lens[i]) == 0);
+
+      ditem_t *item = NULL;
+      dtag_view_t view;
+      dtag_get_inner(block, keys[i], &item);
+      dtag_item_view(block, item, &view);
+      assert(view.rawlen == lens[i] && (view.vlen < view.rawlen) == packed[i]);
+      if (!packed[i]) {
+        assert(view.val > buffer && view.val < buffer + sizeof(buffer));
+        assert(memcmp(view.val, values[i], lens[i]) == 0);
+      }
+    }
+    uint32_t value_len = sizeof(text) - 1;
+    assert(dtag_get(block, "cert", value_get, &value_len) == DTAG_ERR_NOSPACE);
+
+    dtag_complete(block);
+    dblock_t *imported_block = NULL;
+    result = dtag_import(&imported_block, buffer, sizeof(buffer));
+    assert(result == DTAG_OK);
+
+    // Converting to a plain block restores the raw values
+    static uint8_t plain[8192];
+    dblock_t *plain_block = NULL;
+    dtag_init(&plain_block, plain, sizeof(plain));
+    result = dtag_convert(plain_block, block);
+    assert(result == DTAG_OK);
+    value_len = sizeof(value_get);
+    result = dtag_get(plain_block, "cert", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == sizeof(text));
+    assert(memcmp(value_get, text, sizeof(text)) == 0);
+  }
+}
+
+void test_dtag_dedup() {
+  uint32_t flags[] = {DTAG_FLAG_DEDUP, DTAG_FLAG_DEDUP | DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM | DTAG_FLAG_COMPRESS};
+  static uint8_t cert[512], calib[100], value_get[512];
+  for (uint32_t i = 0; i < sizeof(cert); i++) {
+    cert[i] = i * 7 + i / 13;
+  }
+  memset(calib, 0x5a, sizeof(calib));
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t buffer[2048], fresh[2048];
+    dblock_t *block = NULL, *fresh_block = NULL;
+    int32_t result = dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_DEDUP | DTAG_FLAG_ALIGNED);
+    assert(result == DTAG_ERR_FLAGS);
+    result = dtag_init_schema(&block, buffer, sizeof(buffer), flags[f], SLOT_COUNT);
+    assert(result == DTAG_OK);
+
+    const char *keys[] = {"ca.0", "ca.1", "ca.2"};
+    result = dtag_set(block, keys[0], cert, sizeof(cert));
+    assert(result == DTAG_OK);
+    uint32_t single = block->length;
+    dtag_set(block, "calib", calib, sizeof(calib));
+    dtag_set(block, "small", (const uint8_t *)"value", 5);
+    for (uint32_t i = 1; i < 3; i++) {
+      result = dtag_set(block, keys[i], cert, sizeof(cert));
+      assert(result == DTAG_OK);
+    }
+    // Each copy only costs the item and a reference
+    assert(block->length < single + sizeof(calib) + 3 * 32);
+    dtag_key_t key;
+    dtag_key_prepare(&key, board_keys[SLOT_SERIAL]);
+    result = dtag_set_slot(block, SLOT_SERIAL, &key, calib, sizeof(calib));
+    assert(result == DTAG_OK);
+
+    for (uint32_t i = 0; i < 3; i++) {
+      uint32_t value_len = sizeof(value_get);
+      result = dtag_get(block, keys[i], value_get, &value_len);
+      assert(result == DTAG_OK && value_len == sizeof(cert));
+      assert(memcmp(value_get, cert, sizeof(cert)) == 0);
+    }
+
+    // Dropping every reference removes the shared value and moves the ones after it
+    dtag_del(block, keys[0]);
+    dtag_set(block, keys[1], (const uint8_t *)"none", 4);
+    dtag_set(block, keys[2], cert, sizeof(cert));
+    dtag_del(block, keys[2]);
+    uint32_t value_len = sizeof(value_get);
+    result = dtag_get(block, "calib", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == sizeof(calib));
+    assert(memcmp(value_get, calib, sizeof(calib)) == 0);
+    ditem_t *item = NULL;
+    dtag_view_t view;
+    result = dtag_get_slot(block, SLOT_SERIAL, &item);
+    assert(result == DTAG_OK);
+    dtag_item_view(block, item, &view);
+    assert(view.rawlen == sizeof(calib) && memcmp(view.val, calib, sizeof(calib)) == 0);
+
+    dtag_init_schema(&fresh_block, fresh, sizeof(fresh), flags[f], SLOT_COUNT);
+    dtag_set(fresh_block, "calib", calib, sizeof(calib));
+    dtag_set(fresh_block, "small", (const uint8_t *)"value", 5);
+    dtag_set(fresh_block, keys[1], (const uint8_t *)"none", 4);
+    dtag_set(fresh_block, "serial", calib, sizeof(calib));
+    assert(block->length == fresh_block->length);
+
+    dtag_complete(block);
+    dblock_t *imported_block = NULL;
+    result = dtag_import(&imported_block, buffer, sizeof(buffer));
+    assert(result == DTAG_OK);
+
+    uint8_t plain[2048];
+    dblock_t *plain_block = NULL;
+    dtag_init(&plain_block, plain, sizeof(plain));
+    result = dtag_convert(plain_block, block);
+    assert(result == DTAG_OK);
+    value_len = sizeof(value_get);
+    result = dtag_get(plain_block, "serial", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == sizeof(calib));
+  }
+}
+
+static void files_done(uint32_t index, dblock_t *block, int32_t result, void *arg) {
+  int32_t *results = (int32_t *)arg;
+  assert(results[index] == 1);
+  results[index] = result;
+  assert((result == DTAG_OK) == (block != NULL));
+}
+
+void test_dtag_extent() {
+  uint32_t flags[] = {DTAG_FLAG_EXTENT,
+                      DTAG_FLAG_EXTENT | DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM | DTAG_FLAG_DEDUP | DTAG_FLAG_COMPRESS};
+  const char *filename = "test_dtag_extent.dtag";
+  // Larger than an inline value can be
+  const uint32_t big_len = DTAG_MAX_VLEN + 4097, len = big_len + 65536;
+  uint8_t *big = malloc(big_len), *buffer = malloc(len), *value_get = malloc(big_len);
+  static uint8_t cert[DTAG_EXTENT_MIN];
+  assert(big && buffer && value_get);
+  for (uint32_t i = 0; i < big_len; i++) {
+    big[i] = i * 7 + i / 251;
+  }
+  memcpy(cert, big + 1000, sizeof(cert));
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    dblock_t *block = NULL;
+    int32_t result = dtag_init_ex(&block, buffer, len, DTAG_FLAG_EXTENT | DTAG_FLAG_ALIGNED);
+    assert(result == DTAG_ERR_FLAGS);
+    result = dtag_init_schema(&block, buffer, len, flags[f], SLOT_COUNT);
+    assert(result == DTAG_OK);
+
+    dtag_set(block, "small", (const uint8_t *)"value", 5);
+    dtag_set(block, "calib", cert, 100);
+    result = dtag_set(block, "cert", cert, sizeof(cert));
+    assert(result == DTAG_OK);
+    result = dtag_set(block, "big", big, big_len);
+    assert(result == DTAG_OK);
+    dtag_key_t key;
+    dtag_key_prepare(&key, board_keys[SLOT_SERIAL]);
+    result = dtag_set_slot(block, SLOT_SERIAL, &key, (const uint8_t *)"SN01", 4);
+    assert(result == DTAG_OK);
+    // The item chain does not contain the large values
+    uint32_t offset = 0, length = 0;
+    dtag_items_region(block, &offset, &length);
+    assert(length < 512);
+
+    uint32_t value_len = big_len;
+    result = dtag_get(block, "big", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == big_len && memcmp(value_get, big, big_len) == 0);
+    uint8_t part[64];
+    uint32_t part_len = sizeof(part);
+    result = dtag_get_range(block, "big", DTAG_MAX_VLEN, part, &part_len);
+    assert(result == DTAG_OK && part_len == sizeof(part) && memcmp(part, big + DTAG_MAX_VLEN, sizeof(part)) == 0);
+    part_len = sizeof(part);
+    result = dtag_get_range(block, "big", big_len - 10, part, &part_len);
+    assert(result == DTAG_OK && part_len == 10);
+    part_len = sizeof(part);
+    result = dtag_get_range(block, "small", 1, part, &part_len);
+    assert(result == DTAG_OK && part_len == 4 && memcmp(part, "alue", 4) == 0);
+    result = dtag_get_range(block, "big", big_len + 1, part, &part_len);
+    assert(result == DTAG_ERR_INVPARAM);
+
+    // Dropping the first extent moves the ones after it and the items
+    result = dtag_set(block, "calib", cert, sizeof(cert));
+    assert(result == DTAG_OK);
+    result = dtag_set(block, "cert", (const uint8_t *)"none", 4);
+    assert(result == DTAG_OK);
+    part_len = sizeof(part);
+    result = dtag_get_range(block, "big", 4096, part, &part_len);
+    assert(result == DTAG_OK && memcmp(part, big + 4096, sizeof(part)) == 0);
+    value_len = sizeof(cert);
+    result = dtag_get(block, "calib", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == sizeof(cert) && memcmp(value_get, cert, sizeof(cert)) == 0);
+    ditem_t *item = NULL;
+    dtag_view_t view;
+    result = dtag_get_slot(block, SLOT_SERIAL, &item);
+    assert(result == DTAG_OK);
+    dtag_item_view(block, item, &view);
+    assert(view.rawlen == 4 && memcmp(view.val, "SN01", 4) == 0);
+
+    // Only the requested part of the value is read from the file
+    dtag_complete(block);
+    result = dtag_export_file(block, filename);
+    assert(result == DTAG_OK);
+    part_len = sizeof(part);
+    result = dtag_get_range_file(filename, "big", 12345, part, &part_len);
+    assert(result == DTAG_OK && part_len == sizeof(part) && memcmp(part, big + 12345, sizeof(part)) == 0);
+    part_len = sizeof(part);
+    result = dtag_get_range_file(filename, "cert", 0, part, &part_len);
+    assert(result == DTAG_OK && part_len == 4 && memcmp(part, "none", 4) == 0);
+    result = dtag_get_range_file(filename, "none", 0, part, &part_len);
+    assert(result == DTAG_ERR_NOTFOUND);
+    dblock_t *imported_block = NULL;
+    result = dtag_import_file(&imported_block, filename);
+    assert(result == DTAG_OK);
+    free(imported_block);
+
+    dtag_del(block, "big");
+    dtag_del(block, "calib");
+    assert(block->length < 512);
+    assert(dtag_get(block, "small", NULL, NULL) == DTAG_OK);
+  }
+  dblock_t *plain_block = NULL;
+  dtag_init(&plain_block, buffer, len);
+  assert(dtag_set(plain_block, "big", big, big_len) == DTAG_ERR_INVPARAM);
+  remove(filename);
+  free(big);
+  free(buffer);
+  free(value_get);
+}
+
+void test_dtag_files_async() {
+  enum { FILES = 80 };
+  static uint8_t buffers[FILES][512];
+  dblock_t *blocks[FILES + 2];
+  char names[FILES + 2][32];
+  const char *filenames[FILES + 2];
+  int32_t results[FILES + 2];
+
+  // 超过一次提交的深度
+  for (uint32_t i = 0; i < FILES; i++) {
+    dtag_init_ex(&blocks[i], buffers[i], sizeof(buffers[i]), i % 2 ? DTAG_FLAG_SORTED : 0);
+    dtag_set(blocks[i], "index", (const uint8_t *)&i, sizeof(i));
+    dtag_complete(blocks[i]);
+    snprintf(names[i], sizeof(names[i]), "test_dtag_files.%u", i);
+    filenames[i] = names[i];
+    results[i] = 1;
+  }
+  int32_t result = dtag_export_files_async(blocks, filenames, FILES, files_done, results);
+  assert(result == DTAG_OK);
+  for (uint32_t i = 0; i < FILES; i++)
+    assert(results[i] == DTAG_OK);
+
+  // 缺失的文件与校验失败的文件不影响其余文件
+  snprintf(names[FILES], sizeof(names[FILES]), "test_dtag_files.none");
+  snprintf(names[FILES + 1], sizeof(names[FILES + 1]), "test_dtag_files.bad");
+  filenames[FILES] = names[FILES];
+  filenames[FILES + 1] = names[FILES + 1];
+  buffers[0][sizeof(dblock_t)] ^= 0xff;
+  dtag_export_file(blocks[0], filenames[FILES + 1]);
+  for (uint32_t i = 0; i < FILES + 2; i++)
+    results[i] = 1;
+  dblock_t *imported[FILES + 2];
+  result = dtag_import_files_async(imported, filenames, FILES + 2, files_done, results);
+  assert(result == DTAG_ERR_FILEIO);
+  assert(results[FILES] == DTAG_ERR_FILEIO && imported[FILES] == NULL);
+  assert(results[FILES + 1] == DTAG_ERR_CHECKSUM && imported[FILES + 1] == NULL);
+  for (uint32_t i = 0; i < FILES; i++) {
+    assert(results[i] == DTAG_OK);
+    uint32_t value = 0, value_len = sizeof(value);
+    result = dtag_get(imported[i], "index", (uint8_t *)&value, &value_len);
+    assert(result == DTAG_OK && value == i);
+    assert(imported[i]->flags == blocks[i]->flags);
+    free(imported[i]);
+  }
+  for (uint32_t i = 0; i < FILES + 2; i++)
+    remove(filenames[i]);
+}
+
+void test_dtag_flush() {
+  const char *filename = "test_dtag_flush.bin";
+  uint8_t buffer[1024];
+  dblock_t *block = NULL, *imported_block = NULL;
+  dflush_t *flush = NULL;
+  int32_t result = dtag_flush_open(&flush, filename);
+  assert(result == DTAG_OK);
+  assert(dtag_flush_wait(flush) == DTAG_OK);
+
+  dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_SORTED);
+  // 后台写入期间继续修改，连续的快照被合并
+  for (uint32_t i = 0; i < 200; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "key.%u", i % 20);
+    dtag_set(block, key, (const uint8_t *)&i, sizeof(i));
+    result = dtag_flush(flush, block);
+    assert(result == DTAG_OK);
+  }
+  result = dtag_flush_wait(flush);
+  assert(result == DTAG_OK);
+  result = dtag_import_file(&imported_block, filename);
+  assert(result == DTAG_OK);
+  assert(imported_block->length == block->length);
+  assert(memcmp(imported_block->data, block->data, block->length) == 0);
+  free(imported_block);
+
+  // 缩短后的快照不残留旧数据
+  for (uint32_t i = 1; i < 20; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "key.%u", i);
+    dtag_del(block, key);
+  }
+  dtag_flush(flush, block);
+  dtag_flush_close(flush);
+  result = dtag_import_file(&imported_block, filename);
+  assert(result == DTAG_OK);
+  assert(imported_block->length == block->length);
+  for (uint32_t i = imported_block->length; i < imported_block->capacity; i++)
+    assert(imported_block->data[i] == 0);
+  uint32_t value = 0, value_len = sizeof(value);
+  result = dtag_get(imported_block, "key.0", (uint8_t *)&value, &value_len);
+  assert(result == DTAG_OK && value == 180);
+  free(imported_block);
+  remove(filename);
+}
+
+void test_dtag_patch() {
+  uint32_t flags[] = {0, DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM, DTAG_FLAG_COMPRESS | DTAG_FLAG_DEDUP | DTAG_FLAG_VARINT};
+  static uint8_t blob[300];
+  memset(blob, 'x', sizeof(blob));
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t from_buf[2048], to_buf[2048], base_buf[2048];
+    dblock_t *from = NULL, *to = NULL, *base = NULL;
+    int32_t result = dtag_init_schema(&from, from_buf, sizeof(from_buf), flags[f], SLOT_COUNT);
+    assert(result == DTAG_OK);
+    for (uint32_t i = 0; i < 20; i++) {
+      char key[16];
+      snprintf(key, sizeof(key), "key.%u", i);
+      dtag_set(from, key, (const uint8_t *)&i, sizeof(i));
+    }
+    dtag_set(from, "blob", blob, sizeof(blob));
+    dtag_complete(from);
+    memcpy(to_buf, from_buf, sizeof(from_buf));
+    memcpy(base_buf, from_buf, sizeof(from_buf));
+    dtag_import(&to, to_buf, sizeof(to_buf));
+    dtag_import(&base, base_buf, sizeof(base_buf));
+
+    // 修改、新增、删除各一个，并绑定一个槽位；重写相同的 value 不产生操作
+    uint32_t value = 100;
+    dtag_set(to, "key.3", (const uint8_t *)&value, sizeof(value));
+    dtag_set(to, "key.new", (const uint8_t *)&value, sizeof(value));
+    dtag_del(to, "key.7");
+    value = 5;
+    dtag_set(to, "key.5", (const uint8_t *)&value, sizeof(value));
+    blob[0] = 'y';
+    dtag_set(to, "blob", blob, sizeof(blob));
+    blob[0] = 'x';
+    dtag_key_t key;
+    dtag_key_prepare(&key, board_keys[SLOT_SERIAL]);
+    dtag_set_slot(to, SLOT_SERIAL, &key, (const uint8_t *)"SN1", 3);
+
+    uint8_t *patch = NULL;
+    uint32_t len = 0;
+    result = dtag_diff(from, to, &patch, &len);
+    assert(result == DTAG_OK);
+    assert(((dpatch_head_t *)patch)->count == 6);
+    assert(len < sizeof(blob) + 200);
+
+    result = dtag_patch_apply(base, patch, len);
+    assert(result == DTAG_OK);
+    for (ditem_t *curr = NULL; dtag_next(to, &curr) == DTAG_OK && curr;) {
+      dtag_view_t view;
+      uint8_t expected[sizeof(blob)], actual[sizeof(blob)];
+      uint32_t expected_len = sizeof(expected), actual_len = sizeof(actual);
+      dtag_item_view(to, curr, &view);
+      char name[32];
+      snprintf(name, sizeof(name), "%.*s", view.klen, view.key);
+      dtag_item_value(to, curr, expected, &expected_len);
+      result = dtag_get(base, name, actual, &actual_len);
+      assert(result == DTAG_OK && actual_len == expected_len);
+      assert(memcmp(actual, expected, actual_len) == 0);
+    }
+    assert(dtag_get_inner(base, "key.7", &(ditem_t *){NULL}) == DTAG_ERR_NOTFOUND);
+    ditem_t *item = NULL;
+    result = dtag_get_slot(base, SLOT_SERIAL, &item);
+    assert(result == DTAG_OK);
+
+    // 基准不一致、patch 损坏
+    result = dtag_patch_apply(base, patch, len);
+    assert(result == DTAG_ERR_CHECKSUM);
+    result = dtag_patch_apply(from, patch, len - 1);
+    assert(result == DTAG_ERR_DATA);
+
+    // 中途失败时不修改 `dblock`
+    dpatch_head_t *head = (dpatch_head_t *)patch;
+    uint8_t *op = patch + sizeof(dpatch_head_t);
+    head->count = 2;
+    op[0] = DTAG_PATCH_SET, op[1] = 1, op[2] = 1, op[3] = op[4] = op[5] = 0, op[6] = 'a', op[7] = 1;
+    op += 8;
+    op[0] = DTAG_PATCH_DEL, op[1] = 2, op[2] = op[3] = op[4] = op[5] = 0, op[6] = 'z', op[7] = 'z';
+    memcpy(to_buf, from_buf, sizeof(from_buf));
+    result = dtag_patch_apply(from, patch, op + 8 - patch);
+    assert(result == DTAG_ERR_NOTFOUND);
+    assert(memcmp(to_buf, from_buf, sizeof(from_buf)) == 0);
+    free(patch);
+  }
+
+  // 改名后仍恰好装满时，先删除再写入才能应用
+  uint8_t value[100] = {0}, full_from[212 + sizeof(dblock_t)], full_to[212 + sizeof(dblock_t)];
+  dblock_t *from = NULL, *to = NULL;
+  dtag_init(&from, full_from, sizeof(full_from));
+  dtag_init(&to, full_to, sizeof(full_to));
+  dtag_set(from, "a", value, sizeof(value));
+  dtag_set(to, "a", value, sizeof(value));
+  int32_t result = dtag_set(from, "b", value, sizeof(value));
+  assert(result == DTAG_OK && from->length == from->capacity);
+  result = dtag_set(to, "c", value, sizeof(value));
+  assert(result == DTAG_OK && to->length == to->capacity);
+  dtag_complete(from);
+  dtag_complete(to);
+  uint8_t *patch = NULL;
+  uint32_t len = 0;
+  result = dtag_diff(from, to, &patch, &len);
+  assert(result == DTAG_OK);
+  result = dtag_patch_apply(from, patch, len);
+  assert(result == DTAG_OK);
+  assert(dtag_get(from, "b", NULL, NULL) == DTAG_ERR_NOTFOUND && dtag_get(from, "c", NULL, NULL) == DTAG_OK);
+  free(patch);
+
+  // extent 中超过 `DTAG_MAX_VLEN` 的 value
+  uint32_t big_len = DTAG_MAX_VLEN + 1, size = big_len + 4096 + sizeof(dblock_t);
+  uint8_t *big = (uint8_t *)calloc(1, big_len), *ext_from = (uint8_t *)malloc(size), *ext_to = (uint8_t *)malloc(size);
+  assert(big && ext_from && ext_to);
+  dtag_init_ex(&from, ext_from, size, DTAG_FLAG_EXTENT);
+  dtag_complete(from);
+  dtag_init_ex(&to, ext_to, size, DTAG_FLAG_EXTENT);
+  big[big_len - 1] = 0x5A;
+  result = dtag_set(to, "big", big, big_len);
+  assert(result == DTAG_OK);
+  result = dtag_diff(from, to, &patch, &len);
+  assert(result == DTAG_OK && len > big_len);
+  result = dtag_patch_apply(from, patch, len);
+  assert(result == DTAG_OK);
+  uint8_t tail = 0;
+  uint32_t tail_len = 1;
+  result = dtag_get_range(from, "big", big_len - 1, &tail, &tail_len);
+  assert(result == DTAG_OK && tail_len == 1 && tail == 0x5A);
+  free(patch);
+
+  // 过长或含 '\0' 的 key 视为损坏
+  uint8_t bad[sizeof(dpatch_head_t) + 6 + DTAG_MAX_KLEN] = {0};
+  dpatch_head_t *head = (dpatch_head_t *)bad;
+  uint8_t *op = bad + sizeof(dpatch_head_t);
+  head->magic = DTAG_PATCH_MAGIC;
+  head->version = DTAG_PATCH_VERSION;
+  head->count = 1;
+  memcpy(head->base, from->chksum, CHKSUM_LENGTH);
+  op[0] = DTAG_PATCH_SET, op[1] = DTAG_MAX_KLEN;
+  memset(op + 6, 'k', DTAG_MAX_KLEN);
+  result = dtag_patch_apply(from, bad, sizeof(bad));
+  assert(result == DTAG_ERR_DATA);
+  op[1] = 2, op[7] = '\0';
+  result = dtag_patch_apply(from, bad, op + 8 - bad);
+  assert(result == DTAG_ERR_DATA);
+  assert(dtag_verify(from) == DTAG_OK);
+  free(ext_to);
+  free(ext_from);
+  free(big);
+}
+
+static int32_t count_entity(const dcontainer_entry_t *entry, void *arg) {
+  (*(uint32_t *)arg)++;
+  return 0;
+}
+
+void test_dtag_container() {
+  const char *filename = "test_dtag_container.dtc";
+  dcontainer_t *container = NULL;
+  remove(filename);
+  // 只读路径不创建文件
+  int32_t result = dtag_container_open(&container, filename, 0, 0);
+  assert(result == DTAG_ERR_FILEIO && fopen(filename, "rb") == NULL);
+  // 初始目录很小，插入时需要迁移
+  result = dtag_container_open(&container, filename, DTAG_CONTAINER_CREATE, 4);
+  assert(result == DTAG_OK);
+
+  for (uint32_t i = 0; i < 50; i++) {
+    uint8_t buffer[512];
+    dblock_t *block = NULL;
+    char id[16];
+    snprintf(id, sizeof(id), "dev.%u", i);
+    dtag_init_ex(&block, buffer, 128 + i * 4, i % 2 ? DTAG_FLAG_ALIGNED : 0);
+    dtag_set(block, "id", (const uint8_t *)&i, sizeof(i));
+    dtag_complete(block);
+    result = dtag_container_put(container, id, block);
+    assert(result == DTAG_OK);
+  }
+  result = dtag_container_put(container, "0123456789abcdef0123456789abcdef", NULL);
+  assert(result == DTAG_ERR_INVPARAM);
+
+  // 删除后释放的空间被新的 block 重新使用
+  struct stat st, st_after;
+  stat(filename, &st);
+  for (uint32_t i = 0; i < 50; i += 2) {
+    char id[16];
+    snprintf(id, sizeof(id), "dev.%u", i);
+    result = dtag_container_del(container, id);
+    assert(result == DTAG_OK);
+  }
+  result = dtag_container_del(container, "dev.0");
+  assert(result == DTAG_ERR_NOTFOUND);
+  for (uint32_t i = 0; i < 50; i += 2) {
+    uint8_t buffer[512];
+    dblock_t *block = NULL;
+    char id[16];
+    snprintf(id, sizeof(id), "new.%u", i);
+    dtag_init_ex(&block, buffer, 128, 0);
+    dtag_complete(block);
+    result = dtag_container_put(container, id, block);
+    assert(result == DTAG_OK);
+  }
+  stat(filename, &st_after);
+  assert(st_after.st_size == st.st_size);
+  uint32_t count = 0;
+  dtag_container_foreach(container, count_entity, &count);
+  assert(count == 50);
+
+  // 原位修改映射中的 block，关闭后重新打开
+  dblock_t *block = NULL;
+  result = dtag_container_get(container, "dev.7", &block);
+  assert(result == DTAG_OK);
+  assert(((uintptr_t)block->data % DTAG_ALIGN) == sizeof(dblock_t) % DTAG_ALIGN);
+  dtag_set(block, "mac", (const uint8_t *)"\x02\x00\x00\x00\x00\x07", 6);
+  dtag_complete(block);
+  result = dtag_container_sync(container);
+  assert(result == DTAG_OK);
+  dtag_container_close(container);
+
+  result = dtag_container_open(&container, filename, 0, 0);
+  assert(result == DTAG_OK);
+  for (uint32_t i = 1; i < 50; i += 2) {
+    char id[16];
+    uint32_t value = 0, value_len = sizeof(value);
+    snprintf(id, sizeof(id), "dev.%u", i);
+    result = dtag_container_get(container, id, &block);
+    assert(result == DTAG_OK);
+    result = dtag_get(block, "id", (uint8_t *)&value, &value_len);
+    assert(result == DTAG_OK && value == i);
+  }
+  result = dtag_container_get(container, "dev.7", &block);
+  assert(result == DTAG_OK && dtag_get_inner(block, "mac", &(ditem_t *){NULL}) == DTAG_OK);
+  result = dtag_container_get(container, "dev.0", &block);
+  assert(result == DTAG_ERR_NOTFOUND);
+
+  // 复制映射中的实体，分配时文件扩大并重新映射
+  uint8_t *big = (uint8_t *)calloc(1, 200 * 1024);
+  assert(big);
+  dtag_init(&block, big, 200 * 1024);
+  dtag_set(block, "id", (const uint8_t *)"big", 3);
+  dtag_complete(block);
+  result = dtag_container_put(container, "a", block);
+  assert(result == DTAG_OK);
+  free(big);
+  result = dtag_container_get(container, "a", &block);
+  assert(result == DTAG_OK);
+  result = dtag_container_put(container, "b", block);
+  assert(result == DTAG_OK);
+  result = dtag_container_get(container, "b", &block);
+  assert(result == DTAG_OK && block->capacity == 200 * 1024 - sizeof(dblock_t));
+  uint8_t value[4];
+  uint32_t value_len = sizeof(value);
+  result = dtag_get(block, "id", value, &value_len);
+  assert(result == DTAG_OK && value_len == 3 && memcmp(value, "big", 3) == 0);
+  dtag_container_close(container);
+  remove(filename);
+}
+
+static void count_grow(dblock_t *block, uint32_t old_capacity, void *arg) {
+  assert(block->capacity != old_capacity);
+  (*(uint32_t *)arg)++;
+}
+
+void test_dtag_grow() {
+  dgrow_t *grow = NULL;
+  uint32_t grows = 0;
+  int32_t result = dtag_grow_new(&grow, 32, DTAG_FLAG_SORTED, 0);
+  assert(result == DTAG_OK);
+  dtag_grow_notify(grow, count_grow, &grows);
+
+  // 按两倍扩容，次数为对数级
+  for (uint32_t i = 0; i < 200; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%u", i);
+    result = dtag_grow_set(grow, key, (const uint8_t *)&i, sizeof(i));
+    assert(result == DTAG_OK);
+  }
+  dblock_t *block = dtag_grow_block(grow);
+  assert(grows > 0 && grows < 12);
+  assert(block->capacity >= block->length && block->capacity < 2 * block->length);
+  for (uint32_t i = 0; i < 200; i++) {
+    char key[16];
+    uint32_t value = 0, value_len = sizeof(value);
+    snprintf(key, sizeof(key), "key%u", i);
+    result = dtag_get(block, key, (uint8_t *)&value, &value_len);
+    assert(result == DTAG_OK && value == i);
+  }
+  result = dtag_shrink_to_fit(grow);
+  block = dtag_grow_block(grow);
+  assert(result == DTAG_OK && block->capacity == block->length);
+  result = dtag_set(block, "more", NULL, 0);
+  assert(result == DTAG_ERR_CAPACITY);
+  result = dtag_grow_set(grow, "more", NULL, 0);
+  assert(result == DTAG_OK);
+  block = dtag_grow_block(grow);
+  dtag_complete(block);
+
+  // 文件映射的 block 扩大文件后重新映射
+  const char *filename = "test_dtag_grow.dtag";
+  result = dtag_export_file(block, filename);
+  assert(result == DTAG_OK);
+  dtag_grow_close(grow);
+  result = dtag_grow_map(&grow, filename);
+  assert(result == DTAG_OK);
+  uint8_t value[300];
+  memset(value, 0x5a, sizeof(value));
+  for (uint32_t i = 0; i < 20; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "blob%u", i);
+    result = dtag_grow_set(grow, key, value, sizeof(value));
+    assert(result == DTAG_OK);
+  }
+  dtag_complete(dtag_grow_block(grow));
+  uint32_t capacity = dtag_grow_block(grow)->capacity;
+  dtag_grow_close(grow);
+  struct stat st;
+  stat(filename, &st);
+  assert(st.st_size == sizeof(dblock_t) + capacity);
+
+  result = dtag_grow_map(&grow, filename);
+  assert(result == DTAG_OK);
+  result = dtag_shrink_to_fit(grow);
+  assert(result == DTAG_OK);
+  dtag_grow_close(grow);
+  block = NULL;
+  result = dtag_import_file(&block, filename);
+  assert(result == DTAG_OK && block->capacity == block->length);
+  assert(dtag_get(block, "key199", NULL, NULL) == DTAG_OK && dtag_get(block, "blob19", NULL, NULL) == DTAG_OK);
+  free(block);
+  remove(filename);
+}
+
+void test_dtag_heat() {
+  uint32_t flags[] = {DTAG_FLAG_BLOOM, DTAG_FLAG_DEDUP, DTAG_FLAG_SORTED};
+  dheat_t *heat = NULL;
+  int32_t result = dtag_heat_new(&heat, 1);
+  assert(result == DTAG_OK);
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t buffer[4096], before[4096];
+    dblock_t *block = NULL;
+    dtag_init_schema(&block, buffer, sizeof(buffer), flags[f], SLOT_COUNT);
+    for (uint32_t i = 0; i < 50; i++) {
+      char key[16];
+      snprintf(key, sizeof(key), "key%u", i);
+      dtag_set(block, key, (const uint8_t *)&i, sizeof(i));
+    }
+    dtag_key_t key;
+    dtag_key_prepare(&key, board_keys[SLOT_SERIAL]);
+    dtag_set_slot(block, SLOT_SERIAL, &key, (const uint8_t *)"SN01", 4);
+
+    // Only lookups on the bound thread are counted
+    dtag_heat_reset(heat);
+    dtag_get(block, "key3", NULL, NULL);
+    assert(dtag_heat_count(heat, "key3", 4) == 0);
+    assert(dtag_heat_bind(heat) == NULL);
+    for (uint32_t i = 0; i < 30; i++) {
+      dtag_get(block, "key42", NULL, NULL);
+      if (i % 2)
+        dtag_get(block, "key17", NULL, NULL);
+    }
+    // A public call is sampled once, internal lookups such as convert are not
+    uint32_t value42 = 42;
+    dtag_set(block, "key42", (const uint8_t *)&value42, sizeof(value42));
+    uint8_t other[4096];
+    dblock_t *copy = NULL;
+    dtag_init(&copy, other, sizeof(other));
+    result = dtag_convert(copy, block);
+    assert(result == DTAG_OK);
+    assert(dtag_heat_bind(NULL) == heat);
+    assert(dtag_heat_count(heat, "key42", 5) == 31 && dtag_heat_count(heat, "key17", 5) == 15);
+
+    memcpy(before, buffer, sizeof(buffer));
+    result = dtag_optimize(block, heat);
+    assert(result == DTAG_OK);
+    ditem_t *item = NULL;
+    dtag_view_t view;
+    dtag_next(block, &item);
+    dtag_item_view(block, item, &view);
+    if (flags[f] & DTAG_FLAG_SORTED) {
+      assert(memcmp(before, buffer, sizeof(dblock_t) + block->length) == 0);
+    } else {
+      // The hottest items come first, the others keep their order
+      assert(view.klen == 5 && memcmp(view.key, "key42", 5) == 0);
+      dtag_next(block, &item);
+      dtag_item_view(block, item, &view);
+      assert(view.klen == 5 && memcmp(view.key, "key17", 5) == 0);
+      dtag_next(block, &item);
+      dtag_item_view(block, item, &view);
+      assert(view.klen == 4 && memcmp(view.key, "key0", 4) == 0);
+    }
+    assert(block->length == ((dblock_t *)before)->length);
+    for (uint32_t i = 0; i < 50; i++) {
+      char key[16];
+      uint32_t value = 0, value_len = sizeof(value);
+      snprintf(key, sizeof(key), "key%u", i);
+      result = dtag_get(block, key, (uint8_t *)&value, &value_len);
+      assert(result == DTAG_OK && value == i);
+    }
+    result = dtag_get_slot(block, SLOT_SERIAL, &item);
+    assert(result == DTAG_OK);
+    dtag_item_view(block, item, &view);
+    assert(view.rawlen == 4 && memcmp(view.val, "SN01", 4) == 0);
+  }
+  dtag_heat_free(heat);
+}
+
+void test_dtag_verify() {
+  uint8_t buffer[4096], copy[4096];
+  dblock_t *block = NULL, *imported = NULL;
+  dtag_init_schema(&block, buffer, sizeof(buffer), DTAG_FLAG_SORTED, SLOT_COUNT);
+  for (uint32_t i = 0; i < 20; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%02u", i);
+    dtag_set(block, key, (const uint8_t *)&i, sizeof(i));
+  }
+  dtag_key_t key;
+  dtag_key_prepare(&key, board_keys[SLOT_SERIAL]);
+  dtag_set_slot(block, SLOT_SERIAL, &key, (const uint8_t *)"SN01", 4);
+  dtag_complete(block);
+
+  int32_t result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_FULL | DTAG_VERIFY_STRUCTURE);
+  assert(result == DTAG_OK && imported == block);
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), 0x4);
+  assert(result == DTAG_ERR_INVPARAM);
+
+  // The offset table follows the chain
+  uint32_t offsets[21], count = 4;
+  result = dtag_verify_items(block, offsets, &count);
+  assert(result == DTAG_ERR_NOSPACE && count == 21);
+  count = sizeof(offsets) / sizeof(offsets[0]);
+  result = dtag_verify_items(block, offsets, &count);
+  assert(result == DTAG_OK && count == 21);
+  for (uint32_t i = 1; i < count; i++)
+    assert(offsets[i - 1] < offsets[i]);
+  ditem_t *item = NULL;
+  dtag_next(block, &item);
+  assert((uint8_t *)item == block->data + offsets[0]);
+
+  // Deferred import skips the checksum until it is asked for
+  block->chksum[0] ^= 0xFF;
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_FULL);
+  assert(result == DTAG_ERR_CHECKSUM);
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_DEFERRED);
+  assert(result == DTAG_OK);
+  assert(dtag_verify(block) == DTAG_ERR_CHECKSUM);
+  dverify_t *verify = NULL;
+  result = dtag_verify_start(&verify, block);
+  assert(result == DTAG_OK);
+  assert(dtag_verify_wait(verify) == DTAG_ERR_CHECKSUM);
+  block->chksum[0] ^= 0xFF;
+  result = dtag_verify_start(&verify, block);
+  assert(result == DTAG_OK);
+  assert(dtag_verify_wait(verify) == DTAG_OK);
+
+  // A slot pointing into an item is only caught by the structure check
+  memcpy(copy, buffer, sizeof(buffer));
+  dtag_get_slot(block, SLOT_SERIAL, &item);
+  uint32_t offset = (uint8_t *)item - block->data + 1;
+  memcpy(block->data + sizeof(uint32_t) * (SLOT_SERIAL + 1), &offset, sizeof(offset));
+  dtag_complete(block);
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_FULL);
+  assert(result == DTAG_OK);
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_STRUCTURE);
+  assert(result == DTAG_ERR_DATA);
+
+  // So is an offset table out of order
+  memcpy(buffer, copy, sizeof(buffer));
+  uint8_t *table = block->data + block->length - sizeof(uint32_t) * 21;
+  uint32_t first, second;
+  memcpy(&first, table, sizeof(first));
+  memcpy(&second, table + sizeof(uint32_t), sizeof(second));
+  memcpy(table, &second, sizeof(second));
+  memcpy(table + sizeof(uint32_t), &first, sizeof(first));
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_STRUCTURE);
+  assert(result == DTAG_ERR_DATA);
+
+  // The tree hash covers every chunk, hashed in parallel
+  uint32_t len = 9 * DTAG_TREE_CHUNK + sizeof(dblock_t);
+  uint8_t *big = (uint8_t *)malloc(len);
+  uint8_t *value = (uint8_t *)calloc(1, 1 << 16);
+  assert(big && value);
+  result = dtag_init_ex(&block, big, len, DTAG_FLAG_TREEHASH);
+  assert(result == DTAG_OK);
+  for (uint32_t i = 0; result == DTAG_OK; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "value%u", i);
+    memcpy(value, &i, sizeof(i));
+    result = dtag_set(block, key, value, 1 << 16);
+  }
+  assert(block->length > 8 * DTAG_TREE_CHUNK);
+  dtag_complete(block);
+  uint32_t chunks = (block->length + DTAG_TREE_CHUNK - 1) / DTAG_TREE_CHUNK;
+  uint8_t digests[16][CHKSUM_LENGTH], root[CHKSUM_LENGTH];
+  for (uint32_t i = 0; i < chunks; i++) {
+    uint32_t rest = block->length - i * DTAG_TREE_CHUNK;
+    chksum_compute(block->data + i * DTAG_TREE_CHUNK, rest < DTAG_TREE_CHUNK ? rest : DTAG_TREE_CHUNK, digests[i]);
+  }
+  chksum_compute(digests[0], chunks * CHKSUM_LENGTH, root);
+  assert(memcmp(root, block->chksum, CHKSUM_LENGTH) == 0);
+  result = dtag_import_ex(&imported, big, len, DTAG_VERIFY_FULL | DTAG_VERIFY_STRUCTURE);
+  assert(result == DTAG_OK);
+  block->data[block->length - 1] ^= 0xFF;
+  assert(dtag_verify(block) == DTAG_ERR_CHECKSUM);
+  free(value);
+  free(big);
+}
+
+void test_dtag_sub() {
+  uint8_t buffer[8192];
+  dblock_t *block = NULL, *radio = NULL, *cal = NULL, *band = NULL, *sub = NULL;
+  dtag_init_ex(&block, buffer, sizeof(buffer), DTAG_FLAG_BLOOM | DTAG_FLAG_SORTED);
+  dtag_set(block, "serial", (const uint8_t *)"SN01", 4);
+  int32_t result = dtag_set_sub(block, "radio", 2048, 0, &radio);
+  assert(result == DTAG_OK && radio->capacity == 2048);
+  result = dtag_set_sub(radio, "cal", 1024, DTAG_FLAG_VARINT, &cal);
+  assert(result == DTAG_OK);
+  result = dtag_set_sub(cal, "band3", 512, DTAG_FLAG_SORTED, &band);
+  assert(result == DTAG_OK);
+  result = dtag_set(band, "gain", (const uint8_t *)"12", 2);
+  assert(result == DTAG_OK);
+
+  // Sub-blocks are modified in place, the outer checksum covers them
+  dtag_complete(block);
+  dblock_t *imported = NULL;
+  result = dtag_import_ex(&imported, buffer, sizeof(buffer), DTAG_VERIFY_FULL | DTAG_VERIFY_STRUCTURE);
+  assert(result == DTAG_OK);
+  result = dtag_get_sub(block, "radio", &sub);
+  assert(result == DTAG_OK && sub == radio);
+
+  uint8_t value[16];
+  uint32_t value_len = sizeof(value);
+  result = dtag_get_path(block, "radio/cal/band3/gain", value, &value_len);
+  assert(result == DTAG_OK && value_len == 2 && memcmp(value, "12", 2) == 0);
+  value_len = sizeof(value);
+  result = dtag_get_path(block, "serial", value, &value_len);
+  assert(result == DTAG_OK && value_len == 4);
+  assert(dtag_get_path(block, "radio/cal/band4/gain", NULL, NULL) == DTAG_ERR_NOTFOUND);
+  assert(dtag_get_path(block, "serial/gain", NULL, NULL) == DTAG_ERR_LEN);
+  assert(dtag_get_sub(block, "serial", &sub) == DTAG_ERR_LEN);
+
+  // The path as a whole is not bound by `DTAG_MAX_KLEN`
+  char path[400], name[200];
+  memset(name, 'n', sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+  result = dtag_set_sub(band, name, 128, 0, &sub);
+  assert(result == DTAG_OK);
+  dtag_set(sub, "x", (const uint8_t *)"1", 1);
+  snprintf(path, sizeof(path), "radio/cal/band3/%s/x", name);
+  assert(dtag_get_path(block, path, NULL, NULL) == DTAG_OK);
+
+  // Stored plain even where values are compressed and shared
+  uint32_t flags[] = {DTAG_FLAG_COMPRESS | DTAG_FLAG_DEDUP, DTAG_FLAG_EXTENT};
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t outer[32768];
+    dtag_init_ex(&block, outer, sizeof(outer), flags[f]);
+    result = dtag_set_sub(block, "a", DTAG_EXTENT_MIN, 0, &sub);
+    assert(result == DTAG_OK);
+    dtag_set(sub, "k", (const uint8_t *)"v", 1);
+    result = dtag_set_sub(block, "b", DTAG_EXTENT_MIN, 0, &sub);
+    assert(result == DTAG_OK);
+    result = dtag_get_path(block, "a/k", value, &value_len);
+    assert(result == DTAG_OK && value_len == 1 && value[0] == 'v');
+    assert(dtag_get_path(block, "b/k", NULL, NULL) == DTAG_ERR_NOTFOUND);
+    if (flags[f] & DTAG_FLAG_COMPRESS) {
+      // A block written as an ordinary value is compressed and cannot be navigated
+      uint8_t copy[DTAG_EXTENT_MIN + sizeof(dblock_t)];
+      memcpy(copy, sub, sizeof(copy));
+      dtag_set(block, "c", copy, sizeof(copy));
+      assert(dtag_get_sub(block, "c", &sub) == DTAG_ERR_NOTSUPP);
+    }
+  }
+}
+
+void test_dtag_trace() {
+  const char *filename = "test_dtag.trace";
+  int32_t result = dtag_trace_open(filename);
+  if (result == DTAG_ERR_NOTSUPP) {
+    return;
+  }
+  assert(result == DTAG_OK);
+  uint8_t buffer[256];
+  dblock_t *block = NULL;
+  dtag_init(&block, buffer, sizeof(buffer));
+  dtag_set(block, "key", (const uint8_t *)"value", 5);
+  dtag_get(block, "none", NULL, NULL);
+  dtag_get_path(block, "none/key", NULL, NULL);
+  dtag_trace_close();
+  dtag_del(block, "key");
+
+  FILE *file = fopen(filename, "rb");
+  assert(file != NULL);
+  dtrace_head_t head;
+  uint8_t buf[sizeof(dtrace_rec_t) + DTAG_MAX_KLEN];
+  dtrace_rec_t *rec = (dtrace_rec_t *)buf;
+  result = fread(&head, 1, sizeof(head), file);
+  assert(result == sizeof(head) && head.magic == DTAG_TRACE_MAGIC);
+
+  const dtag_op_t ops[] = {DTAG_OP_INIT, DTAG_OP_SET, DTAG_OP_GET, DTAG_OP_GET_PATH};
+  const int32_t results[] = {DTAG_OK, DTAG_OK, DTAG_ERR_NOTFOUND, DTAG_ERR_NOTFOUND};
+  for (uint32_t i = 0; i < 4; i++) {
+    result = fread(rec, 1, sizeof(dtrace_rec_t), file);
+    assert(result == sizeof(dtrace_rec_t));
+    assert(rec->op == ops[i] && rec->result == results[i]);
+    result = fread(rec->key, 1, rec->klen, file);
+    assert(result == rec->klen);
+    if (ops[i] == DTAG_OP_GET)
+      assert(rec->klen == 4 && memcmp(rec->key, "none", 4) == 0);
+  }
+  // A path is recorded as a whole
+  assert(rec->klen == 8 && memcmp(rec->key, "none/key", 8) == 0);
+  assert(fread(rec, 1, 1, file) == 0);
+  fclose(file);
+  remove(filename);
+}
+
+void test_dtag_stats() {
+  dtag_stats_t stats;
+  int32_t result = dtag_stats_get(&stats);
+  if (result == DTAG_ERR_NOTSUPP) {
+    return;
+  }
+  assert(result == DTAG_OK);
+  dtag_stats_reset();
+  uint8_t buffer[256];
+  dblock_t *block = NULL;
+  dtag_init(&block, buffer, sizeof(buffer));
+  dtag_set(block, "key1", (const uint8_t *)"value", 5);
+  dtag_set(block, "key2", (const uint8_t *)"value", 5);
+  dtag_get(block, "none", NULL, NULL);
+  dtag_del(block, "key1");
+  dtag_complete(block);
+
+  result = dtag_stats_get(&stats);
+  assert(result == DTAG_OK);
+  assert(stats.calls[DTAG_OP_INIT] == 1 && stats.calls[DTAG_OP_SET] == 2);
+  assert(stats.calls[DTAG_OP_GET] == 1 && stats.errors[DTAG_OP_GET] == 1);
+  // set key2 scans key1, get scans both, del finds key1 first
+  assert(stats.items_scanned == 4);
+  assert(stats.bytes_moved == sizeof(ditem_t) + 5 + 5);
+  assert(stats.chksum_bytes == block->length);
+
+  // 应用 patch 时内部重算校验和，不计为一次 complete
+  uint8_t copy[256];
+  dblock_t *to = NULL;
+  memcpy(copy, buffer, sizeof(buffer));
+  dtag_import(&to, copy, sizeof(copy));
+  dtag_set(to, "key3", (const uint8_t *)"value", 5);
+  uint8_t *patch = NULL;
+  uint32_t len = 0;
+  dtag_diff(block, to, &patch, &len);
+  dtag_stats_reset();
+  result = dtag_patch_apply(block, patch, len);
+  assert(result == DTAG_OK);
+  dtag_stats_get(&stats);
+  assert(stats.calls[DTAG_OP_PATCH] == 1 && stats.calls[DTAG_OP_COMPLETE] == 0);
+  free(patch);
+}
+
+void test_dtag_varint() {
+  uint32_t flags[] = {DTAG_FLAG_VARINT, DTAG_FLAG_VARINT | DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM};
+  for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    uint8_t buffer[1024];
+    uint8_t classic[1024];
+    dblock_t *block = NULL;
+    dblock_t *classic_block = NULL;
+    int32_t result = dtag_init_schema(&block, buffer, sizeof(buffer), flags[f], SLOT_COUNT);
+    assert(result == DTAG_OK);
+    dtag_init(&classic_block, classic, sizeof(classic));
+
+    uint8_t large[200];
+    memset(large, 0xa5, sizeof(large));
+    const char *keys[] = {"net.eth0.mac", "board", "net.eth0.ip"};
+    for (uint32_t i = 0; i < 3; i++) {
+      result = dtag_set(block, keys[i], (const uint8_t *)"value", 5);
+      assert(result == DTAG_OK);
+      dtag_set(classic_block, keys[i], (const uint8_t *)"value", 5);
+    }
+    // vlen above 127 takes two LEB128 bytes
+    result = dtag_set(block, "large", large, sizeof(large));
+    assert(result == DTAG_OK);
+    dtag_set(classic_block, "large", large, sizeof(large));
+    dtag_key_t key;
+    dtag_key_prepare(&key, board_keys[SLOT_MAC]);
+    result = dtag_set_slot(block, SLOT_MAC, &key, (const uint8_t *)"001122", 6);
+    assert(result == DTAG_OK);
+    dtag_set(classic_block, "mac", (const uint8_t *)"001122", 6);
+
+    uint8_t value_get[sizeof(large)];
+    uint32_t value_len = sizeof(value_get);
+    result = dtag_get(block, "large", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == sizeof(large));
+    assert(memcmp(value_get, large, sizeof(large)) == 0);
+    result = dtag_del(block, "board");
+    assert(result == DTAG_OK);
+    assert(dtag_get(block, "board", NULL, NULL) == DTAG_ERR_NOTFOUND);
+
+    uint32_t count = 0;
+    dtag_view_t view;
+    for (ditem_t *curr = NULL; dtag_next(block, &curr) == DTAG_OK && curr; count++) {
+      dtag_item_view(block, curr, &view);
+      assert(view.klen > 0 && view.vlen > 0);
+    }
+    assert(count == 4);
+    ditem_t *item = NULL;
+    result = dtag_get_slot(block, SLOT_MAC, &item);
+    assert(result == DTAG_OK);
+    dtag_item_view(block, item, &view);
+    assert(view.klen == 3 && memcmp(view.key, "mac", 3) == 0);
+    assert(view.vlen == 6 && memcmp(view.val, "001122", 6) == 0);
+
+    dtag_complete(block);
+    dblock_t *imported_block = NULL;
+    result = dtag_import(&imported_block, buffer, sizeof(buffer));
+    assert(result == DTAG_OK);
+
+    // Round trip: varint -> classic -> varint
+    result = dtag_init_schema(&classic_block, classic, sizeof(classic), 0, SLOT_COUNT);
+    assert(result == DTAG_OK);
+    result = dtag_convert(classic_block, block);
+    assert(result == DTAG_OK);
+    result = dtag_get_slot(classic_block, SLOT_MAC, &item);
+    assert(result == DTAG_OK && strcmp((const char *)item->kv, "mac") == 0);
+    if (flags[f] == DTAG_FLAG_VARINT) {
+      // 4 items, each saves at least 2 bytes (the NUL and the header)
+      assert(block->length + 4 * 2 <= classic_block->length);
+    }
+    uint8_t again[1024];
+    dblock_t *again_block = NULL;
+    dtag_init_schema(&again_block, again, sizeof(again), flags[f], SLOT_COUNT);
+    result = dtag_convert(again_block, classic_block);
+    assert(result == DTAG_OK);
+    value_len = sizeof(value_get);
+    result = dtag_get(again_block, "large", value_get, &value_len);
+    assert(result == DTAG_OK && value_len == sizeof(large));
+    assert(dtag_get_slot(again_block, SLOT_MAC, NULL) == DTAG_OK);
+  }
+}
+
 int main() {
   test_dtag_init();
   test_dtag_import();
   test_dtag_import_checksum_error();
+  test_dtag_import_v3();
   test_dtag_get_set_del();
+  test_dtag_sorted();
+  test_dtag_bloom();
+  test_dtag_key();
+  test_dtag_schema();
+  test_dtag_varint();
+  test_dtag_aligned();
+  test_dtag_compress();
+  test_dtag_dedup();
+  test_dtag_extent();
+  test_dtag_files_async();
+  test_dtag_flush();
+  test_dtag_patch();
+  test_dtag_container();
+  test_dtag_grow();
+  test_dtag_heat();
+  test_dtag_verify();
+  test_dtag_sub();
+  test_dtag_trace();
+  test_dtag_stats();
   printf("All tests passed.\n");
   return 0;
 }
@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// FILE: test_dtag_hpp.cpp
+
+#include "dtag.hpp"
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+void test_block_create() {
+  dtag::Block block;
+  assert(!block);
+  int32_t result = dtag::Block::create(block, 1024, DTAG_FLAG_SORTED | DTAG_FLAG_BLOOM);
+  assert(result == DTAG_OK);
+  assert(block);
+  assert(block.raw()->capacity == 1024);
+
+  dtag::Block moved = std::move(block);
+  assert(!block);
+  assert(moved);
+}
+
+void test_block_get_set_del() {
+  dtag::Block block;
+  dtag::Block::create(block, 1024);
+
+  // keys taken from a larger buffer, not null-terminated
+  std::string_view keys = "serial.number";
+  int32_t result = block.set(keys.substr(0, 6), std::string_view("SN0001"));
+  assert(result == DTAG_OK);
+  const uint8_t raw[] = {1, 2, 3, 4};
+  result = block.set("raw", std::as_bytes(std::span(raw)));
+  assert(result == DTAG_OK);
+
+  auto serial = block.get_str(keys.substr(0, 6));
+  assert(serial && *serial == "SN0001");
+  auto value = block.get("raw");
+  assert(value && value->size() == sizeof(raw));
+  // zero-copy: the view points into the block
+  assert(reinterpret_cast<const uint8_t *>(value->data()) > reinterpret_cast<uint8_t *>(block.raw()) &&
+         reinterpret_cast<const uint8_t *>(value->data()) < block.raw()->data + block.raw()->length);
+
+  static constexpr dtag_key_t kSerial = dtag::key("serial");
+  assert(block.contains(kSerial));
+  assert(block.get_str(kSerial) == serial);
+
+  result = block.del("serial");
+  assert(result == DTAG_OK);
+  assert(!block.contains("serial"));
+  assert(!block.get("serial"));
+  assert(block.del("serial") == DTAG_ERR_NOTFOUND);
+}
+
+void test_block_iterate() {
+  for (uint32_t flags : {DTAG_FLAG_SORTED, DTAG_FLAG_SORTED | DTAG_FLAG_VARINT}) {
+    uint8_t buffer[1024];
+    dblock_t *raw = nullptr;
+    dtag_init_ex(&raw, buffer, sizeof(buffer), flags);
+    dtag_set(raw, "b", (const uint8_t *)"2", 1);
+    dtag_set(raw, "a", (const uint8_t *)"1", 1);
+    dtag_complete(raw);
+
+    dtag::Block block;
+    int32_t result = dtag::Block::import(block, buffer, sizeof(buffer));
+    assert(result == DTAG_OK);
+    std::string keys, values;
+    for (dtag::Item item : block) {
+      keys += item.key();
+      values += item.value_str();
+    }
+    assert(keys == "ab");
+    assert(values == "12");
+  }
+}
+
+void test_block_schema() {
+  static constexpr auto kBoard = dtag::schema("serial", "mac");
+  static constexpr uint32_t SLOT_SERIAL = kBoard.slot("serial");
+  static_assert(SLOT_SERIAL == 0 && kBoard.slot("mac") == 1 && kBoard.slot("rev") == DTAG_SLOT_NONE);
+
+  dtag::Block block;
+  int32_t result = dtag::Block::create(block, 1024, 0, kBoard.size());
+  assert(result == DTAG_OK);
+  assert(!block.slot(SLOT_SERIAL));
+  result = block.set_slot(SLOT_SERIAL, kBoard[SLOT_SERIAL], std::string_view("SN0001"));
+  assert(result == DTAG_OK);
+  auto item = block.slot(SLOT_SERIAL);
+  assert(item && item->key() == "serial" && item->value_str() == "SN0001");
+  assert(block.get_str("serial") == item->value_str());
+}
+
+void test_block_typed() {
+  dtag::Block block;
+  int32_t result = dtag::Block::create(block, 1024, DTAG_FLAG_ALIGNED);
+  assert(result == DTAG_OK);
+  uint64_t counter = 1;
+  double ratio = 0.5;
+  block.set("counter", std::as_bytes(std::span(&counter, 1)));
+  block.set("ratio", std::as_bytes(std::span(&ratio, 1)));
+  result = block.add("counter", 9);
+  assert(result == DTAG_OK);
+  assert(block.get_as<uint64_t>("counter") == 10u);
+  assert(block.get_as<double>("ratio") == 0.5);
+  assert(!block.get_as<uint32_t>("ratio"));
+}
+
+void test_block_sub() {
+  dtag::Block block;
+  int32_t result = dtag::Block::create(block, 1024, DTAG_FLAG_BLOOM);
+  assert(result == DTAG_OK);
+  dblock_t *radio = nullptr;
+  result = dtag_set_sub(block.raw(), "radio", 256, 0, &radio);
+  assert(result == DTAG_OK);
+  dtag_set(radio, "gain", reinterpret_cast<const uint8_t *>("12"), 2);
+  auto sub = block.sub("radio");
+  assert(sub && sub->get_str("gain") == "12");
+  assert(!block.sub("missing"));
+}
+
+int main() {
+  test_block_create();
+  test_block_get_set_del();
+  test_block_iterate();
+  test_block_schema();
+  test_block_typed();
+  test_block_sub();
+  printf("All tests passed.\n");
+  return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "uring.h"
+#include <errno.h>
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifdef __URING__
+
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int _setup(uint32_t entries, struct io_uring_params *p) { return syscall(__NR_io_uring_setup, entries, p); }
+
+static int _enter(int fd, uint32_t submit, uint32_t wait, uint32_t flags) {
+  return syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static void *_map(int fd, size_t size, off_t off) {
+  void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, off);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+int uring_init(uring_t *ring, uint32_t entries) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = _setup(entries, &p);
+  if (ring->fd < 0)
+    return -errno;
+  ring->entries = p.sq_entries;
+  ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+  ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  /* 5.4 起 SQ 与 CQ 环共用一次映射 */
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_ring_size > ring->sq_ring_size)
+      ring->sq_ring_size = ring->cq_ring_size;
+    ring->cq_ring_size = 0;
+  }
+  ring->sq_ring = _map(ring->fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+  ring->cq_ring = ring->cq_ring_size ? _map(ring->fd, ring->cq_ring_size, IORING_OFF_CQ_RING) : ring->sq_ring;
+  ring->sqes = _map(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+  if (!ring->sq_ring || !ring->cq_ring || !ring->sqes) {
+    int err = -errno;
+    uring_exit(ring);
+    return err;
+  }
+  uint8_t *sq = ring->sq_ring, *cq = ring->cq_ring;
+  ring->sq_head = (uint32_t *)(sq + p.sq_off.head);
+  ring->sq_tail = (uint32_t *)(sq + p.sq_off.tail);
+  ring->sq_mask = (uint32_t *)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (uint32_t *)(sq + p.sq_off.array);
+  ring->cq_head = (uint32_t *)(cq + p.cq_off.head);
+  ring->cq_tail = (uint32_t *)(cq + p.cq_off.tail);
+  ring->cq_mask = (uint32_t *)(cq + p.cq_off.ring_mask);
+  ring->cqes = cq + p.cq_off.cqes;
+  return 0;
+}
+
+void uring_exit(uring_t *ring) {
+  if (ring->sqes)
+    munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  if (ring->sq_ring)
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  if (ring->fd >= 0)
+    close(ring->fd);
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+int uring_prep(uring_t *ring, int write, int fd, void *buf, uint32_t len, uint64_t off, uint64_t data) {
+  uint32_t tail = *ring->sq_tail;
+  if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->entries)
+    return -EBUSY;
+  uint32_t index = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = (struct io_uring_sqe *)ring->sqes + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = (uintptr_t)buf;
+  sqe->len = len;
+  sqe->off = off;
+  sqe->user_data = data;
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ring->queued++;
+  return 0;
+}
+
+int uring_submit(uring_t *ring, uint32_t wait) {
+  for (;;) {
+    int ret = _enter(ring->fd, ring->queued, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+    if (ret >= 0) {
+      ring->queued -= ret;
+      /* 未全部提交时（如 CQ 暂满），剩余的留待下次 */
+      return 0;
+    }
+    /* EAGAIN 为内核暂时无法分配请求 */
+    if (errno != EINTR && errno != EAGAIN)
+      return -errno;
+  }
+}
+
+int uring_wait(uring_t *ring) {
+  for (;;) {
+    if (_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) >= 0)
+      return 0;
+    if (errno != EINTR)
+      return -errno;
+  }
+}
+
+int uring_reap(uring_t *ring, uint64_t *data, int32_t *res) {
+  uint32_t head = *ring->cq_head;
+  if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    return 0;
+  struct io_uring_cqe *cqe = (struct io_uring_cqe *)ring->cqes + (head & *ring->cq_mask);
+  *data = cqe->user_data;
+  *res = cqe->res;
+  __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+#else
+
+int uring_init(uring_t *ring, uint32_t entries) { return -ENOSYS; }
+void uring_exit(uring_t *ring) {}
+int uring_prep(uring_t *ring, int write, int fd, void *buf, uint32_t len, uint64_t off, uint64_t data) {
+  return -ENOSYS;
+}
+int uring_submit(uring_t *ring, uint32_t wait) { return -ENOSYS; }
+int uring_wait(uring_t *ring) { return -ENOSYS; }
+int uring_reap(uring_t *ring, uint64_t *data, int32_t *res) { return 0; }
+
+#endif /* __URING__ */
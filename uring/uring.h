@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright 2025 Kioz Wang <kioz.wang@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/*
+ * 仅覆盖单次读写的最小 io_uring 封装，直接使用系统调用（不依赖 liburing）
+ */
+
+typedef struct {
+  int fd;
+  uint32_t entries;
+  /* 已填写但尚未提交的 sqe 数量 */
+  uint32_t queued;
+  uint32_t *sq_head, *sq_tail, *sq_mask, *sq_array;
+  uint32_t *cq_head, *cq_tail, *cq_mask;
+  void *sqes, *cqes;
+  void *sq_ring, *cq_ring;
+  size_t sq_ring_size, cq_ring_size, sqes_size;
+} uring_t;
+
+/**
+ * @brief 创建 `entries` 深度的 io_uring
+ *
+ * @param ring
+ * @param entries
+ * @return * int 成功返回 0；否则返回 -errno（未编译支持时为 -ENOSYS）
+ */
+extern int uring_init(uring_t *ring, uint32_t entries);
+/**
+ * @brief 释放 io_uring，调用前须已收割全部完成事件
+ *
+ * @param ring
+ */
+extern void uring_exit(uring_t *ring);
+/**
+ * @brief 填写一个 `pread`/`pwrite` 语义的请求，待 `uring_submit` 时提交
+ *
+ * @param ring
+ * @param write 非 0 时为写
+ * @param fd
+ * @param buf
+ * @param len
+ * @param off 文件偏移
+ * @param data 原样出现在对应的完成事件中
+ * @return * int 成功返回 0；提交队列已满时返回 -EBUSY
+ */
+extern int uring_prep(uring_t *ring, int write, int fd, void *buf, uint32_t len, uint64_t off, uint64_t data);
+/**
+ * @brief 提交已填写的请求，并等待至少 `wait` 个完成事件
+ *
+ * @param ring
+ * @param wait
+ * @return * int 成功返回 0；否则返回 -errno
+ */
+extern int uring_submit(uring_t *ring, uint32_t wait);
+/**
+ * @brief 不提交新的请求，仅等待至少一个完成事件
+ *
+ * @param ring
+ * @return * int 成功返回 0；否则返回 -errno
+ */
+extern int uring_wait(uring_t *ring);
+/**
+ * @brief 取出一个完成事件
+ *
+ * @param ring
+ * @param data 请求的 `data`
+ * @param res 读写的字节数，或 -errno
+ * @return * int 取到时返回 1；没有完成事件时返回 0
+ */
+extern int uring_reap(uring_t *ring, uint64_t *data, int32_t *res);
+
+#endif /* __URING_H__ */